@@ -1,1261 +1,8532 @@
-#include <mpi.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <unistd.h>
-#include <string.h>
-#include <sys/types.h>
-#include <time.h>
-#include <signal.h>
-
-/* Valeur à entrer */
-
-#define NB_MACHINE_MAX      5    // Nombre maximum possible de machines dans notre réseau P2P
-#define NB_SERVEUR_MAX      1    // Nombre maximum de serveur par machine
-#define PROCESS_SIZE        50
-#define MAX_POURCENT        70
-#define MIN_POURCENT        30
-
-/* Structure d'un processus */
-
-
-struct process{
-    pid_t pid; 	                // Valeur du pid du processus   
-	int gpid;	                // Identifiant global unique sur le réseau
-	char *cmd;                  // Nom de la commande
-}process[PROCESS_SIZE];
-
-/* TAG */
-
-#define TAG_TEST            0   // juste utiliser pour faire des tests
-#define TAG_GSTART          1   // msg qui indique de faire un gstart
-#define TAG_GSTART_CMD      2   // msg qui comporte les arguments de gstart
-#define TAG_GPS             3   // msg qui indique de faire un gps
-#define TAG_GKILL           4   // msg qui indique de faire un gkill
-#define TAG_GKILL_GPID      5   // msg qui indique de retirer un certain gpid de sa matrice de processus
-#define TAG_CHARGE          6   // msg pour la mise à jour de la charge 
-#define TAG_GPID            7   // msg qui comporte le gpid que l'on doit ajouter à sa matrice de processus
-#define TAG_RECHERCHE_GPID  8   // msg qui indique que l'on cherche la machine qui comporte un certain gpid
-#define TAG_INSERTION       9   // msg qui porte l'identifiant de la machine qui s'insère dans le réseau
-#define TAG_TRANSFERT       10  // msg qui porte le processus à transmettre à une autre machine
-#define TAG_LESS            11  // msg qui demande à la machine la moins chargé de ce retirer du réseau
-#define TAG_END             12  // msg qui indique au processus de ce terminer
-#define TAG_PRESENT         13  // msg qui demande à un processus s'il est présent dans le réseau
-
-/* Variables locales*/
-
-int cpt_gpid = 1;                                           // Compteur global du gpid
-float* tab_charge;                                          // Tableau des charges de l'ensemble des serveurs participants au réseau P2P
-                                                            // indice de chaque case correspond au rang (identifiant) de la machine
-float charge_globale;                                       // Moyenne des charges  
-int* tab_participe;                                         // Tableau de booléen qui indique si le serveur (rank) est actif dans le réseau
-int machines[NB_MACHINE_MAX*NB_SERVEUR_MAX][PROCESS_SIZE];  // Matrice de processus, qui stocke le lieu où chaque processus est stocké
-
-/* Variables MPI */
-
-int nb_proc;                                    // Nombre de serveurs dans le réseau
-int rank;                                       // Identifiant du serveur dans le serveur P2P
-MPI_Status status;                              // Structure permettant de récupérer le TAG du message reçu ainsi que son émetteur
-char hostname[MPI_MAX_PROCESSOR_NAME];          // Nom de la machine sur lequel tourne le serveur
-int length_hostname;                            // Taille du nom de la machine
-
-
-void notifyCharge();
-float CalculCharge();
-void gkill(int signal, int pid, int gpid, int p);
-
-/***************************************************************************************************
-                            Fonctions d'initialisation et de terminaison
-***************************************************************************************************/
-
-/**
-Fonction qui initialise MPI et les variables locales
-*/
-
-/**
- * @brief Fonction qui initialise MPI et les variables locales
- * 
- * @param argc      nombre de paramètres
- * @param argv      arguments
- */
-
-void Init(int argc, char* argv[]){
-
-    // Initialisation MPI
-    MPI_Init(&argc, &argv);
-    MPI_Comm_size(MPI_COMM_WORLD, &nb_proc);
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-	
-    // On vérifie que le programme est lancé avec le bon nombre de processus maximum
-    if (nb_proc < 2) {
-        printf("Nombre de processus lancé insuffisant !\n");
-        printf("Il faut lancer le programme avec au moins 2 processus.\n");
-        MPI_Finalize();
-        exit(2);
-    }
-
-    // Initialisation des variables
-    MPI_Get_processor_name(hostname,&length_hostname);          // On récupère le nom de la machine
-    tab_charge = (float *) malloc(nb_proc * sizeof(float));     // On alloue de la mémoire au tableau des charges
-    tab_participe = (int *) malloc(nb_proc * sizeof(int));
-    
-    // Instancie la table des participants
-    for(int i = 0; i < nb_proc; i++){
-        tab_participe[i] = 1; 
-    }
-
-
-    notifyCharge();
-}
-
-
-/**
- * @brief Fonction qui gère la terminaison MPI et libère la mémoire alloué.
- * 
- */
-
-void Final(){
-    // Finalise MPI
-    MPI_Finalize();
-
-    // Libère l'espace mémoire alloué pour le programme
-    free(tab_charge);
-    free(tab_participe);
-}
-
-/***************************************************************************************************
-                                Fonctions de gestions des machines
-***************************************************************************************************/
-
-/*******************************************INSERTION**********************************************/
-
-/**
- * @brief Ajoute un participant au réseau
- * 
- */
-
-void AddMachine(){
-
-    // Parcours la table de participants
-    for(int i = 1; i < nb_proc; i++){
-
-        // Au premier non participant trouvé
-        if(tab_participe[i] == 0){
-            
-            // Il devient participant
-            tab_participe[i] = 1;
-            
-            // On prévient tout le monde 
-            for(int j = 1; j < nb_proc; j++){
-                // Sauf soi-même
-                if(i != j)// On envoie l'id de celui qui va participer au réseau
-                    MPI_Send(&i, 1, MPI_INT, j, TAG_INSERTION, MPI_COMM_WORLD);
-            }
-            break;
-        }
-    }
-}
-
-
-/**
- * @brief  transfert les taches d'une machine vers une autre qui particpe dans le réseau
- * 
- * @param id_machine        identifiant de la machine destinataire
- * @param more_or_less      1 si la machine est en surcharge, elle transfert qu'une tâche
- *                          0 si la machine est en souscharge, elle transfert toutes ses tâches
- */
-
-void transfert_tache(int id_machine, int more_or_less){
-    char *tab[2];
-    int taille;
-    
-    // On parcours la table des processus lancé sur la machine
-    for(int i=0; i < PROCESS_SIZE; i++){
-        // Si une tâche est non nulle
-        if(process[i].gpid != 0){
-            // On récupère son gpid
-            sprintf(tab[0], "%d", process[i].gpid);
-            // On récupère le nom de la commande
-            tab[1] = strdup(process[i].cmd);
-            // transfert de la tache vers id_machine
-            for(int k = 0; k < 2; k++){
-                taille = strlen(tab[k]) + 1;
-                MPI_Send(tab[k], taille, MPI_CHAR, id_machine, TAG_TRANSFERT, MPI_COMM_WORLD);
-            }
-            /*
-            Envoie un gkill à soi même pour retirer le processus de sa table de processus
-            Le gkill va ensuite informer tous les participants du réseau de retirer ce processus
-            de leur table machines
-            */
-            gkill(9, process[i].pid, process[i].gpid, i);
-            free(tab[1]);
-            
-            // Si c'est une surcharge, on s'arrête là, sinon on réitère jusqu'à ce qu'il n'y ai plus de processus dans la table
-            if(more_or_less == 1)
-                break;
-        }
-    }
-
-}
-
-
-/**
- * @brief surcharge - detection de la surcharge 
- * 
- * @return int      retourne 1 en cas de sucharge, sinon 0
- */
-
-int surcharge(){
-    // Si participant
-    if(tab_participe[rank] == 1){
-
-        // On calcul la charge globale moyenne
-        charge_globale = CalculCharge();
-        
-        // Si on est en surcharge par rapport à la charge globale du réseau
-        // On devrait aussi rajouter >= MAX_POURCENT*Nombre de coeur de la machine  
-        if(tab_charge[rank] >= MAX_POURCENT*charge_globale){
-            printf("%s JE SUIS EN SURCHARGE ET J AI POUR RANK %d \n",hostname,rank);
-            
-            float min = -1;
-            int cpt = 0;
-
-            // Parcours la table charge pour récupéré l'ensemble des id qui ont tag_charge = min
-            for(int i = 1; i < nb_proc; i++){
-                // Si un serveur participe et sa charge est inférieur au min (init à -1)
-                if(tab_participe[i] && (tab_charge[i] < min)){
-                    // tab_charge devient le nouveau min et le cpt est donc a 1
-                    min = tab_charge[i];
-                    cpt = 1;
-                }else{
-                    // si participe et égale à min alors on a plusieurs valeurs avec la meme charge min
-                    // pour le cas où l'on a plusieurs serveurs par machine
-                    if(tab_participe[i] && (tab_charge[i] == min)){
-                        cpt++;
-                    }
-                }
-            }
-            int i = 0;  // indice du tableau des identifiants des charges min du réseau 
-            int j = 1;  // indice pour parcourir la ta table des participants
-
-            // tableau qui a la taille du nbr d'identifiants a avoir la charge min
-            int tab[cpt];
-            
-            // Tant que le tableau n'est pas remplit et que j < nbr de serveur maximum du réseau
-            while(i < cpt && j < nb_proc){ 
-                // On récupère les id de tous les serveurs avec une charge egale a la charge min
-                if(tab_participe[j] == 1 && tab_charge[j] == min){
-                    tab[i] = j;
-                    i++;
-                }
-                j++;
-            }
-            // ensuite on regarde si notre rang est égale a l'un des id qui a la charge min
-            for(int i = 0; i < cpt; i++){
-                // si c'est le cas on ajoute une machine pcq ca veut dire que
-                // si on est l'une des machines a avoir une charge min ET
-                // qu'on est surcharge alors peut importe a qui on donne une
-                // tache, la machine cible sera en surcharge vu que l'on est l'un des min
-                if(tab[i] == rank){
-                    AddMachine();
-                    return 1;
-                }
-            }
-            // transfert de tache que si tu n'as pas ajouter de machine
-            // car ca veut dire qu'il existe au moins une machine qui n'est pas
-            // en surcharge donc on peut lui envoyer des taches
-            transfert_tache(tab[0], 1);
-            
-        } // else la machine n'est pas en surcharge 
-    }
-    return 0;
-}
-
-
-/*******************************************RETRAIT***********************************************/
-
-/**
- * @brief souscharge - détection de la sous-charge
- * 
- */
-
-void souscharge(){
-    float min = -1;
-    int id_cible;
-    int cpt = 0;
-    if(tab_participe[rank] == 1){ // participant
-        
-        // On calcul la charge globale moyenne
-        charge_globale = CalculCharge();  
-         
-        // Si on est en souscharge par rapport à la charge globale du réseau
-        if(tab_charge[rank] <= MIN_POURCENT*charge_globale){ 
-            printf("Machine %s en souscharge\n", hostname);
-
-            // On cherche s'il y a au moins 2 participants dans le réseau
-            for(int i = 1; i < nb_proc; i++){
-                if(tab_participe[i] == 1){
-                    cpt++;
-                }
-
-                if(cpt == 2)
-                    break;
-            }
-
-            if(cpt < 2){
-                printf("Pas assez de machine connecté pour en retirer.\n");
-                return;
-            }
-
-            // On parcours la table des processus
-            for(int i = 1; i < nb_proc; i++){
-
-                // Si le processus est participant et qu'il est en sous charge
-                if((tab_participe[i] == 1) && (tab_charge[i]<= MIN_POURCENT*charge_globale)){  
-                    // ! cette vérification est importante car si jamais on a plusieurs machines en souscharge 
-                    // ! on doit enlever qu'UNE seule machine
-                    // ! donc on enlève la première qu'on trouve dans le tableau des charges globales du réseau
-                    // ! on évite ainsi un interblocage
-                    if(i == rank){ // je suis la première machine en sous charge
-                        printf("Je suis en souscharge %s car %d=%d\n", hostname, i, rank);
-                        // Donc je me retire du réseau et prévient les autres pour qu'elles ne m'envoient plus de messages
-                        tab_participe[rank] = 0;
-                        printf("%s JE ME RETIRE DU RESEAU!!!!!!!!!!!!!!!!\n",hostname);
-                        //envoie un msg à tout le monde pour leur prévenir que je ne participe plus (c'est dommage)
-                        for(int id = 1; id < nb_proc; id++){
-                            if(id != rank){
-                                MPI_Send(&rank, 1, MPI_INT, id, TAG_LESS, MPI_COMM_WORLD);
-                            }
-                        }
-                        // trouver la première machine qui est active (sans se compter !!!)
-                        // il en existe au moins une, cpt >=2
-                        for(int j = 1; j < nb_proc; j++){
-                            if((j != rank) && tab_participe[j] == 1){
-                                id_cible = j;
-                                min = tab_charge[j];
-                                break;
-                            }
-                        }
-                        // trouver la machine la moins chargée (sans se compter !!!)
-                        for(int k = id_cible + 1; k < nb_proc; k++){
-                            if(((k != rank) && (tab_participe[k] == 1)) && (tab_charge[k] < min)){
-                                min = tab_charge[k];
-                                id_cible = k;
-                            }
-                        }
-                        // j'envoi mes taches à la machine cible avec un tag TAG_TRANSFERT
-                        transfert_tache(id_cible, 0);
-                    }
-                    /* sinon
-                    *    ce n'est pas moi qui est en premier mais quelqu'un d'autre
-                    *    je ne fais rien et c'est la machine concernant qui le fera
-                    */
-                    break;
-                }
-            }
-
-            
-        } // else rien car pas en sous charge
-
-    } // else non participant donc ne peux pas detecter de sous charge
-}
-
-/***************************************************************************************************
-                                Fonctions de gestions des charges
-***************************************************************************************************/
-
-/**
- * @brief getCharge - récupère la charge calculé sur une minute de la machine 
- *                    à partir du fichier "/proc/loadavg"
- * 
- * @return float      retourne cette charge
- */
- 
-float getCharge(){
-    float charge;
-    FILE* fp = fopen("/proc/loadavg", "r");
-    if(!fp) {
-        perror("File opening failed");
-        exit(0);
-    }
-    char buff[128];
-    fgets(buff,128,fp);
-    sscanf(buff,"%f",&charge);
-    fclose(fp);
-    return charge;
-}
-
-/**
- * @brief notifyCharge - permet de mettre au courant les autres machines de
- *                       la charge de la machine idMachine
- * 
- * @return * void 
- */
- 
-void notifyCharge(){
-    tab_charge[rank] = getCharge();
-    printf("%d a pour charge %2f\n", rank, tab_charge[rank]);
-    
-    for(int i = 1; i < nb_proc; i++){
-        if((i != rank) && (tab_participe[i])){
-            MPI_Send(&tab_charge[rank], 1, MPI_FLOAT, i, TAG_CHARGE, MPI_COMM_WORLD);
-        }
-    }
-}
-
-/**
- * @brief CalculCharge - calcule la moyenne des charges des machines
- *                       participant dans le réseau
- * 
- * @return float      retourne la moyenne des charges
- */
-
-float CalculCharge(){
-    float tmp_global = 0.0;
-    int nbr_machine = 0;
-    for(int i = 1; i < nb_proc; i++){
-        if(tab_participe[i] == 1){
-            tmp_global += tab_charge[i];
-            nbr_machine += tab_participe[i];
-        }
-    }
-    // Divise par le nombre de machine participantes
-    tmp_global /= nbr_machine*1.0;
-    return tmp_global;
-}
-
-/**
- * @brief getIdMachineMoinsCharge - recherche de la machine la moins chargée dans le réseau
- *                                  (la machine doit être participante)
- * 
- * @return int     retourne l'identifiant de la machine la moins chargée
- */
-
-
-int getIdMachineMoinsCharge(){
-    int i=0;
-
-    // on cherche le premier identifiant de machine participant
-    do{ 
-        i++;
-    }while((tab_participe[i] == 0) && i < nb_proc);
-
-    int id = i;
-    float min = tab_charge[i];
-    
-    // Parcours de la table des participants
-    for(int i = id + 1; i < nb_proc; i++){
-        // Si une machine participe et qu'elle a une charge inférieur à min
-        if(tab_participe[i] && (tab_charge[i] < min)){
-            min = tab_charge[i];
-            id = i;
-        }
-    }
-    return id;
-}
-
-
-/**
- * @brief handler - redéfinition du traitement du signal SIGALRM 
- * 
- * @param num 
- */
-
-void handler(int num) {
-    printf("Il est temps d'envoyer la charge à toutes les machines \n");
-    notifyCharge();
-    //  souscharge();
-    /*
-    if(!surcharge()){   // si la machine n'est pas en surcharge
-        souscharge();   // vérification si elle est en souscharge
-    }
-    */
-    if(tab_participe[rank] == 1){
-        signal(SIGALRM, &handler);
-        alarm(15);
-    }else{
-        alarm(0);
-    }
-
-}
-
-/***************************************************************************************************
-                                            TRANSIT CMD
-***************************************************************************************************/
-
-/**
- * @brief getPID_gpid - recherche du PID correspond au GPID
- * 
- * @param gpid              identifiant global du processus
- * @param indice_process    indice de la case des information du processus gpid
- * @return int              retourne le PID
- */
-
-int getPID_gpid(int gpid, int *indice_process){
-    // Parcours la table des processus
-    for(int p = 0; p < PROCESS_SIZE; p++){
-        // Si on trouve le processus grâce à son gpid
-        if(process[p].gpid == gpid){
-            printf("%s possède le processus de gpid %d.\n",hostname, gpid);
-            *indice_process = p;
-            return process[p].pid;
-        }
-    }
-    // Si on ne le retrouve pas
-    printf("Le processus avec le gpid %d n'existe pas.\n",gpid);
-    return 0;
-}
-
-
-/**
- * @brief recv_gkill - retire le GPID du tableau machines
- * 
- * @param rank      identifiant de la machine qui était en charge du GPID
- * @param gpid      identifiant global à retirer
- * @param p         
- */
-
-void recv_gkill(int rank, int gpid, int p){
-    machines[rank][p] = 0;  
-}
-
-/***************************************************************************************************
-                                                CMD
-***************************************************************************************************/
-
-/**
- * @brief gstart - permet de créer un processus exécutant une commande donnée
- *                 en paramètre sur la machine la moins chargée du réseau
- * 
- * @param args      tableau d'arguments pour la commande args[0] à lancer
- * @param gpid      identifiant global unique sur le réseau
- * @param indice    indice du tableau process
- * @return * void 
- */
-
-
-void gstart(char * args[], int gpid, int indice_process){
-    int pid = fork();
-   
-    if(pid==0){
-        int i = 0;
-        /* Le processus fils exécute la commande args[0] */
-        if(!execvp(args[0],args)){
-            perror("gstart : execvp failed\n");
-            exit(0);
-        }
-    }
-    printf("%s crée le processus %s qui a pour pid %d et gpid %d.\n", hostname, args[0], pid, gpid);
-  
-    /* Le père enregistre les informations du fils :
-    *  - identifiant du processus (locale à la machine)
-    *  - identifiant globale du processus (globale au réseau)
-    *  - la commande
-    */ 
-    (process + indice_process)->pid = pid;
-    (process + indice_process)->gpid = gpid;
-    (process + indice_process)->cmd = strdup(args[0]);
-}
-
-/**
- * @brief gps - affiche la liste de tous les processus lancés par la machine
- *              sur laquelle on execute la commande gps
- * 
- * @param option     1 si option -l (affichage en format long), sinon 0   
- */
- 
-void gps(int option){
-    int p;
-    int uid = getuid();
-    //affichage du tableau process local de la machine
-    if(option == 0){ // sans option
-        // affiche tous les processus de sa table des processus
-        for(p = 0; p < PROCESS_SIZE; p++){
-            if(process[p].pid != 0){ // Les cases non instancié sont ignorées
-                printf("%d\t%d\t%s\n", process[p].pid, process[p].gpid, process[p].cmd);
-            }
-        }
-    }else{ // format long car option -l
-
-        //(noms executable, machine, uid, éventuellement statistiques d’utilisation CPU, mémoire)
-        for(p = 0; p < PROCESS_SIZE; p++){
-            if(process[p].pid != 0){ // Les cases non instancié sont ignorées
-                printf("%s\t%d\t%d\t%d\t%s\n",hostname, uid, process[p].pid, process[p].gpid,process[p].cmd);
-            }
-        }   
-    }
-}
-
-
-/**
- * @brief gkill - permet d'envoyer un signal sig à un processus pid
- * 
- * @param sig      numéro du signal
- * @param pid      identifiant du processus
- * @return * void 
- */
- 
-void gkill(int signal, int pid, int gpid, int p){
-    char kill[20];
-
-    // Lance la fct systeme kill
-    printf("je dois kill le pid %d\n",pid);
-    sprintf(kill, "kill -%d %d",signal, pid);
-    printf("kill = %s\n", kill);
-    system(kill);
-
-    // On retire le processus de sa table de processus
-    (process + p)->pid = 0;
-    (process + p)->gpid = 0;
-    (process + p)->cmd = NULL;
-
-    // On prépare le message d'envoye
-    int gkill_gpid[2];
-    gkill_gpid[0] = gpid;
-    gkill_gpid[1] = p;
-
-    // On envoie le gpid et son indice dans la table de chaque machine
-    // pour que chaque participant le retire
-    for(int i = 1; i < nb_proc; i++){
-        if((i != rank) && (tab_participe[i])){  
-            MPI_Send(gkill_gpid, 2, MPI_INT, i, TAG_GKILL_GPID, MPI_COMM_WORLD);
-        }
-    } 
-
-}
-
-/***************************************************************************************************
-                                                TEST
-***************************************************************************************************/
-
-/**
- * @brief test_gstart - gestion de la fonction gstart avant de l'envoyer dans le réseau
- * 
- * @param opt_gstart 
- */
-
-
-
-void test_gstart(int opt_gstart){
-    char* commande[4]= {NULL, NULL, NULL, NULL};
-    char path[50];
-    char option[5];
-    int nb_sleep;
-    int size = 1;
-    // Selon l'option choisi dans le menu
-    switch (opt_gstart){
-    case 1: // date
-        commande[0] = "date";
-        break;
-
-    case 2: // ls
-        printf("Vous avez choisis la commande \"ls\"\n");
-        printf("Veuillez indiquer quel répertoire vous voulez lister : \n");
-        printf("\tEntrez \"none\" pour le répertoire courant\n");
-        printf("\tSinon entrez le path\n");
-        scanf("%s", &path);
-        printf("Voulez vous ajouter une option? Si oui veuillez taper l'option sinon entrez \"none\"\n");
-        scanf("%s",&option);
-        printf("path %s\n",path);
-        printf("option %s\n",option);
-        commande[0] = "ls";
-        if(strcmp(path, "none") == 0){ // répertoire courant
-            if(strcmp(option, "none") != 0){ // pas d'option
-                commande[1] = option;
-                size = 2;
-            }
-        }else{ // autre répertoire
-            if(strcmp(option, "none") == 0){ // pas d'option
-                commande[1] = path;
-                size = 2;
-            }else{ // avec option
-                commande[1] = option;
-                commande[2] = path;
-                size = 3;
-            }
-        }
-        break;
-
-    case 3: // ps
-        printf("Vous avez choisis la commande \"ps\"\n");
-        printf("Voulez vous ajouter une option? Si oui veuillez taper l'option sinon entrez \"none\"\n");
-        scanf("%s",&option);
-        printf("\n");
-        if(strcmp(option, "none") == 0){ // pas d'option
-            commande[0] = "ps";
-        }else{ // avec option
-            commande[0] = "ps";
-            commande[1] = option;
-            size = 2;
-        }
-        break;
-        
-    case 4: // executable
-        printf("Vous avez choisis de lancer un exécutable\n");
-        printf("Veuillez entrer un nombre de secondes. Attention : Par défaut il sera à 2.\n");
-        scanf("%d", &nb_sleep);
-        if(nb_sleep < 2)    nb_sleep = 2;
-        char tmp[5];
-        sprintf(tmp,"%d",nb_sleep);
-        commande[0] = "./test";
-        commande[1] = tmp;
-        size = 2;
-        break;
-        
-    default:
-        printf("no good to be here \n");
-        break;
-    }
-
-    // Envoie la taille de la commande
-    MPI_Send(&size,1, MPI_INT, 1, TAG_GSTART, MPI_COMM_WORLD);
-    
-    // Envoie chaque élément de la commande
-    for(int i=0; i<size; i++){
-        MPI_Send(commande[i], strlen(commande[i])+1, MPI_CHAR, 1, TAG_GSTART_CMD, MPI_COMM_WORLD); 
-    }
-}
-
-
-/**
- * @brief test_gps - gestion de la fonction gps avant de l'envoyer dans le réseau
- * 
- */
-
-void test_gps(){
-    int option = 0;
-    char y_or_n[2];
-    
-    //demande à l'utilisateur s'il veut faire gps ou gps -l
-    do{
-        printf("Voulez-vous un affichage en format long ? (y/n)\n");
-        scanf("%s", &y_or_n);
-        if(strcmp(y_or_n, "y") == 0){
-            option = 1;
-            break;
-        }
-        if(strcmp(y_or_n, "n") == 0){
-            break;
-        }
-        printf("Nous n'avons pas compris votre commande.\n");
-    }while(1);
-    
-    if(option == 0){ // gps
-        printf("PID\tGPID\tCMD\n");
-    }else{  // gps -l
-        printf("HOST\t\tUID\tPID\tGPID\tCMD\tCPU\tMEM\n");
-    }
-
-    //Envoi un message en précisant le format d'affichage (option) à toutes les machines de type TAG_GPS
-    // pour leur dire d'afficher les processus courant de leur machine
-    for(int i = 1; i < nb_proc; i++){
-        MPI_Send(&option, 1, MPI_INT, i, TAG_GPS, MPI_COMM_WORLD);
-    }
-    sleep(1);
-}
-
-/**
- * @brief test_gkill - gestion de la fonction gskill avant de l'envoyer dans le réseau
- * 
- */
-
-void test_gkill(){
-   int sig;
-   int gpid;
-   int id_machine;
-   int tab_gkill[2];
-   char y_or_n[2];
-   
-    printf("Connaissez-vous le GPID du processus à qui vous allez envoyer un signal ? (y/n)\n");
-    scanf("%s", &y_or_n);
-    if(strcmp(y_or_n, "n") == 0 ){
-        printf("Vous devez passer par la commande \"gps\"\n");
-        //sleep(2);
-    }else{
-        do{
-            printf(" Liste des signaux:\n");
-            //system("kill -l");
-            printf(" 1) SIGHUP       2) SIGINT       3) SIGQUIT      4) SIGILL       5) SIGTRAP\n");
-            printf(" 6) SIGABRT      7) SIGBUS       8) SIGFPE       9) SIGKILL     10) SIGUSR1\n");
-            printf(" 11) SIGSEGV     12) SIGUSR2     13) SIGPIPE     14) SIGALRM     15) SIGTERM\n");
-            printf(" 16) SIGSTKFLT   17) SIGCHLD     18) SIGCONT     19) SIGSTOP     20) SIGTSTP\n");
-            printf(" 21) SIGTTIN     22) SIGTTOU     23) SIGURG      24) SIGXCPU     25) SIGXFSZ\n");
-            printf(" 26) SIGVTALRM   27) SIGPROF     28) SIGWINCH    29) SIGIO       30) SIGPWR\n");
-            printf(" 31) SIGSYS      34) SIGRTMIN    35) SIGRTMIN+1  36) SIGRTMIN+2  37) SIGRTMIN+3\n");
-            printf(" 38) SIGRTMIN+4  39) SIGRTMIN+5  40) SIGRTMIN+6  41) SIGRTMIN+7  42) SIGRTMIN+8\n");
-            printf(" 43) SIGRTMIN+9  44) SIGRTMIN+10 45) SIGRTMIN+11 46) SIGRTMIN+12 47) SIGRTMIN+13\n");
-            printf(" 48) SIGRTMIN+14 49) SIGRTMIN+15 50) SIGRTMAX-14 51) SIGRTMAX-13 52) SIGRTMAX-12\n");
-            printf(" 53) SIGRTMAX-11 54) SIGRTMAX-10 55) SIGRTMAX-9  56) SIGRTMAX-8  57) SIGRTMAX-7\n");
-            printf(" 58) SIGRTMAX-6  59) SIGRTMAX-5  60) SIGRTMAX-4  61) SIGRTMAX-3  62) SIGRTMAX-2\n");
-            printf(" 63) SIGRTMAX-1  64) SIGRTMAX\n");
-            printf("\nVeuillez entrer le numéro du signal: \n");
-            scanf("%d", &sig);
-            if(sig>0 && sig <= 64){ // vérification du numéro de signal entrer par l'utilisateur
-                break;
-            }
-            printf("\nNous n'avons pas compris le numéro que vous avez indiquer. Veuillez réessayer\n");
-        }while(1);
-        printf("Veuillez entrer le GPID \n");
-        scanf("%d", &gpid);
-        
-        // Tableau d'envoi contenant le numéro du signal ainsi que le gpid du processus auquel on veut envoyer un signal sig 
-        tab_gkill[0] = sig;
-        tab_gkill[1] = gpid;
-        
-        // envoyer la recherche a une machine participante car celle qui lance les test ne fait jamais de recv
-        if(rank != nb_proc - 1){
-            MPI_Send(tab_gkill, 2, MPI_INT, (rank+1)%nb_proc, TAG_RECHERCHE_GPID, MPI_COMM_WORLD);
-        }else{
-            MPI_Send(tab_gkill, 2, MPI_INT, 1, TAG_RECHERCHE_GPID, MPI_COMM_WORLD);
-        }
-    }
-}
-
-/**
- * @brief test_present - envoi un message à toutes les machines
- *                       A la reception de ce message, si la machine participe dans le réseau
- *                       elle devra faire un affichage (cf fonction receive TAG_PRESENT)
- *                       
- */
-
-void test_present(){
-    int k = 0;
-    for(int i = 1; i < nb_proc; i++){
-        MPI_Send(&k, 1, MPI_INT, i, TAG_PRESENT, MPI_COMM_WORLD);
-    }
-}
-/***************************************************************************************************
-                                               LANCER
-***************************************************************************************************/
-
-/**
- * @brief lancer_gstart - permet de générer un GPID unique, de notifier ce dernier à toutes les machines
- *                        et ensuite lance l'appel à la fonction gstart
- * 
- * @param argv         contient le nom de la commande [option] [arguments]
- */
-
-void lancer_gstart(char **argv){
-    int tab_gpid_indice[2];
-    int indice_process;
-    int gpid;
-    
-    // Génération du gpid
-    gpid = rank * 1000 + cpt_gpid; //l'unicité du gpid est garantit grâce à la valeur rank
-    cpt_gpid++;
-    
-    // recherche d'un emplacement disponible dans le tableau process
-    for(int i = 0; i < PROCESS_SIZE; i++){
-        if(process[i].pid == 0){
-            indice_process = i; // enregistre l'indice de cet emplacement
-            break;
-        }
-    }
-    
-    machines[rank][indice_process] = gpid; // enregistre le gpid dans le tableau machines
-   
-    // Tableau d'envoi contenant le gpid et l'indice de l'emplacement
-    tab_gpid_indice[0] = gpid;
-    tab_gpid_indice[1] = indice_process;
-   
-
-    // Envoi un message du GPID généré à toutes les machines participantes dans le réseau 
-    for(int i = 1; i < nb_proc; i++){
-        if((i!=rank) && (tab_participe[i] == 1)){
-            MPI_Send(tab_gpid_indice, 2, MPI_INT, i, TAG_GPID, MPI_COMM_WORLD);  
-        }
-    }
-    
-    // Création d'un processus + exécution de la tache
-    gstart(argv, gpid, indice_process);
-
-}
-
-
-/***************************************************************************************************
-                                                RECV
-***************************************************************************************************/
-
-/**
- * @brief receive - réceptions et traitements des différents messages
- * 
- */
- 
-
-void receive() {
-    int tab_gpid_indice[2]; //TAG_TRANSFERT, TAG_GPID
-    int tab_gkill[2];       //TAG_GKILL, TAG_GKILL_GPID
-    char* tab_transfert[2]; //TAG_TRANSFERT
-    int indice_process;     //TAG_GKILL
-    int size;               //TAG_GSTART, TAG_TRANSFERT
-    int size_cmd;           //TAG_GSTART
-    int option;             //TAG_GPS
-    int source;             //TAG_GSTART, TAG_GPS, TAG_TRANSFERT, TAG_LESS
-    //int gpid;
-    int id_machine;         //TAG_GSTART, TAG_INSERTION, TAG_LESS, TAG_END
-    int gkill_gpid[2];      //TAG_GKILL_GPID
-    int ok;                 //TAG_TRANSFERT
-    int k;                  //TAG_PRESENT
-    int end = 0;            //TAG_END
-    while(end == 0){
-
-        //sleep(5);
-        MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
-        switch (status.MPI_TAG){
-            case TAG_CHARGE:
-                // Récupère et enregistre la charge de la machine source
-                MPI_Recv(&tab_charge[status.MPI_SOURCE], 1, MPI_FLOAT, status.MPI_SOURCE, TAG_CHARGE, MPI_COMM_WORLD, &status);
-                break;
-
-            case TAG_GSTART:
-                source = status.MPI_SOURCE;
-                // Réception du nombre d'élément qu'on va recevoir après cette réception pour la commande
-                MPI_Recv(&size, 1, MPI_INT, source, TAG_GSTART,  MPI_COMM_WORLD, &status);
-                char** commande = malloc(sizeof(char*)*(size+1));
-
-                // Réception + enregistre dans la variable commande les informations de cette dernière
-                for(int i = 0; i < size; i++){
-                    MPI_Probe(source, TAG_GSTART_CMD, MPI_COMM_WORLD, &status);
-                    MPI_Get_count(&status, MPI_CHAR, &size_cmd);
-                    commande[i] = malloc(sizeof(char)*size_cmd);
-                    MPI_Recv(commande[i], size_cmd, MPI_CHAR, source, TAG_GSTART_CMD,  MPI_COMM_WORLD, &status);
-                }
-                commande[size] = NULL;
-                
-                
-                if(tab_participe[rank] == 0){ // si je ne participe plus
-                    // J'envoi au suivant
-                    MPI_Send(&size,1, MPI_INT,(rank+1)%nb_proc, TAG_GSTART,MPI_COMM_WORLD);
-                    for(int i=0; i<size; i++){
-                        if(rank != nb_proc - 1)
-                            MPI_Send(commande[i], strlen(commande[i])+1, MPI_CHAR, (rank+1)%nb_proc, TAG_GSTART_CMD, MPI_COMM_WORLD); 
-                        else
-                            MPI_Send(commande[i], strlen(commande[i])+1, MPI_CHAR, 1, TAG_GSTART_CMD, MPI_COMM_WORLD); 
-                    }
-                }else{
-                    // Sinon je suis participant
-                    //Récupère la machine l'identifiant de la machine la moins chargé du réseau
-                    id_machine = getIdMachineMoinsCharge();
-                    if(id_machine == rank){ // si je suis la machine la moins chargée du réseau
-                        lancer_gstart(commande);
-                    }else { // je ne suis pas la machine la moins chargée
-                            // c'est une autre machine du réseau soit id_machine
-                            // Envoi les informations de la commande à id_machine
-                        MPI_Send(&size,1, MPI_INT,id_machine, TAG_GSTART,MPI_COMM_WORLD);
-                        for(int i=0; i<size; i++){
-                            MPI_Send(commande[i], strlen(commande[i])+1, MPI_CHAR, id_machine, TAG_GSTART_CMD, MPI_COMM_WORLD); 
-                        }
-                    }
-                }
-
-                for(int i=0; i < size + 1; i++){ 
-                	free(commande[i]);
-                }
-                free(commande);
-
-                break;
-            
-            case TAG_GPID:
-                // Réception du gpid généré par la machine source
-                MPI_Recv(tab_gpid_indice, 2, MPI_INT, status.MPI_SOURCE, TAG_GPID, MPI_COMM_WORLD,&status); 
-                machines[status.MPI_SOURCE][tab_gpid_indice[1]] = tab_gpid_indice[0];
-                break;
-            
-            case TAG_GPS:
-                source = status.MPI_SOURCE;
-                // Réception du message GPS demandant de faire un affichage des processus courant dans ma machine
-                MPI_Recv(&option, 1, MPI_INT, source, TAG_GPS, MPI_COMM_WORLD, &status);
-                if(tab_participe[rank] == 1){ // si je suis participante 
-                    gps(option);              // appel à gps pour afficher
-                }
-                break;
-
-            case TAG_GKILL :
-                // Reception d'un message demandant d'envoyer un signal à un processus
-                // tab_gkill contient le numéro du signal et le gpid
-                MPI_Recv(tab_gkill, 2, MPI_INT, status.MPI_SOURCE, TAG_GKILL, MPI_COMM_WORLD, &status);
-                // Récupération du PID correspond au GPID
-                // de plus dans indice_process on récupère l'emplacement des informations du processus pid
-                int pid = getPID_gpid(tab_gkill[1],&indice_process); 
-                if(pid != 0){ // envoi un signal tab_gkill[0] à pid
-                    gkill(tab_gkill[0], pid, tab_gkill[1], indice_process);
-                }      
-                break;
-        
-            case TAG_GKILL_GPID :
-                // Réception de l'information que GPID (contenu dans gkill_gpid) de la machine source n'est plus là
-                MPI_Recv(gkill_gpid, 2, MPI_INT, status.MPI_SOURCE, TAG_GKILL_GPID, MPI_COMM_WORLD, &status);
-                recv_gkill(status.MPI_SOURCE, gkill_gpid[0], gkill_gpid[1]);
-                break;
-            
-            case TAG_RECHERCHE_GPID:
-                // Recherche du responsable du GPID 
-                MPI_Recv(tab_gkill, 2, MPI_INT, status.MPI_SOURCE, TAG_RECHERCHE_GPID, MPI_COMM_WORLD, &status);
-                if(tab_participe[rank] == 0){ // Je ne suis pas participant donc j'envoi à quelqu'un d'autre
-                    if(rank != nb_proc - 1)
-                        MPI_Send(tab_gkill, 2, MPI_INT, (rank+1)%nb_proc, TAG_RECHERCHE_GPID, MPI_COMM_WORLD);
-                    else
-                        MPI_Send(tab_gkill, 2, MPI_INT, 1, TAG_RECHERCHE_GPID, MPI_COMM_WORLD);
-                }else{ // Je suis participant
-                    id_machine = -1;
-                    // Parcours l'ensemble des machines du réseau
-                    for(int i = 1; i < nb_proc; i++){
-                        //if(tab_participe[i] == 1){
-                            //Parcours l'ensemble des processus de la machine 
-                            for(int j = 0; j < PROCESS_SIZE; j++){
-                                if(machines[i][j] == tab_gkill[1]){
-                                    id_machine = i;
-                                    break;
-                                }
-                            }
-                        //}
-                        if(id_machine != -1){
-                            break;
-                        }
-                    }
-                    MPI_Send(tab_gkill, 2, MPI_INT, id_machine, TAG_GKILL, MPI_COMM_WORLD);
-
-                    
-                }
-            case TAG_INSERTION :
-                // Reçoit l'id de la machine qui va rentrer dans le réseau
-                MPI_Recv(&id_machine, 1, MPI_INT, status.MPI_SOURCE, TAG_INSERTION, MPI_COMM_WORLD, &status);
-                tab_participe[id_machine] = 1;
-                // Si on est l'id de la machine
-                if(id_machine == rank)
-                    printf("%s JE M'INSERT DANS LE RESEAU!!!!!!!!!!!!\n",hostname);
-                break;
-
-            case TAG_TRANSFERT:
-                // On récupère le gpid et cmd en char* dans tab transfert
-                source = status.MPI_SOURCE;
-    
-                for(int k = 0; k < 2; k ++){
-                    if(k == 1)
-                        MPI_Probe(source, TAG_TRANSFERT, MPI_COMM_WORLD, &status);
-                    MPI_Get_count(&status, MPI_CHAR, &size);
-                    tab_transfert[k] = malloc(sizeof(char)*size);
-                    MPI_Recv(tab_transfert[k], size, MPI_CHAR, source, TAG_TRANSFERT, MPI_COMM_WORLD, &status);
-                }
-                ok = 0; // indique s'il y a encore de la palce dans la table des proccesus
-                
-                //Parcours la table des processus
-                for(int i = 0; i < PROCESS_SIZE; i++){
-
-                    // premier process non nulle
-                    if(process[i].gpid == 0) {
-                        int pid = fork();
-                        
-                        if(pid == 0){ // fait rien
-                            if(!execlp("ls","ls", NULL)){ // exec pour eviter que le fils ne finisse avant le père et fasse un finalize
-                                perror("gstart : execvp failed\n");
-                                exit(0);
-                            }
-                        } 
-                        //(process + i)->gpid = atoi(tab_transfert[0]);
-                        //(process + i)->cmd = strdup(tab_transfert[1]);
-                        //(process + i)->pid = pid;
-                        process[i].gpid = atoi(tab_transfert[0]);
-                        process[i].cmd = strdup(tab_transfert[1]);
-                        process[i].pid = pid;
-                        ok = 1;
-
-                        // prevenir l'existence du nouveau processus
-                        machines[rank][i] = process[i].gpid;
-                        tab_gpid_indice[0] = process[i].gpid;
-                        tab_gpid_indice[1] = i;
-
-                        // En informe tous les machines participantes
-                        for(int j = 1; j < nb_proc; j++){
-                            if((j!=rank) && (tab_participe[j] == 1)){
-                                MPI_Send(tab_gpid_indice, 2, MPI_INT, j, TAG_GPID, MPI_COMM_WORLD); // envoie  du gpid généré  
-                            }
-                        }
-                        break;
-                    }            
-                }
-
-                // DANS LE CAS PAS DE PLACE FAUT DETRUIRE LE MSG ET PREVENIR TLM
-                if(!ok){
-                    // comme non ok, alors ca veut dire que le processus n'a pas été recréé
-                    printf("%s : \n Recv - TAG_TRANSFERT : Impossible d'ajouter le processus dont le gpid est %s \n", hostname, tab_transfert[0]);
-                }
-                free(tab_transfert[0]);
-                free(tab_transfert[1]);
-                break;
-
-            case TAG_LESS:
-                // Réception de l'identifiant de la machine qui s'est retirée
-                source = status.MPI_SOURCE;
-                MPI_Recv(&id_machine, 1, MPI_INT , source, TAG_LESS, MPI_COMM_WORLD, &status);
-                tab_participe[id_machine] = 0; // enregistre du retrait de la machine id_machine
-                break;
-
-            case TAG_END:
-                // L'utilisateur a décider de quitter le menu
-                // La machine doit arrêter 
-                MPI_Recv(&id_machine, 1, MPI_INT, 0, TAG_END, MPI_COMM_WORLD, &status);
-             //   alarm(0);
-                end = 1;
-                break;
-            
-            case TAG_PRESENT:
-                // Réception d'un message de type TAG_PRESENT
-                // Si je suis participante alors j'affiche pour indiquer ma présence dans le réseau
-                MPI_Recv(&k, 1, MPI_INT, 0, TAG_PRESENT, MPI_COMM_WORLD, &status);
-                if(tab_participe[rank] == 1){
-                    printf("%s participe au réseau et à un serveur d'id %d\n",hostname,rank);
-                }
-                break;
-                
-            default:
-                printf("%s  Erreur : Ne doit pas arriver ici, tag %d\n", hostname, status.MPI_TAG);
-                break;
-        }
-    }
-}
-
-/***************************************************************************************************
-                                                MENU
-***************************************************************************************************/
-
-/*
-Fonction qui affiche le menu
-*/
-
-/**
- * @brief menu - Affichage du menu à l'utilisateur
- * 
- */
-
-void menu() {
-    int option;
-    char opt_gstart[50];
-    char quit[50];
-    
-    printf("Projet PSAR - Un répartiteur de charge pour des machines en réseau\n");
-    menu :
-        printf("\n~~~~ Commandes ~~~~\n");
-        printf("0 : Explication des commandes\n");
-        printf("1 : gstart\n");
-        printf("2 : gps [-l]\n");
-        printf("3 : gkill\n");
-        printf("4 : afficher les machines connecté sur le réseau\n");
-        printf("5 : Quitter le MENU\n");
-
-        printf("Entrez une option\n");
-        scanf("%d", &option);
-        printf("option vaut %d\n", option);
-        switch (option){
-            case 0:
-                printf("Explication des commandes : \n");
-                printf("----------------------------------------------------------------------------------------------------------------------------------\n");
-                printf("gstart : \n");
-                printf("\tCrée un processus exécutant “ prog arguments ” sur la machine la moins chargée du réseau.\n");
-                printf("\n\tprog :\n");
-                printf("\t\t0 - date : Affiche la date et l'heure actuelle.\n");
-                printf("\t\t1 - ls [arg] : Liste le contenu du répertoire selon les options préciser dans arg.\n");
-                printf("\t\t2 - ps [-l] : Liste les processus en cours d'exécution dans la machine la moins chargée (format standard ou format long avec -l).\n");
-                printf("\t\t3 - Tâche de X secondes.\n");
-                printf("\n");
-                printf("----------------------------------------------------------------------------------------------------------------------------------\n");
-                printf("gps : \n");
-                printf("\tSans l'option -l:\n");
-                printf("\t\tAffiche la liste de tous les processus qui ont été lancés sur le réseau.\n");
-                printf("\tAvec l'option -l:\n");
-                printf("\t\tAffiche un format long (noms executable, machine, uid, CPU, mémoire).\n");
-                printf("----------------------------------------------------------------------------------------------------------------------------------\n");
-                printf("gkill -sig gpid : \n");
-                printf("\tsig : identifiant d'un signal.\n");
-                printf("\tgpid : identifiant global unique sur le réseau d'un processus.\n");
-                printf("----------------------------------------------------------------------------------------------------------------------------------\n");
-
-                printf("\nEntrez une touche pour retourner dans le menu principal.\n");
-                scanf("%s", &quit);
-                goto menu;
-                break;
-                
-            case 1:
-                do{
-                    printf("Vous avez choisi la commande gstart.\n");
-                    printf("Entrer le nom d'une commande ou d'un exécutable que vous voulez exécuter:\n");
-                    printf("~~~~ Commandes ~~~~\n");
-                    printf("1 - date\n");
-                    printf("2 - ls [arg]\n");
-                    printf("3 - ps [-l]\n");
-                    printf("4 - Lancer une tâche de X seconde(s)\n");
-                    printf("5 - Retour au menu\n");
-                    printf("Veuillez entrer une valeur.\n");
-                    scanf("%s",&opt_gstart);
-                    int opt_gstart2 = atoi(opt_gstart);
-                    if( opt_gstart2 == 5) {
-                        goto menu;
-                    }else if( opt_gstart2>= 1 && opt_gstart2< 5){
-                        
-                        test_gstart(opt_gstart2);
-                        // sleep(2);
-                    }else {
-                        printf("Nous n'avons pas compris votre commande.\n");
-                        //sleep(2);
-                    }
-                }while(1);
-                break;
-
-            case 2:
-                printf("Vous avez choisi la commande gps.\n");
-                test_gps();
-                goto menu;
-                break;
-            case 3:
-                printf("Vous avez choisi gkill\n");
-                printf("Pour pouvoir faire gkill, vous devez connaitre les processus existants dans le réseau.\n");
-                test_gkill();
-                goto menu;
-                break;
-
-            case 4:
-                printf("Les machines présentes sur le réseau sont :\n");
-                test_present();
-                goto menu;
-                break;
-            case 5:
-                printf("Vous avez choisi de quitter le MENU\n");
-                printf("Merci et Au revoir :) \n");
-                for(int i = 1; i < nb_proc; i++){
-                    MPI_Send(&rank, 1, MPI_INT, i, TAG_END, MPI_COMM_WORLD);
-                }
-                break;
-
-            default:
-                printf("Nous n'avons pas compris votre commande.\nRetour au menu principal.\n");
-                goto menu;
-                break;
-        }
-}
-
-/***************************************************************************************************
-                                                MAIN
-***************************************************************************************************/
-
-int main (int argc, char* argv[]) {  
-    // Initialisation de notre programme
-    Init(argc, argv);
-
-    if(rank == 0){
-        menu();
-    }else{
-        signal(SIGALRM, &handler);
-        alarm(15);
-        receive();
-    }
-
-    // Finalisation de notre programme
-    Final();
-
-    return 0;
-}
-
-/*
--   La machine ajouter doit copier l'état d'une autre machine pour etre a jour
--   fct equilibrage pour surcharge : quand ajoute une machine il faut équilibrer 
--   gps manque CPU et MEM
+#define _GNU_SOURCE
+#ifndef SIMULATION
+#include <mpi.h>
+#else
+/* Simulateur (-DSIMULATION, cf SIMULATION) : pas de MPI, les serveurs sont des rangs virtuels d'un seul processus */
+#define MPI_MAX_PROCESSOR_NAME  256
+#define MPI_Finalize()          ((void) 0) // lire_options quitte sans rien avoir à finaliser
+#include <math.h>
+#include <sys/resource.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/types.h>
+#include <time.h>
+#include <signal.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <limits.h>
+#include <sys/signalfd.h>
+#include <spawn.h>
+#include <fnmatch.h>
+#include <ctype.h>
+#include <stddef.h>
+#include <pwd.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <sys/mman.h>
+#include <errno.h>
+
+/* Valeur à entrer */
+
+#define PROCESS_SIZE        64   // Capacité initiale de la table des processus (elle s'agrandit à la demande)
+#define NB_RECEPTIONS       16   // Nombre de réceptions pré-postées par le moteur de messages
+#define TAILLE_MESSAGE      65536 // Taille maximale d'un message en octets (hors vecteur des charges)
+#define ATTENTE_BOUCLE_US   200  // Pause de la boucle de réception quand aucun message n'est arrivé
+#define ATTENTE_ACTIVITE_US 1000 // Durée sans message après laquelle la boucle de réception recommence à faire des pauses
+#define CHARGE_PLACEMENT    0.1  // Charge estimée d'une tâche placée, tant que la machine n'a pas renvoyé sa charge
+#define POIDS_CPU           0.5  // Poids de l'utilisation CPU dans la charge composite
+#define POIDS_FILE          0.3  // Poids de la file d'exécution (par coeur) dans la charge composite
+#define POIDS_MEM           0.2  // Poids de la mémoire utilisée dans la charge composite
+#define HISTORIQUE_CHARGE   64   // Nombre d'échantillons de charge conservés
+#define ALPHA_CHARGE        0.3  // Poids du dernier échantillon dans la moyenne mobile exponentielle
+#define TAILLE_LECTURE_PROC 65536 // Taille du tampon de lecture des fichiers de /proc
+#define PERIODE_MONITEUR_MS 500  // Période par défaut du moniteur de charge (option --periode)
+#define TAILLE_FILE_MONITEUR 64  // Nombre de mesures que le moniteur peut avoir d'avance sur la boucle
+#define SIGNAL_CHECKPOINT   SIGUSR1 // Signal qui demande à une tâche d'écrire son état et de se terminer
+#define CODE_CHECKPOINT     75   // Code de sortie d'une tâche qui a écrit son état dans $LB_CHECKPOINT
+#define FENETRE_MIGRATION   32   // Nombre maximum d'envois en cours pendant l'envoi d'un checkpoint
+#define DELAI_CHECKPOINT_MS 30000 // Délai laissé à une tâche pour écrire son checkpoint, après quoi elle reste sur sa machine
+#define DELAI_GPS_MS        2000 // Attente maximale des réponses à un gps
+#define TAILLE_CMD_GPS      32   // Longueur maximale du nom de commande affiché par gps
+#define FENETRE_SOUMISSION  256  // Nombre maximum de gstart d'un lot en attente de leur gpid
+#define SEUIL_CAPACITE      0.9  // Charge estimée à partir de laquelle une machine ne reçoit plus de tâche (option --capacite)
+#define TAILLE_MAX_FILE     4096 // gstart en attente au-delà desquels une machine refuse les soumissions (option --attente)
+#define DELAI_REESSAI_MS    10   // Délai avant de resoumettre un gstart refusé, doublé à chaque refus consécutif
+#define DELAI_REESSAI_MAX_MS 1000 // Délai maximum entre deux soumissions d'un gstart refusé
+#define SURCHARGE_POURCENT  125  // Une machine entre en surcharge au-dessus de 125 % de la charge moyenne des participants
+#define RETOUR_POURCENT     110  // et n'en sort qu'en repassant sous 110 % (hystérésis)
+#define MIN_POURCENT        30   // Une machine sous 30 % de la charge moyenne se retire du réseau
+#define MESURES_RETRAIT     4    // Mesures consécutives en sous-charge avant de se retirer
+#define ECART_MIN_CHARGE    0.1  // Écart à la moyenne sous lequel on n'équilibre pas (bruit de mesure)
+#define REPOS_EQUILIBRAGE_MS 5000 // Délai avant que des tâches reçues d'une machine puissent lui être renvoyées (option --repos)
+#define MESURES_REPOS       2    // Mesures qu'une machine attend après ses dernières migrations avant d'équilibrer
+#define DELAI_METRIQUES_MS  1000 // Période d'écriture du fichier des métriques (option --metriques)
+#define SOUS_SEAUX_HISTO    8    // Seaux par puissance de 2 dans les histogrammes (3 bits significatifs, 12,5 %)
+#define NB_SEAUX_HISTO      312  // Seaux des histogrammes : de 1 ns à 2^41 ns (36 minutes)
+#define MAX_SAUTS           8    // Nombre de sauts d'un gstart comptés séparément (au-delà ils sont cumulés)
+#define SAUTS_PLACEMENT     MAX_SAUTS // Sauts après lesquels un gstart n'est plus replacé : il est lancé, ou attend, là où il arrive
+#define GPID_PAR_SERVEUR    256  // Processus par serveur prévus par l'annuaire partagé d'un noeud (il ne peut pas grandir)
+#define COORDINATEUR_VUE    1    // Rang qui ordonne les entrées et les sorties du réseau (cf Vue des participants)
+#define TAILLE_RENVOIS      1024 // Cases du cache des renvois (gpid partis de cette machine en migration)
+#define MAX_RENVOIS_GKILL   16   // Renvois d'un gkill au-delà desquels ses gpid sont déclarés introuvables
+#define DELAI_DEPART_MS     1000 // Délai entre deux demandes d'arrêt d'un serveur créé, vide et sorti de la vue (--elastique)
+#define DELAI_AMORCAGE_MS   5000 // Attente d'un bloc de l'instantané avant de le demander à un autre participant (cf AMORCAGE)
+#define MAX_AVIS_AMORCAGE   65536 // Mises à jour gardées pendant un amorçage, au-delà duquel on redemande un instantané
+#define ATTENTE_SAISIE_MS   50   // Rang 0 (--elastique) : attente de la saisie entre deux sondages des créations et arrêts de serveurs
+#define TAILLE_REGISTRE_MIN (1 << 20) // Taille initiale du fichier du registre des tâches (option --registre), doublée s'il est plein
+#define COMPACTION_MIN      4096 // Enregistrements du registre en plus de deux par processus présent avant de le compacter
+#define DELAI_REGISTRE_MS   200  // Période de vérification des processus repris et de la compaction du registre
+
+/* Simulateur (compilé avec -DSIMULATION, cf SIMULATION) : valeurs par défaut de ses options */
+
+#define SIM_RANGS           64   // Rangs simulés, rang 0 (soumission) compris (option --rangs)
+#define SIM_TACHES          1000 // gstart soumis par le rang 0 (option --taches)
+#define SIM_ARRIVEES        100  // gstart soumis par seconde (option --arrivees)
+#define SIM_DUREE_S         10   // Durée moyenne d'une tâche en secondes (option --duree)
+#define SIM_COEURS          4    // Coeurs de chaque machine (option --coeurs=min[-max])
+#define SIM_LATENCE_US      50   // Latence de base d'un message (option --latence)
+#define SIM_DEBIT_MO_S      1000 // Débit de l'interface de chaque rang (option --debit)
+#define SIM_TRAITEMENT_US   2    // Coût de traitement d'un message par un serveur (option --traitement)
+#define SIM_RAPPORT_MS      1000 // Période des lignes d'état (option --rapport)
+#define SIM_FIN_S           3600 // Date simulée maximale (option --fin)
+
+/* Niveaux du journal (option --log). Les appels au-dessus de NIVEAU_LOG_MAX ne sont pas compilés :
+   les messages de debug, écrits sur les chemins fréquents (gossip, lancements), n'existent que
+   dans un binaire compilé avec -DNIVEAU_LOG_MAX=LOG_DEBUG */
+
+#define LOG_ERREUR          0   // Erreurs
+#define LOG_INFO            1   // Événements rares : migrations, équilibrage, entrée et sortie du réseau
+#define LOG_DEBUG           2   // Chaque message de charge, chaque lancement, chaque fin de processus
+#ifndef NIVEAU_LOG_MAX
+#define NIVEAU_LOG_MAX      LOG_INFO
+#endif
+
+#define JOURNAL(niveau, ...) do{ if((niveau) <= NIVEAU_LOG_MAX && (niveau) <= niveau_log) printf(__VA_ARGS__); }while(0)
+
+/* Identifiant global d'un processus (gpid) sur 64 bits, qui encode la machine qui l'a lancé :
+     | 0 | rang d'origine (23 bits) | époque (8 bits) | séquence (32 bits) |
+   Le rang d'origine suffit pour trouver le processus : un gkill est envoyé directement à cette machine,
+   qui le fait suivre au propriétaire actuel si le processus a migré (cf Renvois des gpid). L'époque est
+   incrémentée quand la séquence fait le tour : deux gpid ne sont jamais égaux. Le gpid 0 n'existe pas. */
+
+typedef int64_t gpid_t;
+
+#define BITS_SEQUENCE_GPID  32
+#define BITS_EPOQUE_GPID    8
+#define GPID(rang, epoque, sequence)    (((gpid_t) (rang) << (BITS_EPOQUE_GPID + BITS_SEQUENCE_GPID)) \
+                                        | ((gpid_t) (epoque) << BITS_SEQUENCE_GPID) | (gpid_t) (sequence))
+#define GPID_RANG(gpid)     ((int) ((gpid) >> (BITS_EPOQUE_GPID + BITS_SEQUENCE_GPID)))
+#define GPID_EPOQUE(gpid)   ((int) (((gpid) >> BITS_SEQUENCE_GPID) & ((1 << BITS_EPOQUE_GPID) - 1)))
+#define GPID_SEQUENCE(gpid) ((uint32_t) (gpid))
+
+/* Structure d'un processus */
+
+
+/* États d'un processus */
+
+#define ETAT_ACTIF          0   // Le processus s'exécute sur cette machine
+#define ETAT_CHECKPOINT     1   // SIGNAL_CHECKPOINT envoyé, on attend que le processus se termine
+#define ETAT_ENVOI          2   // Le checkpoint est en cours d'envoi vers la machine cible
+#define ETAT_RECEPTION      3   // Un checkpoint est en cours de réception, le processus sera relancé à la fin
+
+struct process{
+    pid_t pid; 	                // Valeur du pid du processus   
+	gpid_t gpid;	            // Identifiant global unique sur le réseau
+	char *cmd;                  // Nom de la commande
+    char **argv;                // Commande complète, terminée par NULL (pour relancer le processus)
+    int suivant;                // Case libre suivante dans la liste des cases libres (-1 en fin de liste)
+    int etat;                   // ETAT_ACTIF, ETAT_CHECKPOINT, ETAT_ENVOI ou ETAT_RECEPTION
+    int cible;                  // Machine destinataire de la migration (ou émettrice, en réception)
+    int fd;                     // Fichier du checkpoint en cours d'envoi ou de réception
+    long long taille_checkpoint;    // Taille du checkpoint en octets
+    long long position_checkpoint;  // Octets déjà envoyés ou reçus
+    struct timespec debut_migration; // Date de la demande de checkpoint ou de l'arrivée de l'enveloppe
+    double limite_checkpoint_ms; // Date (maintenant_ms) à laquelle une demande de checkpoint sans réponse est abandonnée
+    struct timespec debut;      // Date du lancement du processus sur cette machine
+    int groupe;                 // Groupe donné au gstart (0 si aucun), pour les gkill groupés
+    unsigned long long depart;  // Date de démarrage selon le noyau (/proc/<pid>/stat) : reconnaît le processus après un redémarrage
+    int repris;                 // 1 si le processus a été repris au redémarrage du serveur (cf REGISTRE) : ce n'est pas notre fils
+    int signal;                 // Dernier signal envoyé par gkill (0 si aucun) : status de fin d'un processus repris
+}*process;                      // Table des processus, allouée et agrandie dynamiquement
+
+int process_capacite = 0;       // Nombre de cases de la table des processus
+int process_libre = -1;         // Première case libre de la table des processus
+
+/* Index pid -> case de la table des processus, pour nos fils (cf processus_termines) */
+
+struct case_pid{
+    pid_t pid;                  // pid d'un de nos fils (0 : case vide)
+    int indice;                 // Sa case dans la table process
+};
+
+struct case_pid *index_pid = NULL;  // Adressage ouvert, sondage linéaire, au plus à moitié plein
+int index_pid_capacite = 0;     // Nombre de cases de l'index (puissance de 2)
+int index_pid_nb = 0;           // Nombre de pid dans l'index
+
+/* Charge d'un serveur estampillée par sa version, échangée par le protocole de gossip */
+
+struct charge_versionnee{
+    float charge;               // Charge du serveur
+    int version;                // Numéro de l'échantillon, incrémenté par le serveur à chaque mesure
+};
+
+/* Enveloppe binaire d'une commande (TAG_GSTART, TAG_TRANSFERT) :
+   un en-tête de taille fixe suivi de argv, les chaînes terminées par '\0' mises bout à bout.
+   Une commande voyage toujours en un seul message. */
+
+struct enveloppe{
+    int32_t tag;                // TAG de la commande
+    int32_t flags;              // Paramètre propre à la commande (groupe du processus pour un gstart ou un transfert)
+    int32_t argc;               // Nombre d'arguments dans argv
+    int32_t taille_argv;        // Taille de argv en octets
+    int32_t demandeur;          // Rang à qui accuser le lancement d'un gstart (numero != 0)
+    int32_t numero;             // Numéro de soumission d'un gstart en lot (0 : pas d'accusé)
+    int32_t priorite;           // Priorité d'un gstart dans les files d'attente (la plus grande d'abord)
+    int32_t utilisateur;        // uid du soumetteur d'un gstart (partage équitable des files d'attente)
+    int32_t place;              // 1 si la machine qui fait suivre le gstart a choisi le destinataire
+    int32_t admis;              // 1 si le gstart est sorti d'une file d'attente : il ne peut plus être refusé
+    int32_t sauts;              // Nombre de fois qu'un serveur a fait suivre le gstart à un autre
+    int32_t epoque;             // Époque de la vue du dernier serveur qui a placé ou fait suivre la commande
+    int64_t gpid;               // gpid concerné (0 pour un gstart pas encore placé)
+    int64_t taille_donnees;     // Octets qui suivent dans des TAG_TRANSFERT_DONNEES (checkpoint d'un TAG_TRANSFERT)
+};
+
+/* Sélection des processus d'un gkill (TAG_RECHERCHE_GPID, TAG_GKILL) : un en-tête de taille fixe
+   suivi des gpid visés (SELECTION_GPID) ou du motif terminé par '\0' (SELECTION_MOTIF) */
+
+#define SELECTION_GPID      0   // Une liste de gpid
+#define SELECTION_GROUPE    1   // Tous les processus d'un groupe
+#define SELECTION_MOTIF     2   // Les processus dont le nom de commande correspond à un motif (fnmatch)
+
+struct selection{
+    int32_t signal;             // Numéro du signal à envoyer
+    int32_t type;               // SELECTION_GPID, SELECTION_GROUPE ou SELECTION_MOTIF
+    int32_t groupe;             // Groupe visé (SELECTION_GROUPE)
+    int32_t nb;                 // Nombre de gpid qui suivent, ou taille du motif avec son '\0'
+    int32_t renvois;            // Nombre de fois que la sélection a été renvoyée vers le propriétaire d'un gpid
+};
+
+/* Réponse à un gps (TAG_GPS_REPONSE) : un en-tête suivi d'une ligne de taille fixe par processus */
+
+struct entete_gps{
+    int32_t requete;            // Numéro de la requête gps à laquelle on répond
+    int32_t nb_lignes;          // Nombre de lignes qui suivent
+    int32_t uid;                // uid du serveur
+    int32_t en_attente;         // gstart dans la file d'attente du serveur
+    int32_t longueur_max;       // Longueur maximale atteinte par cette file
+    int64_t mis_en_file;        // gstart mis en file depuis le démarrage
+    int64_t distribues;         // gstart sortis de la file
+    int64_t refuses;            // gstart refusés car la file était pleine
+    float attente_moyenne_ms;   // Temps moyen passé dans la file par les gstart distribués
+    float attente_max_ms;       // Temps maximum passé dans la file
+    char hostname[MPI_MAX_PROCESSOR_NAME]; // Machine du serveur
+};
+
+struct ligne_gps{
+    int64_t gpid;               // Identifiant global du processus
+    int32_t pid;                // pid local (0 pendant une migration)
+    int32_t groupe;             // Groupe du processus
+    int32_t rang;               // Machine qui possède le processus
+    float cpu;                  // Utilisation CPU moyenne depuis le lancement, en % (gps -l)
+    float temps_cpu;            // Temps CPU utilisateur + système en secondes (gps -l)
+    int64_t rss;                // Mémoire résidente en Ko (gps -l)
+    char cmd[TAILLE_CMD_GPS];   // Nom de la commande (tronqué)
+};
+
+/* Structure d'une entrée de l'annuaire des gpid */
+
+struct entree_gpid{
+    gpid_t gpid;                // Identifiant global (0 si la case est vide)
+    int rang;                   // Rang de la machine qui possède le processus
+    int indice;                 // Indice du processus dans la table process de cette machine
+    pid_t pid;                  // pid local (connu seulement pour nos propres processus)
+};
+
+/* En-tête de l'annuaire, partagé avec lui par les serveurs d'un même noeud (cf NOEUD) */
+
+struct entete_annuaire{
+    atomic_uint sequence;       // Seqlock : impaire pendant une écriture, un lecteur recommence si elle a changé
+    atomic_flag verrou;         // Un seul écrivain à la fois (nos gpid et ceux annoncés au chef du noeud)
+    int nb;                     // Nombre de gpid enregistrés
+    int deborde;                // 1 dès qu'un serveur du noeud garde des gpid dans son débordement (cf annuaire_debordement)
+};
+
+/* Annuaire des gpid : table de hachage à adressage ouvert (sondage linéaire) */
+
+struct annuaire{
+    struct entree_gpid *cases;  // Tableau des entrées
+    int capacite;               // Nombre de cases, toujours une puissance de 2
+    int partage;                // 1 si l'annuaire est dans la fenêtre du noeud : sa capacité est fixe
+    struct entete_annuaire *entete;
+    struct annuaire *debordement; // Annuaire propre au serveur des gpid qui ne tiennent plus dans celui du noeud (NULL s'il n'a pas servi)
+}annuaire;
+
+/* Mise à jour de l'annuaire envoyée aux autres noeuds (TAG_GPID, TAG_GKILL_GPID, TAG_FIN_GPID) */
+
+struct avis_gpid{
+    int64_t gpid;               // gpid concerné
+    int32_t indice;             // Indice du processus dans la table process de l'émetteur
+    int32_t status;             // Status renvoyé par waitpid (TAG_FIN_GPID)
+    int32_t duree_ms;           // Durée d'exécution en ms (TAG_FIN_GPID)
+};
+
+/* Instantané de l'annuaire et des charges envoyé à un noeud qui s'amorce (TAG_ETAT, cf AMORCAGE) :
+   l'en-tête, nb_charges struct charge_versionnee puis nb_entrees struct entree_instantane */
+
+struct entete_instantane{
+    int64_t taille;             // Taille de l'instantané en octets, en-tête compris
+    int32_t nb_charges;         // Charges qui suivent (une par rang de l'émetteur)
+    int32_t nb_entrees;         // Entrées de l'annuaire qui suivent
+};
+
+struct entree_instantane{
+    int64_t gpid;               // gpid enregistré
+    int32_t rang;               // Machine qui possède le processus
+    int32_t indice;             // Indice du processus dans sa table process
+};
+
+/* Mise à jour de l'annuaire reçue pendant l'amorçage, rejouée après l'installation de l'instantané */
+
+struct avis_garde{
+    int tag;                    // TAG_GPID, TAG_GKILL_GPID ou TAG_FIN_GPID
+    int source;                 // Émetteur
+    struct avis_gpid avis;
+};
+
+struct{
+    int en_cours;               // 1 de la demande d'instantané à son installation
+    int pair;                   // Serveur qui nous envoie l'instantané
+    double debut_ms;            // Date de la première demande
+    double limite_ms;           // Date à laquelle, sans nouveau bloc, on demande l'instantané à un autre participant
+    int relances;               // Demandes refaites pendant cet amorçage (délai dépassé ou mises à jour trop nombreuses)
+    char *instantane;           // Instantané en cours de réception (NULL avant son premier bloc)
+    int64_t taille;             // Taille de l'instantané annoncée par son premier bloc
+    int64_t recu;               // Octets de l'instantané déjà reçus
+    struct avis_garde *avis;    // Mises à jour reçues pendant l'amorçage, dans leur ordre d'arrivée
+    int nb_avis;
+    int capacite_avis;
+    char *demandeurs;           // Rangs qui attendent notre instantané pendant notre propre amorçage
+}amorcage;
+
+/* Renvoi laissé par une migration : le processus est parti de cette machine vers rang */
+
+struct renvoi{
+    gpid_t gpid;                // gpid parti (0 si la case est vide)
+    int rang;                   // Machine à qui le processus a été transféré
+}*renvois;                      // Cache de TAILLE_RENVOIS cases, une par valeur de hachage (cf Renvois des gpid)
+
+/* Registre des tâches (option --registre) : un en-tête puis des enregistrements ajoutés à la suite (cf REGISTRE) */
+
+#define MAGIQUE_REGISTRE    0x4c42524547000001ULL
+
+#define REG_LANCE           1   // Processus lancé sur cette machine (valeur : groupe), suivi de ses argc arguments
+#define REG_FIN             2   // Processus terminé
+#define REG_SIGNAL          3   // Signal envoyé par gkill (valeur : signal)
+#define REG_TRANSFERT       4   // Processus transféré par une migration (valeur : machine qui l'a reçu)
+#define REG_COMPTEUR        5   // Séquence des gpid seule, écrite en tête du registre compacté
+
+struct entete_registre{
+    uint64_t magique;           // MAGIQUE_REGISTRE
+    int32_t rang;               // Serveur qui a écrit le registre
+    int32_t reserve;
+};
+
+struct enregistrement{
+    uint32_t taille;            // Taille de l'enregistrement, arguments compris (multiple de 8, 0 en fin de registre)
+    int32_t type;               // REG_LANCE, REG_FIN, REG_SIGNAL, REG_TRANSFERT ou REG_COMPTEUR
+    int64_t gpid;
+    uint64_t depart;            // Date de démarrage du processus (cf depart_processus)
+    int32_t pid;
+    int32_t valeur;             // Groupe, signal ou machine, selon le type
+    uint32_t cpt_gpid;          // Séquence et époque des gpid au moment de l'enregistrement
+    int32_t epoque_gpid;
+    int32_t argc;               // Nombre d'arguments qui suivent (REG_LANCE)
+    int32_t reserve;
+};
+
+/* TAG */
+
+#define TAG_TEST            0   // juste utiliser pour faire des tests
+#define TAG_GSTART          1   // msg qui indique de faire un gstart (enveloppe avec la commande)
+#define TAG_GPS             3   // msg qui indique de faire un gps (option, numéro de requête)
+#define TAG_GKILL           4   // msg qui indique de faire un gkill sur ses processus (sélection)
+#define TAG_GKILL_GPID      5   // msg qui indique de retirer un certain gpid de sa matrice de processus
+#define TAG_CHARGE          6   // msg pour la mise à jour de la charge 
+#define TAG_GPID            7   // msg qui comporte le gpid que l'on doit ajouter à sa matrice de processus
+#define TAG_RECHERCHE_GPID  8   // msg qui demande de diffuser un gkill de groupe ou de motif aux participants (sélection)
+#define TAG_VUE_DEMANDE     9   // msg qui demande au coordinateur de faire entrer ou sortir une machine (struct demande_vue)
+#define TAG_TRANSFERT       10  // msg qui porte le processus à transmettre à une autre machine (enveloppe)
+#define TAG_VUE             11  // msg qui porte une nouvelle vue des participants (époque puis un octet par rang)
+#define TAG_END             12  // msg qui indique au processus de ce terminer
+#define TAG_PRESENT         13  // msg qui demande à un processus s'il est présent dans le réseau
+#define TAG_TRANSFERT_DONNEES 14 // msg qui porte un bloc du checkpoint d'un processus transféré
+#define TAG_FIN_GPID        15  // msg qui indique qu'un gpid s'est terminé (gpid, indice, status, durée en ms)
+#define TAG_GPS_REPONSE     16  // msg qui porte la liste des processus d'une machine en réponse à un gps
+#define TAG_GSTART_ACK      17  // msg qui accuse un gstart soumis avec un numéro (struct accuse_gstart)
+#define TAG_EQUILIBRAGE     18  // msg qui propose des tâches à une machine moins chargée (nombre de tâches)
+#define TAG_EQUILIBRAGE_REPONSE 19 // msg qui porte le nombre de tâches acceptées en réponse à TAG_EQUILIBRAGE
+#define TAG_AGRANDIR        20  // msg du coordinateur : tous les rangs créent ensemble un serveur (struct redimensionnement)
+#define TAG_RETRECIR        21  // msg du coordinateur : le dernier serveur créé s'arrête (struct redimensionnement)
+#define TAG_ADIEU           22  // dernier msg échangé avec le serveur qui s'arrête
+#define TAG_ETAT_DEMANDE    23  // msg qui demande un instantané de l'annuaire et des charges (amorçage d'un noeud)
+#define TAG_ETAT            24  // msg qui porte un bloc de l'instantané (struct entete_instantane, charges puis entrées)
+#define TAG_MIGRATION_ABANDON 25 // msg qui annonce à la cible qu'une migration promise n'aura pas lieu ou que son checkpoint est perdu (gpid)
+#define NB_TAGS             26  // Nombre de TAG (compteurs des métriques)
+
+/* Réponses à un gstart soumis avec un numéro (TAG_GSTART_ACK) */
+
+#define ACCUSE_LANCE        0   // Le processus est lancé, gpid attribué
+#define ACCUSE_EN_FILE      1   // Toutes les machines sont saturées : le gstart attend dans une file, un ACCUSE_LANCE suivra
+#define ACCUSE_REFUSE       2   // La file de la machine est pleine : le demandeur doit resoumettre plus tard
+
+struct accuse_gstart{
+    int32_t numero;             // Numéro de soumission du gstart
+    int32_t etat;               // ACCUSE_LANCE, ACCUSE_EN_FILE ou ACCUSE_REFUSE
+    int32_t longueur_file;      // gstart en attente sur la machine qui répond
+    int64_t gpid;               // gpid attribué (ACCUSE_LANCE), sinon 0
+};
+
+/* Demande de changement de la vue des participants (TAG_VUE_DEMANDE) */
+
+#define VUE_INSERTION       0   // Faire entrer le premier rang qui ne participe pas
+#define VUE_RETRAIT         1   // Faire sortir le rang demandeur
+#define VUE_DEPART          2   // Arrêter le rang demandeur : dernier serveur créé, vide et sorti de la vue (--elastique)
+
+struct demande_vue{
+    int32_t type;               // VUE_INSERTION, VUE_RETRAIT ou VUE_DEPART
+    int32_t rang;               // Rang qui sort (VUE_RETRAIT, VUE_DEPART)
+    int32_t epoque;             // Époque de la vue sur laquelle le demandeur a décidé
+    int64_t date_us;            // Date murale de la surcharge qui motive une VUE_INSERTION (mesure de l'agrandissement)
+};
+
+/* Création ou arrêt d'un serveur (TAG_AGRANDIR, TAG_RETRECIR, cf ELASTICITE) */
+
+struct redimensionnement{
+    int32_t rang;               // Rang du serveur créé ou arrêté
+    int64_t date_us;            // Date murale de la surcharge qui a fait créer le serveur
+};
+
+/* Variables locales*/
+
+uint32_t cpt_gpid = 1;                                      // Séquence du prochain gpid lancé par ce serveur
+int epoque_gpid = 0;                                        // Époque des gpid, incrémentée quand cpt_gpid fait le tour
+float* tab_charge;                                          // Tableau des charges de l'ensemble des serveurs participants au réseau P2P
+                                                            // indice de chaque case correspond au rang (identifiant) de la machine
+int* tab_version;                                           // Version de chaque charge de tab_charge (0 si jamais reçue)
+atomic_uint* tab_sequence;                                  // Seqlock de chaque case de tab_charge / tab_version (cf charge_lire)
+int* tab_chef;                                              // Chef du noeud de chaque serveur, seul à faire le gossip pour son noeud (cf NOEUD)
+struct charge_versionnee* tampon_gossip;                    // Vecteur des charges envoyé et reçu avec TAG_CHARGE
+int tour_gossip = 0;                                        // Numéro du prochain tour de gossip
+float charge_globale;                                       // Moyenne des charges  
+int* tab_participe;                                         // Tableau de booléen qui indique si le serveur (rank) est actif dans le réseau
+int epoque_vue = 0;                                         // Époque de tab_participe, incrémentée par le coordinateur à chaque changement
+
+/* Politiques de placement (option --placement) */
+
+#define PLACEMENT_MIN           0   // La machine la moins chargée (argmin)
+#define PLACEMENT_DEUX_CHOIX    1   // Deux machines tirées au hasard, on garde la moins chargée
+#define PLACEMENT_PONDERE       2   // Tirage aléatoire pondéré par l'inverse de la charge
+
+int politique_placement = PLACEMENT_MIN;                    // Politique utilisée par getIdMachineMoinsCharge
+int periode_moniteur_ms = PERIODE_MONITEUR_MS;              // Période de mesure de la charge (option --periode)
+int equilibrage = 0;                                        // 1 si le contrôleur d'équilibrage tourne à chaque mesure (option --equilibrage)
+int repos_equilibrage_ms = REPOS_EQUILIBRAGE_MS;            // Repos après un équilibrage (option --repos)
+char* repertoire_checkpoint = "/tmp";                       // Répertoire des checkpoints des migrations (option --checkpoint)
+int nb_migrations = 0;                                      // Nombre de processus en cours de migration (envoi ou réception)
+int fd_fils = -1;                                           // signalfd qui reçoit les SIGCHLD de nos processus
+sigset_t masque_fils;                                       // { SIGCHLD }, bloqué dans tous les threads du serveur
+char* repertoire_sorties = NULL;                            // Répertoire des sorties des tâches (option --sorties), NULL pour hériter des nôtres
+char* fichier_lot = NULL;                                   // Fichier des commandes à soumettre (option --lot, "-" pour l'entrée standard)
+float seuil_capacite = SEUIL_CAPACITE;                      // Charge estimée d'une machine saturée (option --capacite)
+int taille_max_file = TAILLE_MAX_FILE;                      // Longueur de la file d'attente au-delà de laquelle on refuse (option --attente)
+int niveau_log = LOG_INFO;                                  // Niveau du journal (option --log), borné par NIVEAU_LOG_MAX
+int elastique = 0;                                          // Serveurs que le coordinateur peut créer avec MPI_Comm_spawn (option --elastique)
+char* repertoire_metriques = NULL;                          // Répertoire du fichier des métriques (option --metriques), NULL sans export
+char* repertoire_registre = NULL;                           // Répertoire du registre des tâches (option --registre), NULL sans registre
+
+/* File d'attente des gstart quand toutes les machines sont saturées */
+
+struct tache_en_attente{
+    char *msg;                  // Copie de l'enveloppe TAG_GSTART reçue, refaite suivre telle quelle
+    int taille;                 // Taille de l'enveloppe
+    int priorite;               // Priorité du gstart
+    long long arrivee;          // Rang d'arrivée dans la file (FIFO à priorité égale)
+    struct timespec date;       // Date d'entrée dans la file
+};
+
+struct file_utilisateur{
+    int uid;                            // Utilisateur
+    double servi;                       // Tâches distribuées, rattrapé sur les autres utilisateurs quand il revient
+    struct tache_en_attente *taches;    // Tas binaire : priorité décroissante puis arrivée croissante
+    int nb;                             // Nombre de tâches en attente
+    int capacite;                       // Capacité du tas
+};
+
+struct{
+    struct file_utilisateur *utilisateurs;  // Une file par utilisateur rencontré
+    int nb_utilisateurs;
+    int capacite_utilisateurs;
+    int nb;                     // Nombre total de gstart en attente
+    long long arrivees;         // Compteur des arrivées
+    int longueur_max;           // Métriques : longueur maximale atteinte
+    long long mis_en_file;      //             gstart mis en file
+    long long distribues;       //             gstart sortis de la file
+    long long refuses;          //             gstart refusés, file pleine
+    double attente_totale_ms;   //             somme des temps passés dans la file
+    double attente_max_ms;      //             temps maximum passé dans la file
+}file_attente;
+
+/* Contrôleur d'équilibrage (option --equilibrage) */
+
+struct echange{
+    int en_cours;               // Tâches en migration avec ce pair, dans un sens ou dans l'autre
+    int demande;                // 1 si on attend sa réponse à une proposition d'équilibrage
+    double envoi_ms;            // Date de notre dernier envoi de tâches à ce pair (0 : jamais)
+    double reception_ms;        // Date de notre dernière acceptation de ses tâches (0 : jamais)
+    float charge_promise;       // Charge des tâches qu'on a acceptées de ce pair à cette date
+    int nb_promis;              // Nombre de ces tâches (une migration abandonnée en retire une, cf recv_migration_abandon)
+};
+
+struct controleur{
+    int en_surcharge;           // Hystérésis : passe à 1 au-dessus de SURCHARGE_POURCENT, à 0 sous RETOUR_POURCENT
+    int mesures_sous_charge;    // Mesures consécutives sous MIN_POURCENT de la moyenne
+    double repos_ms;            // Date avant laquelle on ne propose pas d'équilibrage
+    struct echange *echanges;   // Échanges avec chaque pair, indicé par rang
+}controleur;
+
+struct demande_equilibrage{
+    int cible;                  // Machine à qui proposer des tâches
+    int nb;                     // Nombre de tâches proposées
+};
+int* tab_en_attente;                                        // Placements envoyés à chaque machine depuis sa dernière charge reçue
+int* version_en_attente;                                    // Version de la charge de chaque machine à laquelle tab_en_attente se rapporte
+
+/* Variables MPI */
+
+int nb_proc;                                    // Nombre de serveurs dans le réseau
+int nb_max;                                     // Capacité des tables indicées par rang : nb_proc de départ + elastique
+int rank;                                       // Identifiant du serveur dans le serveur P2P
+char hostname[MPI_MAX_PROCESSOR_NAME];          // Nom de la machine sur lequel tourne le serveur
+int length_hostname;                            // Taille du nom de la machine
+
+
+void notifyCharge(float charge);
+float getCharge();
+float CalculCharge();
+float charge_estimee(int i);
+void controleur_init(struct controleur *c, int nb);
+void souscharge();
+void transfert_tache(int id_machine, int nb);
+float charge_par_tache(int nb_taches);
+int taches_migrables();
+void echantillonneur_ouvrir();
+void echantillonneur_fermer();
+void lanceur_init();
+void lanceur_fermer();
+int gkill(int signal, int pid, gpid_t gpid, int p);
+double maintenant_ms();
+int lancer_processus(int indice_process, const char *restauration);
+int signaler_processus(int indice_process, int signal);
+void annoncer_gpid(gpid_t gpid, int indice_process);
+void retirer_processus(int indice_process);
+void terminer_processus(int indice_process, int status);
+void migration_retirer(int indice_process);
+void reception_perdre(int indice_process);
+void reception_terminer(int indice_process);
+void recv_demande_vue(const struct demande_vue *d);
+void demander_vue(int type, int rang);
+static inline void charge_lire(int i, struct charge_versionnee *c);
+static inline void charge_ecrire(int i, float charge, int version);
+int elastique_progresser();
+void recv_gkill(int rank, gpid_t gpid, int p);
+void recv_fin(int rang, const struct avis_gpid *avis);
+int noeud_participe(const char *participe);
+void amorcage_commencer(const char *ancienne);
+void amorcage_init();
+void amorcage_progresser();
+unsigned long long depart_processus(pid_t pid);
+void registre_noter(int type, int indice_process, int valeur);
+void registre_ouvrir();
+void registre_fermer();
+
+/***************************************************************************************************
+                                        Annuaire des gpid
+***************************************************************************************************/
+
+/**
+ * @brief annuaire_hash - calcule la case de départ d'un gpid (hachage multiplicatif de Fibonacci)
+ * 
+ * @param a         annuaire
+ * @param gpid      identifiant global
+ * @return int      indice de la première case à sonder
+ */
+
+static inline int annuaire_hash(const struct annuaire *a, gpid_t gpid){
+    return (int)((((uint64_t) gpid * 11400714819323198485ull) >> 32) & (uint64_t) (a->capacite - 1));
+}
+
+/**
+ * @brief annuaire_plein - 1 si un gpid de plus dépasserait le taux de remplissage de 70% (sondages courts)
+ */
+
+static inline int annuaire_plein(const struct annuaire *a){
+    return (a->entete->nb + 1) * 10 > a->capacite * 7;
+}
+
+/**
+ * @brief annuaire_init - alloue un annuaire vide, propre au serveur
+ * 
+ * @param a         annuaire à initialiser
+ * @param capacite  nombre de cases (puissance de 2)
+ */
+
+void annuaire_init(struct annuaire *a, int capacite){
+    a->cases = (struct entree_gpid *) calloc(capacite, sizeof(struct entree_gpid));
+    a->entete = (struct entete_annuaire *) malloc(sizeof(struct entete_annuaire));
+    if(!a->cases || !a->entete){
+        perror("annuaire_init");
+        exit(1);
+    }
+    atomic_init(&a->entete->sequence, 0);
+    atomic_flag_clear(&a->entete->verrou);
+    a->entete->nb = 0;
+    a->entete->deborde = 0;
+    a->capacite = capacite;
+    a->partage = 0;
+    a->debordement = NULL;
+}
+
+/**
+ * @brief annuaire_debordement - annuaire propre au serveur qui reçoit les gpid quand celui du noeud est plein.
+ *                               Il est alloué à son premier usage et grandit comme un annuaire privé.
+ *                               Appelée entre annuaire_ecrire_debut et annuaire_ecrire_fin.
+ * 
+ * @return struct annuaire*     l'annuaire de débordement
+ */
+
+struct annuaire* annuaire_debordement(){
+    if(annuaire.debordement == NULL){
+        annuaire.debordement = (struct annuaire *) malloc(sizeof(struct annuaire));
+        if(!annuaire.debordement){
+            perror("annuaire_debordement");
+            exit(1);
+        }
+        annuaire_init(annuaire.debordement, 16);
+        annuaire.entete->deborde = 1;
+        JOURNAL(LOG_INFO, "%s : annuaire du noeud plein (%d gpid), ce serveur garde les suivants pour lui\n", hostname,
+                annuaire.entete->nb);
+    }
+    return annuaire.debordement;
+}
+
+/**
+ * @brief annuaire_ecrire_debut / annuaire_ecrire_fin - encadrent une écriture : on prend le verrou des
+ *                                                      écrivains et la séquence est impaire pendant l'écriture
+ * 
+ */
+
+void annuaire_ecrire_debut(){
+    while(atomic_flag_test_and_set_explicit(&annuaire.entete->verrou, memory_order_acquire))
+        ;
+    atomic_fetch_add_explicit(&annuaire.entete->sequence, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+void annuaire_ecrire_fin(){
+    atomic_fetch_add_explicit(&annuaire.entete->sequence, 1, memory_order_release);
+    atomic_flag_clear_explicit(&annuaire.entete->verrou, memory_order_release);
+}
+
+/**
+ * @brief annuaire_chercher - recherche l'entrée d'un gpid (écrivain seulement, cf annuaire_lire)
+ * 
+ * @param a                     annuaire
+ * @param gpid                  identifiant global recherché
+ * @return struct entree_gpid*  l'entrée, ou NULL si le gpid est inconnu
+ */
+
+struct entree_gpid* annuaire_chercher(struct annuaire *a, gpid_t gpid){
+    int masque = a->capacite - 1;
+    // On sonde jusqu'à la première case vide : elle termine la chaîne
+    for(int i = annuaire_hash(a, gpid); a->cases[i].gpid != 0; i = (i + 1) & masque){
+        if(a->cases[i].gpid == gpid)
+            return &a->cases[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief annuaire_lire - copie l'entrée d'un gpid. Un autre serveur du noeud peut écrire dans l'annuaire
+ *                        pendant la lecture : on recommence tant que la séquence était impaire ou a changé.
+ *                        Un gpid absent est ensuite cherché dans notre débordement, qu'on est seul à écrire.
+ * 
+ * @param gpid      identifiant global recherché
+ * @param copie     reçoit l'entrée
+ * @return int      1 si le gpid est connu, sinon 0
+ */
+
+int annuaire_lire(gpid_t gpid, struct entree_gpid *copie){
+    unsigned int sequence;
+    int trouve;
+
+    do{
+        sequence = atomic_load_explicit(&annuaire.entete->sequence, memory_order_acquire);
+        struct entree_gpid *e = annuaire_chercher(&annuaire, gpid);
+        trouve = (e != NULL);
+        if(trouve)
+            *copie = *e;
+        atomic_thread_fence(memory_order_acquire);
+    }while((sequence & 1) || atomic_load_explicit(&annuaire.entete->sequence, memory_order_relaxed) != sequence);
+
+    if(!trouve && annuaire.debordement != NULL){
+        struct entree_gpid *e = annuaire_chercher(annuaire.debordement, gpid);
+        trouve = (e != NULL);
+        if(trouve)
+            *copie = *e;
+    }
+    return trouve;
+}
+
+/**
+ * @brief annuaire_agrandir - double la capacité d'un annuaire propre au serveur et y réinsère les entrées
+ * 
+ * @param a         annuaire à agrandir
+ */
+
+void annuaire_agrandir(struct annuaire *a){
+    struct entree_gpid *anciennes = a->cases;
+    int ancienne_capacite = a->capacite;
+
+    a->cases = (struct entree_gpid *) calloc(ancienne_capacite * 2, sizeof(struct entree_gpid));
+    if(!a->cases){
+        perror("annuaire_agrandir");
+        exit(1);
+    }
+    a->capacite = ancienne_capacite * 2;
+    int masque = a->capacite - 1;
+    for(int k = 0; k < ancienne_capacite; k++){
+        if(anciennes[k].gpid == 0)
+            continue;
+        int i = annuaire_hash(a, anciennes[k].gpid);
+        while(a->cases[i].gpid != 0)
+            i = (i + 1) & masque;
+        a->cases[i] = anciennes[k];
+    }
+    free(anciennes);
+}
+
+/**
+ * @brief annuaire_placer - réserve la case d'un nouveau gpid (un annuaire propre au serveur grandit
+ *                          s'il le faut)
+ * 
+ * @param a                     annuaire
+ * @param gpid                  identifiant global, absent de l'annuaire
+ * @return struct entree_gpid*  la case, dont seul le gpid est rempli
+ */
+
+struct entree_gpid* annuaire_placer(struct annuaire *a, gpid_t gpid){
+    if(!a->partage && annuaire_plein(a))
+        annuaire_agrandir(a);
+    int masque = a->capacite - 1;
+    int i = annuaire_hash(a, gpid);
+    while(a->cases[i].gpid != 0)
+        i = (i + 1) & masque;
+    a->cases[i].gpid = gpid;
+    a->entete->nb++;
+    return &a->cases[i];
+}
+
+/**
+ * @brief annuaire_ajouter - enregistre ou met à jour sur place le propriétaire d'un gpid. Quand
+ *                           l'annuaire du noeud est plein, le gpid va dans notre débordement.
+ * 
+ * @param gpid      identifiant global
+ * @param rang      machine qui possède le processus
+ * @param indice    indice du processus dans la table process de cette machine
+ * @param pid       pid local (0 si le processus est sur une autre machine)
+ */
+
+void annuaire_ajouter(gpid_t gpid, int rang, int indice, pid_t pid){
+    annuaire_ecrire_debut();
+    struct entree_gpid *e = annuaire_chercher(&annuaire, gpid);
+    if(e == NULL && annuaire.debordement != NULL)
+        e = annuaire_chercher(annuaire.debordement, gpid);
+
+    if(e == NULL){
+        // L'annuaire du noeud ne peut pas grandir : on garde le gpid pour nous plutôt que de le perdre
+        if(annuaire.partage && annuaire_plein(&annuaire))
+            e = annuaire_placer(annuaire_debordement(), gpid);
+        else
+            e = annuaire_placer(&annuaire, gpid);
+    }
+    e->rang = rang;
+    e->indice = indice;
+    e->pid = pid;
+    annuaire_ecrire_fin();
+}
+
+/**
+ * @brief annuaire_effacer - efface une entrée d'un annuaire (écrivain seulement)
+ * 
+ * @param a         annuaire
+ * @param e         entrée à effacer
+ */
+
+void annuaire_effacer(struct annuaire *a, struct entree_gpid *e){
+    // Suppression par décalage arrière : pas de pierre tombale, les chaînes restent compactes
+    int masque = a->capacite - 1;
+    int vide = (int)(e - a->cases);
+    int i = vide;
+    while(1){
+        i = (i + 1) & masque;
+        if(a->cases[i].gpid == 0)
+            break;
+        int origine = annuaire_hash(a, a->cases[i].gpid);
+        // On déplace l'entrée i dans le trou si sa case d'origine n'est pas entre le trou et i
+        if(((i - origine) & masque) >= ((i - vide) & masque)){
+            a->cases[vide] = a->cases[i];
+            vide = i;
+        }
+    }
+    a->cases[vide].gpid = 0;
+    a->entete->nb--;
+}
+
+/**
+ * @brief annuaire_retirer - retire un gpid de l'annuaire s'il appartient toujours à rang
+ *                           (un TAG_GKILL_GPID en retard ne doit pas effacer un processus transféré)
+ * 
+ * @param gpid      identifiant global à retirer
+ * @param rang      machine qui annonce le retrait
+ */
+
+void annuaire_retirer(gpid_t gpid, int rang){
+    annuaire_ecrire_debut();
+    struct entree_gpid *e = annuaire_chercher(&annuaire, gpid);
+    if(e != NULL && e->rang == rang)
+        annuaire_effacer(&annuaire, e);
+    // Le débordement peut garder une entrée que l'annuaire du noeud a depuis reçue d'un voisin
+    if(annuaire.debordement != NULL && (e = annuaire_chercher(annuaire.debordement, gpid)) != NULL && e->rang == rang)
+        annuaire_effacer(annuaire.debordement, e);
+    annuaire_ecrire_fin();
+}
+
+/**
+ * @brief annuaire_remplacer_distants - remplace d'une seule écriture les gpid des autres noeuds par ceux
+ *                                      d'un instantané (cf AMORCAGE). Ceux de notre noeud, que ses serveurs
+ *                                      écrivent eux-mêmes, sont gardés et l'emportent sur l'instantané.
+ * 
+ * @param entrees   entrées de l'instantané
+ * @param nb        nombre d'entrées
+ * @return int      nombre d'entrées gardées dans notre débordement faute de place (annuaire du noeud plein)
+ */
+
+int annuaire_remplacer_distants(const struct entree_instantane *entrees, int nb){
+    int nb_locales = 0;
+    int debordees = 0;
+
+    annuaire_ecrire_debut();
+    struct entree_gpid *locales = (struct entree_gpid *) malloc((annuaire.entete->nb + 1) * sizeof(struct entree_gpid));
+    if(!locales){
+        perror("annuaire_remplacer_distants");
+        exit(1);
+    }
+    for(int k = 0; k < annuaire.capacite; k++){
+        if(annuaire.cases[k].gpid != 0 && tab_chef[annuaire.cases[k].rang] == tab_chef[rank])
+            locales[nb_locales++] = annuaire.cases[k];
+    }
+    // Une entrée effacée peut être remplacée par la suivante : on ne passe à la case suivante qu'après l'avoir gardée
+    struct annuaire *d = annuaire.debordement;
+    for(int k = 0; d != NULL && k < d->capacite; ){
+        if(d->cases[k].gpid != 0 && tab_chef[d->cases[k].rang] != tab_chef[rank])
+            annuaire_effacer(d, &d->cases[k]);
+        else
+            k++;
+    }
+
+    // Un annuaire propre au serveur prend d'emblée la capacité de l'instantané, celui du noeud est fixe
+    int capacite = annuaire.capacite;
+    while(!annuaire.partage && ((long long) nb_locales + nb) * 10 > (long long) capacite * 7)
+        capacite *= 2;
+    if(capacite != annuaire.capacite){
+        free(annuaire.cases);
+        annuaire.cases = (struct entree_gpid *) calloc(capacite, sizeof(struct entree_gpid));
+        if(!annuaire.cases){
+            perror("annuaire_remplacer_distants");
+            exit(1);
+        }
+        annuaire.capacite = capacite;
+    }else{
+        memset(annuaire.cases, 0, capacite * sizeof(struct entree_gpid));
+    }
+
+    int masque = annuaire.capacite - 1;
+    for(int k = 0; k < nb_locales; k++){
+        int i = annuaire_hash(&annuaire, locales[k].gpid);
+        while(annuaire.cases[i].gpid != 0)
+            i = (i + 1) & masque;
+        annuaire.cases[i] = locales[k];
+    }
+    annuaire.entete->nb = nb_locales;
+    for(int k = 0; k < nb; k++){
+        int r = entrees[k].rang;
+        if(entrees[k].gpid == 0 || r < 1 || r >= nb_proc || tab_chef[r] == tab_chef[rank])
+            continue;
+        if(annuaire_chercher(&annuaire, entrees[k].gpid) != NULL)
+            continue;
+        struct entree_gpid *e;
+        if(annuaire.partage && annuaire_plein(&annuaire)){
+            if(annuaire_chercher(annuaire_debordement(), entrees[k].gpid) != NULL)
+                continue;
+            e = annuaire_placer(annuaire.debordement, entrees[k].gpid);
+            debordees++;
+        }else{
+            e = annuaire_placer(&annuaire, entrees[k].gpid);
+        }
+        e->rang = r;
+        e->indice = entrees[k].indice;
+        e->pid = 0;
+    }
+    annuaire_ecrire_fin();
+    free(locales);
+    return debordees;
+}
+
+/***************************************************************************************************
+                                        Renvois des gpid
+***************************************************************************************************/
+
+/*
+ * Un gkill ne demande plus le propriétaire d'un gpid à un tiers : le menu l'envoie directement à la
+ * machine d'origine du gpid (GPID_RANG), qui signale le processus s'il n'a pas migré. Sinon, chaque
+ * machine fait suivre le gpid :
+ *  - au propriétaire que donne son annuaire (les migrations y sont annoncées par TAG_GPID) ;
+ *  - à défaut, au renvoi laissé par la migration qui a fait partir le processus de chez elle : une
+ *    machine qui ne participe plus, ou dont l'annuaire n'a pas encore reçu l'annonce, suit ainsi le
+ *    processus de proche en proche (au plus MAX_RENVOIS_GKILL fois).
+ * Le cache des renvois est petit et sans chaînage : un renvoi remplace celui qui occupait sa case.
+ */
+
+/**
+ * @brief renvoi_case - case du cache des renvois d'un gpid
+ * 
+ * @param gpid      identifiant global
+ * @return int      indice de la case
+ */
+
+static inline int renvoi_case(gpid_t gpid){
+    return (int)((((uint64_t) gpid * 11400714819323198485ull) >> 32) & (TAILLE_RENVOIS - 1));
+}
+
+/**
+ * @brief renvois_init - alloue un cache des renvois vide
+ * 
+ */
+
+void renvois_init(){
+    renvois = (struct renvoi *) calloc(TAILLE_RENVOIS, sizeof(struct renvoi));
+    if(!renvois){
+        perror("renvois_init");
+        exit(1);
+    }
+}
+
+/**
+ * @brief renvoi_noter - retient qu'un processus est parti de cette machine vers rang
+ * 
+ * @param gpid      identifiant global du processus transféré
+ * @param rang      machine qui l'a reçu
+ */
+
+void renvoi_noter(gpid_t gpid, int rang){
+    struct renvoi *r = &renvois[renvoi_case(gpid)];
+    r->gpid = gpid;
+    r->rang = rang;
+}
+
+/**
+ * @brief renvoi_oublier - oublie le renvoi d'un gpid (processus revenu chez nous ou terminé)
+ * 
+ * @param gpid      identifiant global
+ */
+
+void renvoi_oublier(gpid_t gpid){
+    struct renvoi *r = &renvois[renvoi_case(gpid)];
+    if(r->gpid == gpid)
+        r->gpid = 0;
+}
+
+/**
+ * @brief gpid_destination - machine à qui adresser un gkill pour un gpid
+ * 
+ * @param gpid      identifiant global
+ * @param e         reçoit l'entrée de l'annuaire quand le processus est chez nous
+ * @return int      rank si le processus est chez nous, la machine à qui le faire suivre, ou -1 s'il est inconnu
+ */
+
+int gpid_destination(gpid_t gpid, struct entree_gpid *e){
+    if(annuaire_lire(gpid, e))
+        return e->rang;
+    struct renvoi *r = &renvois[renvoi_case(gpid)];
+    if(r->gpid == gpid)
+        return r->rang;
+    // L'annuaire du noeud a débordé : le chef, qui reçoit les annonces des autres noeuds, a pu le garder pour lui
+    if(annuaire.entete->deborde && tab_chef[rank] != rank)
+        return tab_chef[rank];
+    return -1;
+}
+
+/***************************************************************************************************
+                                    Table des processus
+***************************************************************************************************/
+
+/**
+ * @brief process_agrandir - double la table des processus et chaîne les nouvelles cases
+ *                           dans la liste des cases libres
+ * 
+ */
+
+void process_agrandir(){
+    int nouvelle_capacite = process_capacite ? process_capacite * 2 : PROCESS_SIZE;
+    struct process *t = (struct process *) realloc(process, nouvelle_capacite * sizeof(struct process));
+    if(!t){
+        perror("process_agrandir");
+        exit(1);
+    }
+    process = t;
+
+    // Les nouvelles cases sont ajoutées en tête de la liste des cases libres, dans l'ordre
+    for(int i = nouvelle_capacite - 1; i >= process_capacite; i--){
+        process[i].pid = 0;
+        process[i].gpid = 0;
+        process[i].cmd = NULL;
+        process[i].argv = NULL;
+        process[i].etat = ETAT_ACTIF;
+        process[i].repris = 0;
+        process[i].signal = 0;
+        process[i].suivant = process_libre;
+        process_libre = i;
+    }
+    process_capacite = nouvelle_capacite;
+}
+
+/**
+ * @brief process_allouer - réserve une case libre de la table des processus en O(1)
+ * 
+ * @return int      indice de la case réservée
+ */
+
+int process_allouer(){
+    if(process_libre == -1)
+        process_agrandir();
+    int i = process_libre;
+    process_libre = process[i].suivant;
+    process[i].suivant = -1;
+    return i;
+}
+
+/**
+ * @brief process_liberer - vide une case de la table des processus et la rend à la liste des cases libres
+ * 
+ * @param i         indice de la case à libérer
+ */
+
+void process_liberer(int i){
+    free(process[i].cmd);
+    if(process[i].argv != NULL){
+        for(int k = 0; process[i].argv[k] != NULL; k++)
+            free(process[i].argv[k]);
+        free(process[i].argv);
+    }
+    process[i].pid = 0;
+    process[i].gpid = 0;
+    process[i].cmd = NULL;
+    process[i].argv = NULL;
+    process[i].etat = ETAT_ACTIF;
+    process[i].repris = 0;
+    process[i].signal = 0;
+    process[i].suivant = process_libre;
+    process_libre = i;
+}
+
+/**
+ * @brief argv_dupliquer - copie un tableau d'arguments terminé par NULL (libéré par process_liberer)
+ * 
+ * @param argv      arguments à copier
+ * @return char**   copie des arguments
+ */
+
+char** argv_dupliquer(char **argv){
+    int argc = 0;
+    while(argv[argc] != NULL)
+        argc++;
+    char **copie = (char **) malloc((argc + 1) * sizeof(char *));
+    if(!copie){
+        perror("argv_dupliquer");
+        exit(1);
+    }
+    for(int i = 0; i < argc; i++)
+        copie[i] = strdup(argv[i]);
+    copie[argc] = NULL;
+    return copie;
+}
+
+/**
+ * @brief index_pid_hash - case de départ d'un pid dans l'index des pid (hachage multiplicatif de Fibonacci)
+ * 
+ * @param pid       pid d'un de nos fils
+ * @return int      indice de la première case à sonder
+ */
+
+static inline int index_pid_hash(pid_t pid){
+    return (int)((((uint64_t) (uint32_t) pid * 11400714819323198485ull) >> 32) & (uint64_t) (index_pid_capacite - 1));
+}
+
+/**
+ * @brief index_pid_case - case d'un pid dans l'index : la sienne, ou la case vide où l'ajouter
+ * 
+ * @param pid       pid d'un de nos fils
+ * @return int      indice de la case
+ */
+
+static inline int index_pid_case(pid_t pid){
+    int masque = index_pid_capacite - 1;
+    int i = index_pid_hash(pid);
+    while(index_pid[i].pid != 0 && index_pid[i].pid != pid)
+        i = (i + 1) & masque;
+    return i;
+}
+
+/**
+ * @brief index_pid_ajouter - enregistre la case d'un fils qui vient d'être lancé (l'index double
+ *                            quand il est à moitié plein)
+ * 
+ * @param pid       pid du fils
+ * @param indice    sa case dans la table process
+ */
+
+void index_pid_ajouter(pid_t pid, int indice){
+    if(2 * (index_pid_nb + 1) > index_pid_capacite){
+        struct case_pid *anciennes = index_pid;
+        int ancienne_capacite = index_pid_capacite;
+        index_pid_capacite = ancienne_capacite ? ancienne_capacite * 2 : PROCESS_SIZE;
+        index_pid = (struct case_pid *) calloc(index_pid_capacite, sizeof(struct case_pid));
+        if(!index_pid){
+            perror("index_pid_ajouter");
+            exit(1);
+        }
+        for(int k = 0; k < ancienne_capacite; k++){
+            if(anciennes[k].pid != 0)
+                index_pid[index_pid_case(anciennes[k].pid)] = anciennes[k];
+        }
+        free(anciennes);
+    }
+    int i = index_pid_case(pid);
+    index_pid_nb += index_pid[i].pid == 0;
+    index_pid[i].pid = pid;
+    index_pid[i].indice = indice;
+}
+
+/**
+ * @brief index_pid_retirer - retire un fils récupéré par waitpid de l'index
+ * 
+ * @param pid       pid du fils
+ * @return int      la case qu'il occupait dans la table process, -1 s'il n'est pas dans l'index
+ */
+
+int index_pid_retirer(pid_t pid){
+    if(index_pid_nb == 0)
+        return -1;
+    int masque = index_pid_capacite - 1;
+    int vide = index_pid_case(pid);
+    if(index_pid[vide].pid == 0)
+        return -1;
+    int indice = index_pid[vide].indice;
+
+    // Suppression par décalage arrière, comme dans l'annuaire (cf annuaire_effacer)
+    int i = vide;
+    while(1){
+        i = (i + 1) & masque;
+        if(index_pid[i].pid == 0)
+            break;
+        int origine = index_pid_hash(index_pid[i].pid);
+        if(((i - origine) & masque) >= ((i - vide) & masque)){
+            index_pid[vide] = index_pid[i];
+            vide = i;
+        }
+    }
+    index_pid[vide].pid = 0;
+    index_pid_nb--;
+    return indice;
+}
+
+/***************************************************************************************************
+                                            METRIQUES
+***************************************************************************************************/
+
+/*
+ * Chaque serveur tient ses métriques dans une seule structure, modifiée et lue par la boucle
+ * d'événements uniquement (le moniteur ne fait que déposer ses mesures dans sa file) : il n'y a
+ * ni verrou ni opération atomique sur le chemin des messages, un compteur coûte une incrémentation.
+ * Avec --metriques=répertoire, la boucle réécrit toutes les DELAI_METRIQUES_MS le fichier
+ * répertoire/lb-<rang>.prom au format texte de Prometheus (écriture dans un fichier temporaire
+ * puis rename, le lecteur ne voit jamais un fichier à moitié écrit) : le collecteur « textfile »
+ * de node_exporter le publie tel quel.
+ *
+ * Les durées sont rangées dans des histogrammes log-linéaires (à la HdrHistogram) : SOUS_SEAUX_HISTO
+ * seaux par puissance de 2, donc une erreur relative d'au plus 12,5 % sur toute la plage, sans
+ * allocation ni calcul flottant à l'ajout.
+ */
+
+/* Décisions de placement d'un gstart */
+
+#define DECISION_LOCAL      0   // Lancé sur cette machine
+#define DECISION_TRANSMIS   1   // Placé sur une autre machine et transmis
+#define DECISION_RELAIS     2   // Transmis sans placement (on ne participe pas)
+#define DECISION_FILE       3   // Mis dans notre file d'attente (réseau saturé)
+#define DECISION_REFUS      4   // Refusé (file d'attente pleine)
+#define NB_DECISIONS        5
+
+struct histogramme{
+    uint64_t seaux[NB_SEAUX_HISTO]; // Nombre de valeurs par seau (cf histo_seau)
+    uint64_t nb;                    // Nombre de valeurs
+    uint64_t somme;                 // Somme des valeurs
+    uint64_t max;                   // Plus grande valeur
+};
+
+struct metriques{
+    uint64_t messages_recus[NB_TAGS];           // Messages reçus par TAG
+    uint64_t octets_recus[NB_TAGS];             // Octets reçus par TAG
+    uint64_t messages_envoyes[NB_TAGS];         // Messages envoyés par TAG
+    uint64_t octets_envoyes[NB_TAGS];           // Octets envoyés par TAG
+    struct histogramme traitement[NB_TAGS];     // Durée de traitement des messages par TAG (ns)
+    uint64_t sauts_gstart[MAX_SAUTS + 1];       // gstart lancés ici selon leur nombre de sauts
+    int sauts_max;                              // Plus grand nombre de sauts d'un gstart lancé ici
+    uint64_t placements[NB_DECISIONS];          // Décisions de placement des gstart
+    uint64_t migrations_envoyees;               // Processus transférés vers une autre machine
+    uint64_t migrations_recues;                 // Processus reçus d'une autre machine
+    uint64_t migrations_abandonnees;            // Processus terminés avant d'avoir écrit leur checkpoint, ou qui ne l'ont pas écrit à temps
+    uint64_t octets_migres_envoyes;             // Octets de checkpoint envoyés
+    uint64_t octets_migres_recus;               // Octets de checkpoint reçus
+    uint64_t gkill_renvoyes;                    // gpid d'un gkill que l'on a fait suivre à leur propriétaire
+    double agrandissement_ms;                   // Serveur créé : de la surcharge à son premier processus (0 sinon)
+    struct histogramme duree_envoi;             // Durée d'une migration sortante, du signal à la fin de l'envoi (ns)
+    struct histogramme duree_reception;         // Durée d'une migration entrante, de l'enveloppe au dernier bloc (ns)
+    struct histogramme duree_amorcage;          // Amorçage du noeud, de la demande d'instantané à la fin du rejeu (ns)
+    uint64_t prochain_export_ns;                // Date de la prochaine écriture du fichier
+}metriques;
+
+const char* noms_tags[NB_TAGS] = {"test", "gstart", "inconnu", "gps", "gkill", "gkill_gpid", "charge", "gpid",
+                                  "recherche_gpid", "vue_demande", "transfert", "vue", "end", "present",
+                                  "transfert_donnees", "fin_gpid", "gps_reponse", "gstart_ack", "equilibrage",
+                                  "equilibrage_reponse", "agrandir", "retrecir", "adieu", "etat_demande", "etat",
+                                  "migration_abandon"};
+const char* noms_decisions[NB_DECISIONS] = {"local", "transmis", "relais", "file", "refus"};
+
+/**
+ * @brief horloge_ns - date monotone en nanosecondes
+ */
+
+static inline uint64_t horloge_ns(){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+/**
+ * @brief date_murale_us - date murale en microsecondes, comparable entre processus (cf agrandissement_ms)
+ */
+
+static inline int64_t date_murale_us(){
+    struct timespec t;
+    clock_gettime(CLOCK_REALTIME, &t);
+    return (int64_t) t.tv_sec * 1000000 + t.tv_nsec / 1000;
+}
+
+/**
+ * @brief histo_seau - seau d'une valeur : les valeurs sous SOUS_SEAUX_HISTO ont chacune le leur,
+ *                     au-delà chaque puissance de 2 est coupée en SOUS_SEAUX_HISTO seaux égaux
+ * 
+ * @param v         valeur
+ * @return int      indice du seau
+ */
+
+static inline int histo_seau(uint64_t v){
+    if(v < SOUS_SEAUX_HISTO)
+        return (int) v;
+    int puissance = 63 - __builtin_clzll(v);                // v est dans [2^puissance, 2^(puissance+1)[
+    int decalage = puissance - 3;                           // 2^3 = SOUS_SEAUX_HISTO
+    int s = SOUS_SEAUX_HISTO + decalage * SOUS_SEAUX_HISTO + (int) ((v >> decalage) - SOUS_SEAUX_HISTO);
+    return s < NB_SEAUX_HISTO ? s : NB_SEAUX_HISTO - 1;
+}
+
+/**
+ * @brief histo_borne - plus grande valeur rangée dans le seau s
+ */
+
+static inline uint64_t histo_borne(int s){
+    if(s < SOUS_SEAUX_HISTO)
+        return s;
+    int decalage = (s - SOUS_SEAUX_HISTO) / SOUS_SEAUX_HISTO;
+    uint64_t debut = (uint64_t) (SOUS_SEAUX_HISTO + (s - SOUS_SEAUX_HISTO) % SOUS_SEAUX_HISTO) << decalage;
+    return debut + (1ULL << decalage) - 1;
+}
+
+static inline void histo_ajouter(struct histogramme *h, uint64_t v){
+    h->seaux[histo_seau(v)]++;
+    h->nb++;
+    h->somme += v;
+    if(v > h->max)
+        h->max = v;
+}
+
+/**
+ * @brief histo_quantile - valeur sous laquelle se trouve la proportion q des valeurs (borne de son seau)
+ */
+
+uint64_t histo_quantile(const struct histogramme *h, double q){
+    uint64_t rang_q = (uint64_t) (q * h->nb + 0.5);
+    uint64_t cumul = 0;
+
+    if(h->nb == 0)
+        return 0;
+    if(rang_q < 1)
+        rang_q = 1;
+    for(int s = 0; s < NB_SEAUX_HISTO; s++){
+        cumul += h->seaux[s];
+        if(cumul >= rang_q)
+            return histo_borne(s) < h->max ? histo_borne(s) : h->max;
+    }
+    return h->max;
+}
+
+/**
+ * @brief metrique_envoi / metrique_reception - comptent un message envoyé, ou reçu et traité
+ */
+
+static inline void metrique_envoi(int tag, int taille){
+    if(tag >= 0 && tag < NB_TAGS){
+        metriques.messages_envoyes[tag]++;
+        metriques.octets_envoyes[tag] += taille;
+    }
+}
+
+static inline void metrique_reception(int tag, int taille, uint64_t duree_ns){
+    if(tag >= 0 && tag < NB_TAGS){
+        metriques.messages_recus[tag]++;
+        metriques.octets_recus[tag] += taille;
+        histo_ajouter(&metriques.traitement[tag], duree_ns);
+    }
+}
+
+/**
+ * @brief ecrire_histo - écrit un histogramme au format Prometheus, en secondes, avec une borne par
+ *                       puissance de 2 de nanosecondes à partir de 2^8 ns (les bornes d'une série ne
+ *                       changent pas d'une écriture à l'autre)
+ * 
+ * @param f         fichier
+ * @param nom       nom de la métrique
+ * @param etiquettes étiquettes de la série, sans accolades
+ * @param h         histogramme
+ */
+
+void ecrire_histo(FILE *f, const char *nom, const char *etiquettes, const struct histogramme *h){
+    uint64_t cumul = 0;
+    int s = 0;
+
+    for(int puissance = 8; puissance <= 40; puissance++){
+        // Les seaux sous histo_seau(2^puissance) contiennent exactement les valeurs < 2^puissance
+        int fin = histo_seau(1ULL << puissance);
+        for(; s < fin; s++)
+            cumul += h->seaux[s];
+        fprintf(f, "%s_bucket{%s,le=\"%.9g\"} %llu\n", nom, etiquettes, (double) (1ULL << puissance) / 1e9,
+                (unsigned long long) cumul);
+    }
+    fprintf(f, "%s_bucket{%s,le=\"+Inf\"} %llu\n", nom, etiquettes, (unsigned long long) h->nb);
+    fprintf(f, "%s_sum{%s} %.9f\n", nom, etiquettes, h->somme / 1e9);
+    fprintf(f, "%s_count{%s} %llu\n", nom, etiquettes, (unsigned long long) h->nb);
+}
+
+/**
+ * @brief ecrire_compteurs_tags - écrit un compteur par TAG (les TAG jamais vus sont omis)
+ */
+
+void ecrire_compteurs_tags(FILE *f, const char *nom, const char *aide, const uint64_t *valeurs){
+    fprintf(f, "# HELP %s %s\n# TYPE %s counter\n", nom, aide, nom);
+    for(int t = 0; t < NB_TAGS; t++){
+        if(valeurs[t] > 0)
+            fprintf(f, "%s{rang=\"%d\",tag=\"%s\"} %llu\n", nom, rank, noms_tags[t], (unsigned long long) valeurs[t]);
+    }
+}
+
+/**
+ * @brief metriques_exporter - réécrit repertoire_metriques/lb-<rang>.prom
+ * 
+ */
+
+void metriques_exporter(){
+    char chemin[PATH_MAX], temporaire[PATH_MAX], etiquettes[64];
+    struct metriques *m = &metriques;
+
+    snprintf(chemin, sizeof(chemin), "%s/lb-%d.prom", repertoire_metriques, rank);
+    snprintf(temporaire, sizeof(temporaire), "%s/.lb-%d.prom.tmp", repertoire_metriques, rank);
+    FILE *f = fopen(temporaire, "w");
+    if(f == NULL){
+        perror(temporaire);
+        repertoire_metriques = NULL;    // on n'insiste pas à chaque écriture
+        return;
+    }
+
+    ecrire_compteurs_tags(f, "lb_messages_recus_total", "Messages reçus par TAG", m->messages_recus);
+    ecrire_compteurs_tags(f, "lb_octets_recus_total", "Octets reçus par TAG", m->octets_recus);
+    ecrire_compteurs_tags(f, "lb_messages_envoyes_total", "Messages envoyés par TAG", m->messages_envoyes);
+    ecrire_compteurs_tags(f, "lb_octets_envoyes_total", "Octets envoyés par TAG", m->octets_envoyes);
+
+    fprintf(f, "# HELP lb_traitement_secondes Durée de traitement d'un message reçu\n# TYPE lb_traitement_secondes histogram\n");
+    for(int t = 0; t < NB_TAGS; t++){
+        if(m->traitement[t].nb == 0)
+            continue;
+        snprintf(etiquettes, sizeof(etiquettes), "rang=\"%d\",tag=\"%s\"", rank, noms_tags[t]);
+        ecrire_histo(f, "lb_traitement_secondes", etiquettes, &m->traitement[t]);
+    }
+
+    fprintf(f, "# HELP lb_gstart_lances_total gstart lancés sur cette machine, par nombre de sauts entre serveurs\n"
+               "# TYPE lb_gstart_lances_total counter\n");
+    for(int k = 0; k <= MAX_SAUTS; k++)
+        fprintf(f, "lb_gstart_lances_total{rang=\"%d\",sauts=\"%d%s\"} %llu\n", rank, k, k == MAX_SAUTS ? "+" : "",
+                (unsigned long long) m->sauts_gstart[k]);
+
+    fprintf(f, "# HELP lb_placements_total Décisions de placement des gstart reçus\n# TYPE lb_placements_total counter\n");
+    for(int d = 0; d < NB_DECISIONS; d++)
+        fprintf(f, "lb_placements_total{rang=\"%d\",decision=\"%s\"} %llu\n", rank, noms_decisions[d],
+                (unsigned long long) m->placements[d]);
+
+    fprintf(f, "# HELP lb_migrations_total Migrations terminées\n# TYPE lb_migrations_total counter\n");
+    fprintf(f, "lb_migrations_total{rang=\"%d\",sens=\"envoi\"} %llu\n", rank, (unsigned long long) m->migrations_envoyees);
+    fprintf(f, "lb_migrations_total{rang=\"%d\",sens=\"reception\"} %llu\n", rank, (unsigned long long) m->migrations_recues);
+    fprintf(f, "# HELP lb_migrations_abandonnees_total Processus terminés avant d'avoir écrit leur checkpoint, ou qui ne l'ont pas écrit à temps\n"
+               "# TYPE lb_migrations_abandonnees_total counter\n");
+    fprintf(f, "lb_migrations_abandonnees_total{rang=\"%d\"} %llu\n", rank, (unsigned long long) m->migrations_abandonnees);
+    fprintf(f, "# HELP lb_migrations_octets_total Octets de checkpoint transférés\n# TYPE lb_migrations_octets_total counter\n");
+    fprintf(f, "lb_migrations_octets_total{rang=\"%d\",sens=\"envoi\"} %llu\n", rank, (unsigned long long) m->octets_migres_envoyes);
+    fprintf(f, "lb_migrations_octets_total{rang=\"%d\",sens=\"reception\"} %llu\n", rank, (unsigned long long) m->octets_migres_recus);
+    fprintf(f, "# HELP lb_migration_secondes Durée d'une migration\n# TYPE lb_migration_secondes histogram\n");
+    snprintf(etiquettes, sizeof(etiquettes), "rang=\"%d\",sens=\"envoi\"", rank);
+    ecrire_histo(f, "lb_migration_secondes", etiquettes, &m->duree_envoi);
+    snprintf(etiquettes, sizeof(etiquettes), "rang=\"%d\",sens=\"reception\"", rank);
+    ecrire_histo(f, "lb_migration_secondes", etiquettes, &m->duree_reception);
+    fprintf(f, "# HELP lb_gkill_renvoyes_total gpid d'un gkill que l'on a fait suivre à leur propriétaire\n"
+               "# TYPE lb_gkill_renvoyes_total counter\n");
+    fprintf(f, "lb_gkill_renvoyes_total{rang=\"%d\"} %llu\n", rank, (unsigned long long) m->gkill_renvoyes);
+    if(m->duree_amorcage.nb > 0){
+        fprintf(f, "# HELP lb_amorcage_secondes Amorçage du noeud : instantané de l'annuaire reçu, installé et rejoué\n"
+                   "# TYPE lb_amorcage_secondes histogram\n");
+        snprintf(etiquettes, sizeof(etiquettes), "rang=\"%d\"", rank);
+        ecrire_histo(f, "lb_amorcage_secondes", etiquettes, &m->duree_amorcage);
+    }
+    if(m->agrandissement_ms > 0)
+        fprintf(f, "# HELP lb_agrandissement_secondes Serveur créé : de la surcharge à son premier processus\n"
+                   "# TYPE lb_agrandissement_secondes gauge\nlb_agrandissement_secondes{rang=\"%d\"} %.6f\n",
+                rank, m->agrandissement_ms / 1e3);
+
+    fprintf(f, "# HELP lb_charge Charge mesurée de la machine\n# TYPE lb_charge gauge\nlb_charge{rang=\"%d\"} %f\n",
+            rank, tab_charge[rank]);
+    fprintf(f, "# HELP lb_file_attente gstart en attente dans la file de la machine\n# TYPE lb_file_attente gauge\n"
+               "lb_file_attente{rang=\"%d\"} %d\n", rank, file_attente.nb);
+
+    if(fclose(f) != 0 || rename(temporaire, chemin) != 0){
+        perror(chemin);
+        repertoire_metriques = NULL;
+    }
+}
+
+/**
+ * @brief metriques_progresser - écrit le fichier des métriques quand DELAI_METRIQUES_MS est écoulé
+ *                               (boucle d'événements)
+ * 
+ */
+
+void metriques_progresser(){
+    if(repertoire_metriques == NULL)
+        return;
+    uint64_t maintenant = horloge_ns();
+    if(maintenant < metriques.prochain_export_ns)
+        return;
+    metriques.prochain_export_ns = maintenant + DELAI_METRIQUES_MS * 1000000ULL;
+    metriques_exporter();
+}
+
+/**
+ * @brief metriques_resume - à l'arrêt du serveur : dernier export et, au niveau info, le nombre
+ *                           de messages et les quantiles de traitement de chaque TAG
+ * 
+ */
+
+void metriques_resume(){
+    if(repertoire_metriques != NULL)
+        metriques_exporter();
+    for(int t = 0; t < NB_TAGS; t++){
+        const struct histogramme *h = &metriques.traitement[t];
+        if(h->nb == 0)
+            continue;
+        JOURNAL(LOG_INFO, "%s : %-20s %8llu reçus, traitement p50 %.1f us, p99 %.1f us, max %.1f us\n", hostname,
+                          noms_tags[t], (unsigned long long) h->nb, histo_quantile(h, 0.5) / 1e3,
+                          histo_quantile(h, 0.99) / 1e3, h->max / 1e3);
+    }
+}
+
+/***************************************************************************************************
+                                    Moteur de messages
+***************************************************************************************************/
+
+/*
+ * Toutes les communications passent par des MPI_Isend / MPI_Irecv en octets (MPI_BYTE).
+ * Réception : NB_RECEPTIONS réceptions MPI_ANY_SOURCE / MPI_ANY_TAG sont pré-postées en anneau.
+ * Des réceptions identiques sont appariées dans leur ordre de dépôt : traiter l'anneau dans
+ * l'ordre conserve l'ordre des messages d'un même émetteur, tous TAG confondus
+ * (un TAG_GPID est toujours traité avant le TAG_GKILL_GPID du même gpid).
+ * Envoi : chaque message est copié dans un tampon conservé jusqu'à la fin de son envoi,
+ * l'appelant ne bloque donc jamais sur le réseau.
+ * Communicateurs : les messages entre les rangs r et s passent toujours par comm_rang[max(r, s)] :
+ * MPI_COMM_WORLD entre rangs lancés par mpirun, sinon le communicateur apporté par le serveur créé
+ * (cf ELASTICITE). Un couple de rangs garde donc un seul communicateur et l'ordre de ses messages ;
+ * chaque communicateur dont on est membre a son anneau de réceptions.
+ * Compilé avec -DSIMULATION, le moteur est remplacé par la file d'événements du simulateur
+ * (cf SIMULATION) : envoyer() y dépose le message avec sa date d'arrivée.
+ */
+
+#ifndef SIMULATION
+
+struct anneau{
+    MPI_Comm comm;                              // Communicateur des réceptions
+    char* tampons[NB_RECEPTIONS];               // Tampons des réceptions pré-postées
+    MPI_Request requetes[NB_RECEPTIONS];        // Réceptions pré-postées
+    MPI_Status status[NB_RECEPTIONS];           // Status des réceptions terminées
+    int terminee[NB_RECEPTIONS];                // 1 si la réception est terminée mais pas encore traitée
+    int prochaine;                              // Plus ancienne réception postée (la prochaine à traiter)
+};
+
+struct anneau** anneaux = NULL;                 // Anneau de chaque communicateur dont on est membre
+int nb_anneaux = 0;                             // Nombre d'anneaux
+int taille_reception;                           // Taille des tampons de réception
+MPI_Comm* comm_rang = NULL;                     // Communicateur des messages entre le rang r et les rangs inférieurs
+
+MPI_Request* requetes_envoi;                    // Envois en cours
+char** tampons_envoi;                           // Copie des données de chaque envoi en cours
+int nb_envois = 0;                              // Nombre d'envois en cours
+int capacite_envois = 0;                        // Capacité des tableaux d'envois
+
+/**
+ * @brief envoi_progresser - libère les tampons des envois terminés, sans bloquer
+ * 
+ */
+
+void envoi_progresser(){
+    int nb_termines;
+    int indices[nb_envois > 0 ? nb_envois : 1];
+
+    if(nb_envois == 0)
+        return;
+    MPI_Testsome(nb_envois, requetes_envoi, &nb_termines, indices, MPI_STATUSES_IGNORE);
+    if(nb_termines == MPI_UNDEFINED || nb_termines == 0)
+        return;
+    for(int i = 0; i < nb_termines; i++){
+        free(tampons_envoi[indices[i]]);
+        tampons_envoi[indices[i]] = NULL;
+    }
+    // On compacte les envois encore en cours
+    int j = 0;
+    for(int i = 0; i < nb_envois; i++){
+        if(tampons_envoi[i] != NULL){
+            requetes_envoi[j] = requetes_envoi[i];
+            tampons_envoi[j] = tampons_envoi[i];
+            j++;
+        }
+    }
+    nb_envois = j;
+}
+
+/**
+ * @brief envoyer - envoie un message sans bloquer
+ * 
+ * @param donnees       données à envoyer (copiées, l'appelant peut les réutiliser aussitôt)
+ * @param taille        taille des données en octets
+ * @param destination   rang du destinataire
+ * @param tag           TAG du message
+ */
+
+void envoyer(const void *donnees, int taille, int destination, int tag){
+    // Un serveur créé qui s'arrête n'est plus adressé (cf retrecir_commencer)
+    if(destination >= nb_proc){
+        JOURNAL(LOG_INFO, "%s : message %s pour le rang %d, arrêté, ignoré\n", hostname, tag >= 0 && tag < NB_TAGS ? noms_tags[tag] : "?", destination);
+        return;
+    }
+    if(nb_envois == capacite_envois){
+        envoi_progresser();
+        if(nb_envois == capacite_envois){
+            capacite_envois = capacite_envois ? capacite_envois * 2 : 64;
+            requetes_envoi = (MPI_Request *) realloc(requetes_envoi, capacite_envois * sizeof(MPI_Request));
+            tampons_envoi = (char **) realloc(tampons_envoi, capacite_envois * sizeof(char *));
+            if(!requetes_envoi || !tampons_envoi){
+                perror("envoyer");
+                exit(1);
+            }
+        }
+    }
+    char *tampon = (char *) malloc(taille > 0 ? taille : 1);
+    if(!tampon){
+        perror("envoyer");
+        exit(1);
+    }
+    memcpy(tampon, donnees, taille);
+    tampons_envoi[nb_envois] = tampon;
+    MPI_Isend(tampon, taille, MPI_BYTE, destination, tag, comm_rang[destination > rank ? destination : rank], &requetes_envoi[nb_envois]);
+    nb_envois++;
+    metrique_envoi(tag, taille);
+}
+
+/**
+ * @brief envoi_terminer - attend la fin de tous les envois en cours
+ *                         (menu du rang 0 et terminaison uniquement)
+ * 
+ */
+
+void envoi_terminer(){
+    MPI_Waitall(nb_envois, requetes_envoi, MPI_STATUSES_IGNORE);
+    for(int i = 0; i < nb_envois; i++)
+        free(tampons_envoi[i]);
+    nb_envois = 0;
+}
+
+/**
+ * @brief reception_poster - (re)poste la réception i d'un anneau
+ * 
+ * @param a         anneau
+ * @param i         indice de la réception
+ */
+
+void reception_poster(struct anneau *a, int i){
+    a->terminee[i] = 0;
+    MPI_Irecv(a->tampons[i], taille_reception, MPI_BYTE, MPI_ANY_SOURCE, MPI_ANY_TAG, a->comm, &a->requetes[i]);
+}
+
+/**
+ * @brief anneau_ajouter - alloue les tampons d'un communicateur et pré-poste toutes ses réceptions
+ * 
+ * @param comm      communicateur
+ */
+
+void anneau_ajouter(MPI_Comm comm){
+    struct anneau *a = (struct anneau *) calloc(1, sizeof(struct anneau));
+    if(!a){
+        perror("anneau_ajouter");
+        exit(1);
+    }
+    a->comm = comm;
+    for(int i = 0; i < NB_RECEPTIONS; i++){
+        a->tampons[i] = (char *) malloc(taille_reception);
+        if(!a->tampons[i]){
+            perror("anneau_ajouter");
+            exit(1);
+        }
+        reception_poster(a, i);
+    }
+    anneaux[nb_anneaux++] = a;
+}
+
+/**
+ * @brief anneau_retirer - annule les réceptions pré-postées d'un communicateur et libère son anneau
+ * 
+ * @param comm      communicateur
+ */
+
+void anneau_retirer(MPI_Comm comm){
+    for(int k = 0; k < nb_anneaux; k++){
+        struct anneau *a = anneaux[k];
+        if(a->comm != comm)
+            continue;
+        for(int i = 0; i < NB_RECEPTIONS; i++){
+            if(!a->terminee[i]){
+                MPI_Cancel(&a->requetes[i]);
+                MPI_Wait(&a->requetes[i], MPI_STATUS_IGNORE);
+            }
+            free(a->tampons[i]);
+        }
+        free(a);
+        anneaux[k] = anneaux[--nb_anneaux];
+        return;
+    }
+}
+
+/**
+ * @brief moteur_demarrer - alloue les tampons et pré-poste toutes les réceptions
+ * 
+ */
+
+void moteur_demarrer(){
+    // Le vecteur des charges (TAG_CHARGE) grandit avec le nombre de serveurs
+    taille_reception = TAILLE_MESSAGE;
+    if(nb_max * (int) sizeof(struct charge_versionnee) > taille_reception)
+        taille_reception = nb_max * sizeof(struct charge_versionnee);
+
+    anneaux = (struct anneau **) malloc((nb_max + 1) * sizeof(struct anneau *));
+    if(!anneaux){
+        perror("moteur_demarrer");
+        exit(1);
+    }
+    // Nos communicateurs sont ceux des rangs supérieurs ou égaux au nôtre : MPI_COMM_WORLD si mpirun
+    // nous a lancés, puis celui de chaque serveur créé après nous (et le nôtre si on a été créé)
+    for(int r = rank; r < nb_proc; r++){
+        if(r == rank || comm_rang[r] != comm_rang[r - 1])
+            anneau_ajouter(comm_rang[r]);
+    }
+}
+
+/**
+ * @brief moteur_arreter - annule les réceptions pré-postées et termine les envois en cours
+ * 
+ */
+
+void moteur_arreter(){
+    while(nb_anneaux > 0)
+        anneau_retirer(anneaux[0]->comm);
+    free(anneaux);
+    envoi_terminer();
+}
+
+/**
+ * @brief moteur_progresser - relève les réceptions terminées sans bloquer
+ * 
+ * @return int      nombre de réceptions qui viennent de se terminer
+ */
+
+int moteur_progresser(){
+    int nb_terminees;
+    int total = 0;
+    int indices[NB_RECEPTIONS];
+    MPI_Status statuses[NB_RECEPTIONS];
+
+    for(int k = 0; k < nb_anneaux; k++){
+        struct anneau *a = anneaux[k];
+        MPI_Testsome(NB_RECEPTIONS, a->requetes, &nb_terminees, indices, statuses);
+        if(nb_terminees == MPI_UNDEFINED)
+            nb_terminees = 0;
+        for(int i = 0; i < nb_terminees; i++){
+            a->terminee[indices[i]] = 1;
+            a->status[indices[i]] = statuses[i];
+        }
+        total += nb_terminees;
+    }
+    envoi_progresser();
+    return total;
+}
+
+#else
+
+int nb_envois = 0;                              // Le simulateur prend chaque message aussitôt : aucun envoi en cours
+
+void envoi_progresser(){}
+void envoyer(const void *donnees, int taille, int destination, int tag);
+
+#endif
+
+/***************************************************************************************************
+                                    Enveloppe des commandes
+***************************************************************************************************/
+
+char* tampon_enveloppe = NULL;                  // Tampon réutilisé pour construire les enveloppes
+int taille_tampon_enveloppe = 0;                // Taille de ce tampon
+char** argv_enveloppe = NULL;                   // Tableau argv réutilisé par enveloppe_decoder
+int taille_argv_enveloppe = 0;                  // Nombre de cases de ce tableau
+
+/**
+ * @brief envoyer_enveloppe_entete - complète l'en-tête préparé par l'appelant (argc, taille_argv)
+ *                                   et envoie l'enveloppe en un seul message
+ * 
+ * @param destination   rang du destinataire
+ * @param e             en-tête de l'enveloppe, tag, gpid, flags, etc. déjà remplis
+ * @param argv          arguments terminés par NULL (ou NULL s'il n'y en a pas)
+ * @return int          0 si l'enveloppe a été envoyée, -1 si elle dépasse TAILLE_MESSAGE
+ */
+
+int envoyer_enveloppe_entete(int destination, struct enveloppe *e, char **argv){
+    int argc = 0;
+    int taille_argv = 0;
+
+    for(argc = 0; argv != NULL && argv[argc] != NULL; argc++)
+        taille_argv += strlen(argv[argc]) + 1;
+
+    int taille = sizeof(struct enveloppe) + taille_argv;
+    if(taille > TAILLE_MESSAGE){
+        JOURNAL(LOG_ERREUR, "%s : commande trop longue (%d octets, maximum %d)\n", hostname, taille, TAILLE_MESSAGE);
+        return -1;
+    }
+    if(taille > taille_tampon_enveloppe){
+        tampon_enveloppe = (char *) realloc(tampon_enveloppe, taille);
+        if(!tampon_enveloppe){
+            perror("envoyer_enveloppe");
+            exit(1);
+        }
+        taille_tampon_enveloppe = taille;
+    }
+
+    e->argc = argc;
+    e->taille_argv = taille_argv;
+    memcpy(tampon_enveloppe, e, sizeof(struct enveloppe));
+
+    char *p = tampon_enveloppe + sizeof(struct enveloppe);
+    for(int i = 0; i < argc; i++){
+        int longueur = strlen(argv[i]) + 1;
+        memcpy(p, argv[i], longueur);
+        p += longueur;
+    }
+    envoyer(tampon_enveloppe, taille, destination, e->tag);
+    return 0;
+}
+
+/**
+ * @brief envoyer_enveloppe_donnees - construit l'enveloppe d'une commande et l'envoie en un seul message
+ * 
+ * @param destination   rang du destinataire
+ * @param tag           TAG de la commande
+ * @param gpid          gpid concerné
+ * @param flags         paramètre propre à la commande
+ * @param argv          arguments terminés par NULL (ou NULL s'il n'y en a pas)
+ * @param taille_donnees octets qui suivront l'enveloppe dans des TAG_TRANSFERT_DONNEES
+ * @return int          0 si l'enveloppe a été envoyée, -1 si elle dépasse TAILLE_MESSAGE
+ */
+
+int envoyer_enveloppe_donnees(int destination, int tag, gpid_t gpid, int flags, char **argv, long long taille_donnees){
+    struct enveloppe e;
+
+    memset(&e, 0, sizeof(struct enveloppe));
+    e.tag = tag;
+    e.gpid = gpid;
+    e.flags = flags;
+    e.taille_donnees = taille_donnees;
+    return envoyer_enveloppe_entete(destination, &e, argv);
+}
+
+/**
+ * @brief envoyer_enveloppe - envoie une commande sans données à la suite (cf envoyer_enveloppe_donnees)
+ * 
+ */
+
+int envoyer_enveloppe(int destination, int tag, gpid_t gpid, int flags, char **argv){
+    return envoyer_enveloppe_donnees(destination, tag, gpid, flags, argv, 0);
+}
+
+/**
+ * @brief enveloppe_decoder - décode une enveloppe sans copie : les arguments pointent
+ *                            directement dans le message reçu
+ * 
+ * @param msg           message reçu
+ * @param taille        taille du message en octets
+ * @param e             en-tête de l'enveloppe (copié, le message n'est pas forcément aligné)
+ * @return char**       argv terminé par NULL (réutilisé à chaque appel), ou NULL si le message est invalide
+ */
+
+char** enveloppe_decoder(char *msg, int taille, struct enveloppe *e){
+    if(taille < (int) sizeof(struct enveloppe))
+        return NULL;
+    memcpy(e, msg, sizeof(struct enveloppe));
+    if(e->argc < 0 || e->taille_argv != taille - (int) sizeof(struct enveloppe))
+        return NULL;
+    if(e->taille_argv > 0 && msg[taille - 1] != '\0')
+        return NULL;
+
+    if(e->argc + 1 > taille_argv_enveloppe){
+        taille_argv_enveloppe = e->argc + 1;
+        argv_enveloppe = (char **) realloc(argv_enveloppe, taille_argv_enveloppe * sizeof(char *));
+        if(!argv_enveloppe){
+            perror("enveloppe_decoder");
+            exit(1);
+        }
+    }
+
+    char *p = msg + sizeof(struct enveloppe);
+    char *fin = msg + taille;
+    for(int i = 0; i < e->argc; i++){
+        if(p >= fin)
+            return NULL;
+        argv_enveloppe[i] = p;
+        p += strlen(p) + 1;
+    }
+    argv_enveloppe[e->argc] = NULL;
+    return argv_enveloppe;
+}
+
+/***************************************************************************************************
+                                            ELASTICITE
+***************************************************************************************************/
+
+/*
+ * Avec --elastique=N, le coordinateur (COORDINATEUR_VUE) crée jusqu'à N serveurs avec MPI_Comm_spawn
+ * quand il doit faire entrer une machine dans le réseau et qu'aucun rang n'attend hors de la vue :
+ *  - il envoie TAG_AGRANDIR à tous les rangs, rang 0 compris, qui appellent ensemble MPI_Comm_spawn puis
+ *    MPI_Intercomm_merge (agrandir). Le serveur créé prend le rang nb_proc et son communicateur fusionné
+ *    devient comm_rang[nb_proc] (cf Moteur de messages) : personne n'est renuméroté. Le coordinateur lui
+ *    diffuse les chefs des noeuds, la vue et les charges (MPI_Bcast), puis le fait entrer dans la vue ;
+ *  - le dernier serveur créé, sorti de la vue, sans processus, migration ni file d'attente, demande à
+ *    s'arrêter (VUE_DEPART). Le coordinateur envoie TAG_RETRECIR à tous : chacun envoie TAG_ADIEU au
+ *    partant et ne lui écrit plus. Le partant répond TAG_ADIEU à tous quand il a reçu tous les leurs :
+ *    plus aucun message n'est en route, chacun libère le communicateur et appelle MPI_Comm_disconnect,
+ *    et le partant se termine.
+ * Les serveurs s'arrêtent dans l'ordre inverse de leur création, les rangs restent donc contigus. Les
+ * rangs lancés par mpirun ne s'arrêtent pas (MPI_COMM_WORLD ne rétrécit pas) : ils restent hors de la vue.
+ * Une seule création ou un seul arrêt est en cours à la fois (redimensionnement). Le rang 0 prend part
+ * aux opérations collectives pendant qu'il attend une saisie ou une réponse (elastique_servir) ; à la
+ * fin, TAG_END passe par le coordinateur, le seul à savoir quels serveurs existent encore.
+ */
+
+#ifndef SIMULATION
+
+/* En-tête diffusé au serveur créé, juste après MPI_Intercomm_merge */
+
+struct arrivee{
+    int32_t nb_initial;         // Rangs lancés par mpirun
+    int32_t epoque_vue;         // Époque de la vue du coordinateur
+    int32_t nb_agrandissements; // Serveurs créés depuis le départ, celui-ci compris
+    int64_t date_us;            // Date murale de la surcharge qui l'a fait créer
+};
+
+int nb_initial;                                 // Rangs lancés par mpirun (MPI_COMM_WORLD)
+MPI_Comm* inter_rang = NULL;                    // Intercommunicateur du MPI_Comm_spawn qui a créé le rang r (MPI_COMM_NULL sinon)
+char** argv_serveur;                            // Commande du serveur, reprise pour créer les suivants
+int nb_agrandissements = 0;                     // Serveurs créés depuis le départ
+int redimensionnement = 0;                      // Coordinateur : un arrêt de serveur est en cours
+int64_t date_surcharge_us = 0;                  // Serveur créé : date de la surcharge qui l'a fait créer, jusqu'à son premier processus
+int a_participe = 0;                            // Serveur créé : est entré dans la vue (il ne demande à s'arrêter qu'après)
+double prochaine_demande_depart_ms = 0;         // Date avant laquelle on ne redemande pas à s'arrêter
+
+struct{
+    int rang;                                   // Serveur qui s'arrête (-1 si aucun)
+    int adieux;                                 // TAG_ADIEU reçus : du partant, ou de tous les autres pour le partant
+}depart = {-1, 0};
+
+/**
+ * @brief elastique_init - communicateurs de départ de chaque rang. Un serveur créé reçoit l'en-tête
+ *                         de son arrivée (struct arrivee)
+ * 
+ * @param argv      arguments du programme
+ * @param parent    intercommunicateur vers les rangs existants (MPI_COMM_NULL si mpirun nous a lancés)
+ * @param comm      MPI_COMM_WORLD, ou le communicateur fusionné avec les rangs existants
+ */
+
+void elastique_init(char *argv[], MPI_Comm parent, MPI_Comm comm){
+    struct arrivee a;
+
+    argv_serveur = argv;
+    nb_initial = nb_proc;
+    if(parent != MPI_COMM_NULL){
+        MPI_Bcast(&a, sizeof(struct arrivee), MPI_BYTE, COORDINATEUR_VUE, comm);
+        nb_initial = a.nb_initial;
+        epoque_vue = a.epoque_vue;
+        nb_agrandissements = a.nb_agrandissements;
+        date_surcharge_us = a.date_us;
+        // Un rang libéré puis réattribué ne doit pas reprendre les gpid de son ancien occupant
+        epoque_gpid = nb_agrandissements & ((1 << BITS_EPOQUE_GPID) - 1);
+    }
+    nb_max = nb_initial + elastique;
+    if(nb_max < nb_proc)
+        nb_max = nb_proc;
+
+    comm_rang = (MPI_Comm *) malloc(nb_max * sizeof(MPI_Comm));
+    inter_rang = (MPI_Comm *) malloc(nb_max * sizeof(MPI_Comm));
+    if(!comm_rang || !inter_rang){
+        perror("elastique_init");
+        exit(1);
+    }
+    for(int r = 0; r < nb_max; r++){
+        comm_rang[r] = (parent == MPI_COMM_NULL && r < nb_proc) ? MPI_COMM_WORLD : MPI_COMM_NULL;
+        inter_rang[r] = MPI_COMM_NULL;
+    }
+    if(parent != MPI_COMM_NULL){
+        comm_rang[rank] = comm;
+        inter_rang[rank] = parent;
+    }
+    // Le menu et le lot sondent l'entrée standard avant de la lire (cf entree_attendre) : elle ne doit
+    // rien garder en tampon
+    if(rank == 0 && elastique > 0)
+        setvbuf(stdin, NULL, _IONBF, 0);
+}
+
+/**
+ * @brief elastique_rejoindre - serveur créé : reçoit du coordinateur l'état du réseau (chefs des noeuds,
+ *                              vue et charges), une fois ses tables allouées
+ * 
+ */
+
+void elastique_rejoindre(){
+    int k = nb_proc - 1;                        // Rangs existants
+    int entiers[3 * k + 1];
+    float charges[k];
+
+    if(inter_rang[rank] == MPI_COMM_NULL)
+        return;
+    MPI_Bcast(entiers, 3 * k + 1, MPI_INT, COORDINATEUR_VUE, comm_rang[rank]);
+    MPI_Bcast(charges, k, MPI_FLOAT, COORDINATEUR_VUE, comm_rang[rank]);
+    for(int i = 0; i < k; i++){
+        tab_chef[i] = entiers[i];
+        tab_participe[i] = entiers[k + i];
+        charge_ecrire(i, charges[i], entiers[2 * k + i]);
+    }
+    tab_chef[rank] = rank;
+    tab_participe[rank] = 0;
+    // Nos versions doivent dépasser celles de l'ancien occupant de notre rang, que les autres ont gardées
+    charge_ecrire(rank, 0, entiers[3 * k]);
+    JOURNAL(LOG_INFO, "%s : serveur %d créé, %d rangs dans le réseau\n", hostname, rank, nb_proc);
+}
+
+/**
+ * @brief agrandir - crée un serveur avec tous les rangs existants (MPI_Comm_spawn) et l'ajoute au
+ *                   réseau sous le rang nb_proc
+ * 
+ * @param r         création ordonnée par le coordinateur
+ */
+
+void agrandir(const struct redimensionnement *r){
+    int k = nb_proc;
+    MPI_Comm inter, comm;
+    struct arrivee a;
+    struct charge_versionnee c;
+    int entiers[3 * k + 1];
+    float charges[k];
+    double debut = maintenant_ms();
+
+    // Les rangs existants sont tous membres de comm_rang[k - 1] : MPI_COMM_WORLD ou le dernier communicateur fusionné
+    MPI_Comm_spawn(argv_serveur[0], argv_serveur + 1, 1, MPI_INFO_NULL, COORDINATEUR_VUE, comm_rang[k - 1], &inter,
+                   MPI_ERRCODES_IGNORE);
+    MPI_Intercomm_merge(inter, 0, &comm);
+    nb_agrandissements++;
+    memset(&a, 0, sizeof(struct arrivee));
+    a.nb_initial = nb_initial;
+    a.epoque_vue = epoque_vue;
+    a.nb_agrandissements = nb_agrandissements;
+    a.date_us = r->date_us;
+    MPI_Bcast(&a, sizeof(struct arrivee), MPI_BYTE, COORDINATEUR_VUE, comm);
+
+    // Les tables indicées par rang ont nb_max cases : celle du nouveau serveur est remise à zéro
+    comm_rang[k] = comm;
+    inter_rang[k] = inter;
+    tab_chef[k] = k;
+    tab_participe[k] = 0;
+    tab_en_attente[k] = 0;
+    version_en_attente[k] = 0;
+    memset(&controleur.echanges[k], 0, sizeof(struct echange));
+    nb_proc++;
+
+    for(int i = 0; i < k; i++){
+        charge_lire(i, &c);
+        entiers[i] = tab_chef[i];
+        entiers[k + i] = tab_participe[i];
+        entiers[2 * k + i] = c.version;
+        charges[i] = c.charge;
+    }
+    charge_lire(k, &c);
+    entiers[3 * k] = c.version;
+    MPI_Bcast(entiers, 3 * k + 1, MPI_INT, COORDINATEUR_VUE, comm);
+    MPI_Bcast(charges, k, MPI_FLOAT, COORDINATEUR_VUE, comm);
+    if(rank != 0)
+        anneau_ajouter(comm);
+    if(rank == COORDINATEUR_VUE)
+        JOURNAL(LOG_INFO, "%s : serveur %d créé en %.0f ms\n", hostname, k, maintenant_ms() - debut);
+}
+
+/**
+ * @brief agrandir_demander - coordinateur : crée un serveur si --elastique le permet
+ * 
+ * @param date_us   date murale de la surcharge qui motive la création
+ * @return int      1 si le serveur a été créé
+ */
+
+int agrandir_demander(int64_t date_us){
+    struct redimensionnement r;
+
+    if(nb_proc >= nb_max || redimensionnement)
+        return 0;
+    r.rang = nb_proc;
+    r.date_us = date_us;
+    for(int i = 0; i < nb_proc; i++){
+        if(i != rank)
+            envoyer(&r, sizeof(struct redimensionnement), i, TAG_AGRANDIR);
+    }
+    agrandir(&r);
+    return 1;
+}
+
+/**
+ * @brief retrecir_commencer - le serveur k s'arrête : on lui dit adieu et on ne lui écrit plus
+ * 
+ * @param k         rang du serveur (le dernier)
+ */
+
+void retrecir_commencer(int k){
+    depart.rang = k;
+    if(rank == k)
+        return;
+    envoyer(&rank, sizeof(int), k, TAG_ADIEU);
+    nb_proc--;
+}
+
+/**
+ * @brief retrecir_demander - coordinateur : arrête le dernier serveur créé
+ * 
+ * @param k         rang du serveur
+ */
+
+void retrecir_demander(int k){
+    struct redimensionnement r;
+
+    JOURNAL(LOG_INFO, "%s : arrêt du serveur %d\n", hostname, k);
+    redimensionnement = 1;
+    r.rang = k;
+    r.date_us = 0;
+    for(int i = 0; i < nb_proc; i++){
+        if(i != rank)
+            envoyer(&r, sizeof(struct redimensionnement), i, TAG_RETRECIR);
+    }
+    retrecir_commencer(k);
+}
+
+/**
+ * @brief deconnecter - libère le communicateur du serveur k qui s'arrête, une fois tous les adieux échangés
+ * 
+ * @param k         rang du serveur
+ */
+
+void deconnecter(int k){
+    anneau_retirer(comm_rang[k]);
+    envoi_terminer();
+    MPI_Comm_free(&comm_rang[k]);
+    MPI_Comm_disconnect(&inter_rang[k]);
+    depart.rang = -1;
+    depart.adieux = 0;
+    redimensionnement = 0;
+}
+
+/**
+ * @brief processus_presents - nombre de processus de la table (en cours, en migration ou terminés non retirés)
+ */
+
+int processus_presents(){
+    int nb = 0;
+    for(int i = 0; i < process_capacite; i++)
+        nb += process[i].gpid != 0;
+    return nb;
+}
+
+/**
+ * @brief elastique_progresser - avance l'arrêt en cours, et demande le nôtre si on est le dernier serveur
+ *                               créé et qu'on ne sert plus (boucle de réception)
+ * 
+ * @return int      1 si on vient de s'arrêter
+ */
+
+int elastique_progresser(){
+    if(elastique == 0)
+        return 0;
+    if(tab_participe[rank])
+        a_participe = 1;
+    if(depart.rang == -1){
+        if(a_participe && rank >= nb_initial && rank == nb_proc - 1 && !tab_participe[rank] && nb_migrations == 0
+           && file_attente.nb == 0 && processus_presents() == 0 && maintenant_ms() >= prochaine_demande_depart_ms){
+            prochaine_demande_depart_ms = maintenant_ms() + DELAI_DEPART_MS;
+            demander_vue(VUE_DEPART, rank);
+        }
+        return 0;
+    }
+    if(depart.rang != rank){
+        if(depart.adieux > 0)
+            deconnecter(depart.rang);
+        return 0;
+    }
+    if(depart.adieux < nb_proc - 1)
+        return 0;
+    for(int i = 0; i < nb_proc - 1; i++)
+        envoyer(&rank, sizeof(int), i, TAG_ADIEU);
+    JOURNAL(LOG_INFO, "%s : serveur %d arrêté\n", hostname, rank);
+    deconnecter(rank);
+    return 1;
+}
+
+/**
+ * @brief elastique_premier_processus - serveur créé : premier processus lancé, on mesure le temps
+ *                                      écoulé depuis la surcharge qui nous a fait créer
+ * 
+ */
+
+void elastique_premier_processus(){
+    metriques.agrandissement_ms = (date_murale_us() - date_surcharge_us) / 1e3;
+    date_surcharge_us = 0;
+    JOURNAL(LOG_INFO, "%s : premier processus du serveur %d, %.1f ms après la surcharge\n", hostname, rank,
+            metriques.agrandissement_ms);
+}
+
+/* Messages d'un serveur arrêté reçus par le rang 0 avant son adieu, gardés pour le menu ou le lot */
+
+struct courrier{
+    int tag;                    // TAG du message
+    int source;                 // Rang de l'émetteur
+    int taille;                 // Taille en octets
+    char *msg;                  // Contenu
+    struct courrier *suivant;   // Message suivant (ordre d'arrivée)
+};
+
+struct courrier* courrier_garde = NULL;         // Premier message gardé
+struct courrier** courrier_fin = &courrier_garde;
+
+/**
+ * @brief elastique_servir - rang 0 : prend part aux créations et aux arrêts de serveurs ordonnés par le
+ *                           coordinateur (il n'a pas de boucle de réception)
+ * 
+ */
+
+void elastique_servir(){
+    struct redimensionnement r;
+    MPI_Status status;
+    int present;
+    int taille;
+
+    if(elastique == 0)
+        return;
+    while(1){
+        MPI_Iprobe(COORDINATEUR_VUE, TAG_AGRANDIR, comm_rang[COORDINATEUR_VUE], &present, &status);
+        if(!present)
+            MPI_Iprobe(COORDINATEUR_VUE, TAG_RETRECIR, comm_rang[COORDINATEUR_VUE], &present, &status);
+        if(!present)
+            return;
+        MPI_Recv(&r, sizeof(struct redimensionnement), MPI_BYTE, COORDINATEUR_VUE, status.MPI_TAG,
+                 comm_rang[COORDINATEUR_VUE], MPI_STATUS_IGNORE);
+        if(status.MPI_TAG == TAG_AGRANDIR){
+            agrandir(&r);
+            continue;
+        }
+        // Les messages du partant (accusés des gstart qu'il a lancés, réponses à gps) arrivent avant
+        // son adieu : on les garde jusqu'à ce que le menu ou le lot les demande
+        retrecir_commencer(r.rang);
+        envoi_terminer();
+        do{
+            MPI_Probe(r.rang, MPI_ANY_TAG, comm_rang[r.rang], &status);
+            MPI_Get_count(&status, MPI_BYTE, &taille);
+            struct courrier *c = (struct courrier *) malloc(sizeof(struct courrier));
+            char *msg = (char *) malloc(taille > 0 ? taille : 1);
+            if(!c || !msg){
+                perror("elastique_servir");
+                exit(1);
+            }
+            MPI_Recv(msg, taille, MPI_BYTE, r.rang, status.MPI_TAG, comm_rang[r.rang], MPI_STATUS_IGNORE);
+            if(status.MPI_TAG == TAG_ADIEU){
+                free(c);
+                free(msg);
+                continue;
+            }
+            c->tag = status.MPI_TAG;
+            c->source = r.rang;
+            c->taille = taille;
+            c->msg = msg;
+            c->suivant = NULL;
+            *courrier_fin = c;
+            courrier_fin = &c->suivant;
+        }while(status.MPI_TAG != TAG_ADIEU);
+        deconnecter(r.rang);
+    }
+}
+
+/**
+ * @brief recevoir - rang 0 : reçoit, sans bloquer, un message arrivé avec ce TAG sur l'un de ses
+ *                   communicateurs ou gardé au départ d'un serveur
+ * 
+ * @param tag       TAG cherché
+ * @param taille    reçoit la taille du message
+ * @param source    reçoit le rang de l'émetteur
+ * @return char*    message, à libérer ; NULL si aucun n'est arrivé
+ */
+
+char* recevoir(int tag, int *taille, int *source){
+    MPI_Status status;
+    int present;
+    char *msg;
+
+    for(struct courrier **c = &courrier_garde; *c != NULL; c = &(*c)->suivant){
+        struct courrier *trouve = *c;
+        if(trouve->tag != tag)
+            continue;
+        *c = trouve->suivant;
+        if(*c == NULL)
+            courrier_fin = c;
+        *taille = trouve->taille;
+        *source = trouve->source;
+        msg = trouve->msg;
+        free(trouve);
+        return msg;
+    }
+    // MPI_COMM_WORLD, puis le communicateur de chaque serveur créé
+    for(int r = 0; r < nb_proc; r++){
+        if(r > 0 && comm_rang[r] == comm_rang[r - 1])
+            continue;
+        MPI_Iprobe(MPI_ANY_SOURCE, tag, comm_rang[r], &present, &status);
+        if(!present)
+            continue;
+        MPI_Get_count(&status, MPI_BYTE, taille);
+        *source = status.MPI_SOURCE;
+        msg = (char *) malloc(*taille > 0 ? *taille : 1);
+        if(!msg){
+            perror("recevoir");
+            exit(1);
+        }
+        MPI_Recv(msg, *taille, MPI_BYTE, status.MPI_SOURCE, tag, comm_rang[r], MPI_STATUS_IGNORE);
+        return msg;
+    }
+    return NULL;
+}
+
+/**
+ * @brief entree_attendre - rang 0 : avec --elastique, sert les créations et les arrêts de serveurs tant
+ *                          que rien n'est arrivé sur l'entrée standard (non tamponnée, cf elastique_init)
+ * 
+ * @param f         fichier qui va être lu
+ */
+
+void entree_attendre(FILE *f){
+    struct pollfd entree = {STDIN_FILENO, POLLIN, 0};
+
+    if(elastique == 0 || f != stdin)
+        return;
+    while(poll(&entree, 1, ATTENTE_SAISIE_MS) == 0)
+        elastique_servir();
+}
+
+/**
+ * @brief saisir - scanf du menu du rang 0, qui sert les créations et les arrêts de serveurs en attendant
+ * 
+ * @param format    format de scanf
+ * @return int      valeur de retour de scanf
+ */
+
+int saisir(const char *format, ...) __attribute__((format(scanf, 1, 2)));
+
+int saisir(const char *format, ...){
+    va_list arguments;
+    int lus;
+
+    entree_attendre(stdin);
+    va_start(arguments, format);
+    lus = vscanf(format, arguments);
+    va_end(arguments);
+    return lus;
+}
+
+/**
+ * @brief elastique_attendre_fin - rang 0 : après TAG_END, sert les créations et les arrêts encore
+ *                                 ordonnés par le coordinateur jusqu'à ce qu'il confirme la fin
+ * 
+ */
+
+void elastique_attendre_fin(){
+    struct timespec pause = {0, ATTENTE_BOUCLE_US * 1000};
+    int present = 0;
+    int fin;
+
+    while(!present){
+        elastique_servir();
+        MPI_Iprobe(COORDINATEUR_VUE, TAG_END, comm_rang[COORDINATEUR_VUE], &present, MPI_STATUS_IGNORE);
+        if(!present)
+            nanosleep(&pause, NULL);
+    }
+    MPI_Recv(&fin, sizeof(int), MPI_BYTE, COORDINATEUR_VUE, TAG_END, comm_rang[COORDINATEUR_VUE], MPI_STATUS_IGNORE);
+    elastique_servir();
+}
+
+/**
+ * @brief elastique_fermer - termine un arrêt interrompu par la fin, puis se déconnecte des serveurs
+ *                           créés, du dernier au premier (avant MPI_Finalize)
+ * 
+ */
+
+void elastique_fermer(){
+    int adieu;
+
+    if(depart.rang != -1 && depart.rang != rank){
+        if(depart.adieux == 0)
+            MPI_Recv(&adieu, sizeof(int), MPI_BYTE, depart.rang, TAG_ADIEU, comm_rang[depart.rang], MPI_STATUS_IGNORE);
+        deconnecter(depart.rang);
+    }else if(depart.rang == rank){
+        while(depart.adieux < nb_proc - 1){
+            MPI_Recv(&adieu, sizeof(int), MPI_BYTE, MPI_ANY_SOURCE, TAG_ADIEU, comm_rang[rank], MPI_STATUS_IGNORE);
+            depart.adieux++;
+        }
+        for(int i = 0; i < nb_proc - 1; i++)
+            envoyer(&rank, sizeof(int), i, TAG_ADIEU);
+        deconnecter(rank);
+    }
+    for(int k = nb_max - 1; k >= nb_initial; k--){
+        if(comm_rang[k] != MPI_COMM_NULL)
+            MPI_Comm_free(&comm_rang[k]);
+        if(inter_rang[k] != MPI_COMM_NULL)
+            MPI_Comm_disconnect(&inter_rang[k]);
+    }
+    free(comm_rang);
+    free(inter_rang);
+}
+
+#endif
+
+/***************************************************************************************************
+                                                NOEUD
+***************************************************************************************************/
+
+/*
+ * Les serveurs d'un même noeud (MPI_Comm_split_type(MPI_COMM_TYPE_SHARED)) partagent une seule copie
+ * de la table des charges et de l'annuaire des gpid, dans une fenêtre MPI_Win_allocate_shared allouée
+ * par le chef du noeud (son plus petit rang) :
+ *
+ *      entete_annuaire | tab_sequence[nb_max] | tab_charge[nb_max] | tab_version[nb_max] | annuaire
+ *
+ *  - chaque serveur écrit sa propre charge dans la table : ses voisins la voient sans message ;
+ *  - seul le chef fait le gossip TAG_CHARGE, avec les chefs des autres noeuds, et y écrit les charges
+ *    qu'il en reçoit. Chaque case n'a donc qu'un écrivain : une séquence par case suffit (seqlock) ;
+ *  - les TAG_GPID, TAG_GKILL_GPID et TAG_FIN_GPID ne vont qu'au chef de chaque autre noeud, qui les
+ *    écrit dans l'annuaire. Un serveur y écrit lui-même ses gpid. Les écrivains prennent le verrou de
+ *    l'entête, les lecteurs recommencent si la séquence a changé (cf annuaire_lire).
+ * L'annuaire partagé a une capacité fixe (GPID_PAR_SERVEUR processus par serveur). Au-delà, chaque serveur
+ * garde les gpid qu'il écrit dans un annuaire de débordement privé, qui grandit : ses voisins ne les voient
+ * pas, et font suivre au chef les gkill des gpid qu'ils ne trouvent pas (cf gpid_destination). Un serveur
+ * seul sur son noeud, et le rang 0, gardent des tables privées et un annuaire qui grandit : ils sont leur propre chef.
+ * La fenêtre est accédée par chargements et écritures ordinaires, ordonnés par les barrières C11,
+ * dans une époque MPI_Win_lock_all ouverte jusqu'à Final.
+ */
+
+#ifndef SIMULATION
+
+MPI_Comm comm_noeud = MPI_COMM_NULL;            // Serveurs de notre noeud (MPI_COMM_NULL pour le rang 0)
+MPI_Win fenetre_noeud = MPI_WIN_NULL;           // Fenêtre partagée du noeud (MPI_WIN_NULL si tables privées)
+
+/**
+ * @brief aligner - arrondit une taille au multiple de 8 supérieur (découpage de la fenêtre)
+ */
+
+static inline MPI_Aint aligner(MPI_Aint taille){
+    return (taille + 7) & ~(MPI_Aint) 7;
+}
+
+/**
+ * @brief noeud_init - regroupe les serveurs par noeud, désigne les chefs et place la table des charges
+ *                     et l'annuaire dans la fenêtre partagée du noeud (ou en mémoire privée si on y est seul)
+ * 
+ */
+
+void noeud_init(){
+    int chef = rank;
+    int nb_noeud = 1;
+
+    // Le rang 0 ne fait pas partie d'un noeud : il ne place rien et ne reçoit pas les charges
+    // Un serveur créé (cf ELASTICITE) est seul sur son noeud : il reçoit les chefs des autres du coordinateur
+    tab_chef = (int *) malloc(nb_max * sizeof(int));
+    if(!tab_chef){
+        perror("noeud_init");
+        exit(1);
+    }
+    if(inter_rang[rank] != MPI_COMM_NULL){
+        tab_chef[rank] = rank;
+    }else{
+        MPI_Comm_split_type(MPI_COMM_WORLD, rank == 0 ? MPI_UNDEFINED : MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &comm_noeud);
+        if(comm_noeud != MPI_COMM_NULL){
+            MPI_Comm_size(comm_noeud, &nb_noeud);
+            MPI_Allreduce(&rank, &chef, 1, MPI_INT, MPI_MIN, comm_noeud);
+        }
+        MPI_Allgather(&chef, 1, MPI_INT, tab_chef, 1, MPI_INT, MPI_COMM_WORLD);
+    }
+
+    if(nb_noeud < 2){
+        tab_charge = (float *) calloc(nb_max, sizeof(float));
+        tab_version = (int *) calloc(nb_max, sizeof(int));
+        tab_sequence = (atomic_uint *) calloc(nb_max, sizeof(atomic_uint));
+        if(!tab_charge || !tab_version || !tab_sequence){
+            perror("noeud_init");
+            exit(1);
+        }
+        // L'annuaire est dimensionné pour PROCESS_SIZE processus par serveur avant son premier agrandissement
+        int capacite = 16;
+        while(capacite * 7 < nb_max * PROCESS_SIZE * 10)
+            capacite *= 2;
+        annuaire_init(&annuaire, capacite);
+        return;
+    }
+
+    int capacite = 16;
+    while(capacite * 7 < (long long) nb_max * GPID_PAR_SERVEUR * 10)
+        capacite *= 2;
+    MPI_Aint debut_sequences = aligner(sizeof(struct entete_annuaire));
+    MPI_Aint debut_charges = debut_sequences + aligner(nb_max * sizeof(atomic_uint));
+    MPI_Aint debut_versions = debut_charges + aligner(nb_max * sizeof(float));
+    MPI_Aint debut_annuaire = debut_versions + aligner(nb_max * sizeof(int));
+    MPI_Aint taille = debut_annuaire + (MPI_Aint) capacite * sizeof(struct entree_gpid);
+    char *base;
+    int unite;
+
+    MPI_Win_allocate_shared(rank == chef ? taille : 0, 1, MPI_INFO_NULL, comm_noeud, &base, &fenetre_noeud);
+    MPI_Win_shared_query(fenetre_noeud, 0, &taille, &unite, &base);
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, fenetre_noeud);
+    if(rank == chef){
+        memset(base, 0, taille);
+        atomic_flag_clear((atomic_flag *) &((struct entete_annuaire *) base)->verrou);
+        atomic_thread_fence(memory_order_release);
+    }
+    MPI_Barrier(comm_noeud);
+
+    tab_sequence = (atomic_uint *) (base + debut_sequences);
+    tab_charge = (float *) (base + debut_charges);
+    tab_version = (int *) (base + debut_versions);
+    annuaire.entete = (struct entete_annuaire *) base;
+    annuaire.cases = (struct entree_gpid *) (base + debut_annuaire);
+    annuaire.capacite = capacite;
+    annuaire.partage = 1;
+    if(rank == chef)
+        JOURNAL(LOG_INFO, "%s : %d serveurs partagent la table des charges et l'annuaire (%.1f Mo)\n", hostname,
+                nb_noeud, taille / 1e6);
+}
+
+/**
+ * @brief noeud_fermer - libère la fenêtre du noeud ou les tables privées (avant MPI_Finalize)
+ * 
+ */
+
+void noeud_fermer(){
+    if(annuaire.debordement != NULL){
+        free(annuaire.debordement->cases);
+        free(annuaire.debordement->entete);
+        free(annuaire.debordement);
+    }
+    if(fenetre_noeud != MPI_WIN_NULL){
+        MPI_Win_unlock_all(fenetre_noeud);
+        MPI_Win_free(&fenetre_noeud);
+    }else{
+        free(tab_charge);
+        free(tab_version);
+        free(tab_sequence);
+        free(annuaire.cases);
+        free(annuaire.entete);
+    }
+    if(comm_noeud != MPI_COMM_NULL)
+        MPI_Comm_free(&comm_noeud);
+    free(tab_chef);
+}
+
+#endif
+
+/***************************************************************************************************
+                            Fonctions d'initialisation et de terminaison
+***************************************************************************************************/
+
+/**
+Fonction qui initialise MPI et les variables locales
+*/
+
+/**
+ * @brief lire_options - lecture des options de la ligne de commande
+ *                       --placement=min|deux-choix|pondere    politique de placement des gstart
+ *                       --periode=ms                          période de mesure et de diffusion de la charge
+ *                       --equilibrage                         contrôleur d'équilibrage à chaque mesure
+ *                       --repos=ms                            délai avant de renvoyer des tâches d'où elles viennent
+ *                       --log=erreur|info|debug               niveau du journal des serveurs
+ *                       --metriques=répertoire                métriques au format Prometheus dans lb-<rang>.prom
+ *                       --checkpoint=répertoire               répertoire des checkpoints des migrations
+ *                       --sorties=répertoire                  stdout / stderr de chaque tâche dans lb-<gpid>.out / .err
+ *                       --elastique=N                         serveurs que le coordinateur peut créer (MPI_Comm_spawn)
+ *                       --registre=répertoire                 registre des tâches dans lb-<rang>.reg, repris au redémarrage
+ * 
+ * @param argc      nombre de paramètres
+ * @param argv      arguments
+ */
+
+void lire_options(int argc, char* argv[]){
+    for(int i = 1; i < argc; i++){
+        if(strncmp(argv[i], "--placement=", 12) == 0){
+            char *nom = argv[i] + 12;
+            if(strcmp(nom, "min") == 0)
+                politique_placement = PLACEMENT_MIN;
+            else if(strcmp(nom, "deux-choix") == 0)
+                politique_placement = PLACEMENT_DEUX_CHOIX;
+            else if(strcmp(nom, "pondere") == 0)
+                politique_placement = PLACEMENT_PONDERE;
+            else{
+                if(rank == 0)
+                    printf("Politique de placement inconnue : %s (min, deux-choix ou pondere)\n", nom);
+                MPI_Finalize();
+                exit(2);
+            }
+        }else if(strncmp(argv[i], "--periode=", 10) == 0){
+            periode_moniteur_ms = atoi(argv[i] + 10);
+            if(periode_moniteur_ms < 1)
+                periode_moniteur_ms = PERIODE_MONITEUR_MS;
+        }else if(strcmp(argv[i], "--equilibrage") == 0){
+            equilibrage = 1;
+        }else if(strncmp(argv[i], "--checkpoint=", 13) == 0){
+            repertoire_checkpoint = argv[i] + 13;
+        }else if(strncmp(argv[i], "--sorties=", 10) == 0){
+            repertoire_sorties = argv[i] + 10;
+        }else if(strncmp(argv[i], "--lot=", 6) == 0){
+            fichier_lot = argv[i] + 6;
+        }else if(strncmp(argv[i], "--capacite=", 11) == 0){
+            seuil_capacite = atof(argv[i] + 11);
+            if(seuil_capacite <= 0)
+                seuil_capacite = SEUIL_CAPACITE;
+        }else if(strncmp(argv[i], "--repos=", 8) == 0){
+            repos_equilibrage_ms = atoi(argv[i] + 8);
+            if(repos_equilibrage_ms < 0)
+                repos_equilibrage_ms = REPOS_EQUILIBRAGE_MS;
+        }else if(strncmp(argv[i], "--log=", 6) == 0){
+            char *nom = argv[i] + 6;
+            if(strcmp(nom, "erreur") == 0)
+                niveau_log = LOG_ERREUR;
+            else if(strcmp(nom, "info") == 0)
+                niveau_log = LOG_INFO;
+            else if(strcmp(nom, "debug") == 0)
+                niveau_log = LOG_DEBUG;
+            else{
+                if(rank == 0)
+                    printf("Niveau de journal inconnu : %s (erreur, info ou debug)\n", nom);
+                MPI_Finalize();
+                exit(2);
+            }
+            if(niveau_log > NIVEAU_LOG_MAX && rank == 0)
+                printf("Niveau de journal %s non compilé (NIVEAU_LOG_MAX=%d)\n", nom, NIVEAU_LOG_MAX);
+        }else if(strncmp(argv[i], "--metriques=", 12) == 0){
+            repertoire_metriques = argv[i] + 12;
+        }else if(strncmp(argv[i], "--attente=", 10) == 0){
+            taille_max_file = atoi(argv[i] + 10);
+            if(taille_max_file < 1)
+                taille_max_file = TAILLE_MAX_FILE;
+        }else if(strncmp(argv[i], "--elastique=", 12) == 0){
+            elastique = atoi(argv[i] + 12);
+            if(elastique < 0)
+                elastique = 0;
+        }else if(strncmp(argv[i], "--registre=", 11) == 0){
+            repertoire_registre = argv[i] + 11;
+        }
+    }
+    srand(time(NULL) + rank);
+}
+
+#ifndef SIMULATION
+
+/**
+ * @brief Fonction qui initialise MPI et les variables locales
+ * 
+ * @param argc      nombre de paramètres
+ * @param argv      arguments
+ */
+
+void Init(int argc, char* argv[]){
+
+    // SIGCHLD est bloqué avant que MPI et le moniteur ne créent leurs threads (ils héritent du masque) :
+    // la fin des processus n'est lue que par la boucle de réception, dans fd_fils
+    sigemptyset(&masque_fils);
+    sigaddset(&masque_fils, SIGCHLD);
+    pthread_sigmask(SIG_BLOCK, &masque_fils, NULL);
+
+    // Initialisation MPI : seul le thread principal appelle MPI, le moniteur ne fait que mesurer
+    // Un serveur créé par MPI_Comm_spawn (cf ELASTICITE) prend le dernier rang du communicateur fusionné
+    int niveau_thread;
+    MPI_Comm parent, comm = MPI_COMM_WORLD;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &niveau_thread);
+    MPI_Comm_get_parent(&parent);
+    if(parent != MPI_COMM_NULL)
+        MPI_Intercomm_merge(parent, 1, &comm);
+    MPI_Comm_size(comm, &nb_proc);
+    MPI_Comm_rank(comm, &rank);
+    lire_options(argc, argv);
+	
+    // On vérifie que le programme est lancé avec le bon nombre de processus maximum
+    if (nb_proc < 2) {
+        printf("Nombre de processus lancé insuffisant !\n");
+        printf("Il faut lancer le programme avec au moins 2 processus.\n");
+        MPI_Finalize();
+        exit(2);
+    }
+
+    // Initialisation des variables : les tables indicées par rang ont nb_max cases (serveurs créés compris)
+    MPI_Get_processor_name(hostname,&length_hostname);          // On récupère le nom de la machine
+    elastique_init(argv, parent, comm);                         // Communicateurs de chaque rang et nb_max
+    noeud_init();                                               // Table des charges et annuaire, partagés par le noeud
+    if(tab_chef[rank] == rank)                                  // Seul le chef reçoit et envoie le vecteur des charges
+        tampon_gossip = (struct charge_versionnee *) malloc(nb_max * sizeof(struct charge_versionnee));
+    tab_en_attente = (int *) calloc(nb_max, sizeof(int));
+    version_en_attente = (int *) calloc(nb_max, sizeof(int));
+    tab_participe = (int *) malloc(nb_max * sizeof(int));
+    controleur_init(&controleur, nb_max);
+    process_agrandir();
+    renvois_init();
+    amorcage_init();
+    echantillonneur_ouvrir();
+    lanceur_init();
+    fd_fils = signalfd(-1, &masque_fils, SFD_NONBLOCK | SFD_CLOEXEC);
+    if(fd_fils == -1){
+        perror("signalfd");
+        exit(1);
+    }
+    
+    // Instancie la table des participants
+    for(int i = 0; i < nb_proc; i++){
+        tab_participe[i] = 1; 
+    }
+    elastique_rejoindre();                                      // Serveur créé : état du réseau diffusé par le coordinateur
+    registre_ouvrir();                                          // Redémarrage : reprise des processus du registre
+
+    notifyCharge(getCharge());
+}
+
+
+/**
+ * @brief Fonction qui gère la terminaison MPI et libère la mémoire alloué.
+ * 
+ */
+
+void Final(){
+    // La fenêtre du noeud est libérée par tous ses serveurs avant de finaliser MPI
+    elastique_fermer();
+    noeud_fermer();
+    MPI_Finalize();
+
+    // Libère l'espace mémoire alloué pour le programme
+    free(tab_en_attente);
+    free(version_en_attente);
+    free(tampon_gossip);
+    free(tab_participe);
+    free(controleur.echanges);
+    free(tampon_enveloppe);
+    free(argv_enveloppe);
+    echantillonneur_fermer();
+    lanceur_fermer();
+    registre_fermer();
+    close(fd_fils);
+    for(int i = 0; i < process_capacite; i++){
+        if(process[i].gpid != 0)
+            process_liberer(i);
+    }
+    free(process);
+}
+
+#endif
+
+/***************************************************************************************************
+                                Fonctions de gestions des machines
+***************************************************************************************************/
+
+/*******************************************VUE****************************************************/
+
+/*
+ * Vue des participants : tab_participe, estampillée par epoque_vue. La machine qui décide d'une entrée
+ * ou d'une sortie ne la diffuse plus elle-même : elle la demande au coordinateur (COORDINATEUR_VUE,
+ * TAG_VUE_DEMANDE), qui applique les changements un par un, incrémente l'époque et diffuse la vue
+ * entière (TAG_VUE). Deux changements ne peuvent donc pas se croiser, et une demande décidée sur une
+ * vue dépassée est ignorée : le demandeur décidera de nouveau sur la nouvelle vue.
+ * Chaque gstart porte l'époque de la vue qui l'a placé ou fait suivre (enveloppe.epoque) :
+ *  - une machine qui ne participe pas fait suivre un gstart en un seul saut à un participant de sa vue ;
+ *  - un gstart placé chez nous avec une vue plus récente que la nôtre est lancé : l'émetteur sait
+ *    déjà que nous sommes entrés dans le réseau, notre vue est en route.
+ * Le coordinateur reste dans la boucle de réception même s'il ne participe plus.
+ */
+
+/**
+ * @brief participant_suivant - premier participant après nous dans l'anneau des serveurs
+ * 
+ * @return int      rang du participant, ou -1 s'il n'y en a aucun
+ */
+
+int participant_suivant(){
+    for(int k = 1; k < nb_proc; k++){
+        int i = (rank - 1 + k) % (nb_proc - 1) + 1;
+        if(tab_participe[i])
+            return i;
+    }
+    return -1;
+}
+
+/**
+ * @brief quitter_reseau - la vue ne nous compte plus parmi les participants : nos tâches partent
+ *                         vers le participant le moins chargé
+ * 
+ */
+
+void quitter_reseau(){
+    int id_cible = -1;
+
+    JOURNAL(LOG_INFO, "%s JE ME RETIRE DU RESEAU!!!!!!!!!!!!!!!!\n",hostname);
+    controleur.mesures_sous_charge = 0;
+    for(int i = 1; i < nb_proc; i++){
+        if(i != rank && tab_participe[i] && (id_cible == -1 || tab_charge[i] < tab_charge[id_cible]))
+            id_cible = i;
+    }
+    if(id_cible != -1)
+        transfert_tache(id_cible, -1);
+}
+
+/**
+ * @brief vue_installer - remplace notre vue par une vue plus récente
+ * 
+ * @param epoque        époque de la nouvelle vue
+ * @param participe     un octet par rang, 1 si le rang participe
+ */
+
+void vue_installer(int epoque, const char *participe){
+    int participait = tab_participe[rank];
+    char ancienne[nb_proc];
+
+    for(int i = 0; i < nb_proc; i++){
+        ancienne[i] = (char) tab_participe[i];
+        tab_participe[i] = participe[i];
+    }
+    epoque_vue = epoque;
+    // Notre noeud retrouve un participant : son annuaire n'a plus reçu les mises à jour (cf AMORCAGE)
+    if(tab_chef[rank] == rank && !noeud_participe(ancienne) && noeud_participe(participe))
+        amorcage_commencer(ancienne);
+    if(!participait && tab_participe[rank])
+        JOURNAL(LOG_INFO, "%s JE M'INSERT DANS LE RESEAU!!!!!!!!!!!!\n",hostname);
+    else if(participait && !tab_participe[rank])
+        quitter_reseau();
+}
+
+/**
+ * @brief diffuser_vue - envoie notre vue à tous les serveurs (coordinateur seulement)
+ * 
+ */
+
+void diffuser_vue(){
+    char tampon[sizeof(int32_t) + nb_proc];
+    int32_t epoque = epoque_vue;
+
+    memcpy(tampon, &epoque, sizeof(int32_t));
+    for(int i = 0; i < nb_proc; i++)
+        tampon[sizeof(int32_t) + i] = (char) tab_participe[i];
+    for(int i = 1; i < nb_proc; i++){
+        if(i != rank)
+            envoyer(tampon, sizeof(tampon), i, TAG_VUE);
+    }
+}
+
+/**
+ * @brief recv_vue - installe la vue diffusée par le coordinateur si elle est plus récente que la nôtre
+ * 
+ * @param msg       époque puis un octet par rang
+ * @param taille    taille du message en octets
+ */
+
+void recv_vue(const char *msg, int taille){
+    int32_t epoque;
+
+    if(taille != (int) sizeof(int32_t) + nb_proc){
+        JOURNAL(LOG_ERREUR, "%s : vue des participants invalide\n", hostname);
+        return;
+    }
+    memcpy(&epoque, msg, sizeof(int32_t));
+    if(epoque > epoque_vue)
+        vue_installer(epoque, msg + sizeof(int32_t));
+}
+
+/**
+ * @brief recv_demande_vue - le coordinateur applique une entrée ou une sortie décidée sur sa vue
+ *                           actuelle, puis diffuse la nouvelle vue
+ * 
+ * @param d         demande reçue
+ */
+
+void recv_demande_vue(const struct demande_vue *d){
+    char participe[nb_proc];
+    int nb_participants = 0;
+
+#ifndef SIMULATION
+    // Le dernier serveur créé, sorti de la vue, demande à s'arrêter : un seul départ ou une seule création à la fois
+    if(d->type == VUE_DEPART){
+        if(d->rang == nb_proc - 1 && d->rang >= nb_initial && !tab_participe[d->rang] && !redimensionnement)
+            retrecir_demander(d->rang);
+        return;
+    }
+#endif
+    // Décidée sur une vue dépassée : le demandeur refera son choix sur la nouvelle vue
+    if(d->epoque != epoque_vue)
+        return;
+    for(int i = 0; i < nb_proc; i++){
+        participe[i] = (char) tab_participe[i];
+        nb_participants += (i > 0 && participe[i]);
+    }
+    if(d->type == VUE_INSERTION){
+        int i = 1;
+        while(i < nb_proc && participe[i])
+            i++;
+        if(i == nb_proc){
+#ifndef SIMULATION
+            // Aucun rang n'attend hors du réseau : on en crée un (--elastique), qui entre avec la même demande
+            if(agrandir_demander(d->date_us))
+                recv_demande_vue(d);
+#endif
+            return;
+        }
+        participe[i] = 1;
+    }else{
+        if(d->rang < 1 || d->rang >= nb_proc || !participe[d->rang] || nb_participants < 2)
+            return;
+        participe[d->rang] = 0;
+    }
+    vue_installer(epoque_vue + 1, participe);
+    diffuser_vue();
+}
+
+/**
+ * @brief demander_vue - demande une entrée ou une sortie au coordinateur
+ * 
+ * @param type      VUE_INSERTION, VUE_RETRAIT ou VUE_DEPART
+ * @param rang      rang qui sort (VUE_RETRAIT, VUE_DEPART)
+ */
+
+void demander_vue(int type, int rang){
+    struct demande_vue d;
+
+    d.type = type;
+    d.rang = rang;
+    d.epoque = epoque_vue;
+    d.date_us = date_murale_us();
+    if(rank == COORDINATEUR_VUE)
+        recv_demande_vue(&d);
+    else
+        envoyer(&d, sizeof(struct demande_vue), COORDINATEUR_VUE, TAG_VUE_DEMANDE);
+}
+
+/*******************************************AMORCAGE***********************************************/
+
+/*
+ * Les mises à jour de l'annuaire ne vont qu'aux noeuds qui ont un participant (cf diffuser_annuaire) :
+ * l'annuaire d'un noeud sans participant vieillit, et celui d'un serveur créé est vide. Quand un noeud
+ * retrouve un participant, son chef s'amorce au lieu d'attendre que les gpid passent un par un :
+ *  - il demande un instantané (TAG_ETAT_DEMANDE) au participant le moins chargé d'un autre noeud qui
+ *    participait déjà à la vue précédente ;
+ *  - ce pair copie son annuaire et son vecteur des charges en un seul tampon binaire (en-tête, charges,
+ *    puis gpid / rang / indice) et l'envoie en blocs de TAILLE_MESSAGE (TAG_ETAT) ;
+ *  - pendant le transfert, le chef garde dans l'ordre les TAG_GPID, TAG_GKILL_GPID et TAG_FIN_GPID qu'il
+ *    reçoit (amorcage_garder), au plus MAX_AVIS_AMORCAGE : au-delà, il les oublie et redemande un
+ *    instantané, qui les contiendra ;
+ *  - sans bloc pendant DELAI_AMORCAGE_MS, il redemande l'instantané à un autre participant
+ *    (amorcage_progresser) ;
+ *  - au dernier bloc, il remplace d'une seule écriture les gpid des autres noeuds par ceux de
+ *    l'instantané, garde les charges plus récentes que les siennes, puis rejoue les mises à jour gardées.
+ * Un pair qui s'amorce lui-même répond à la fin de son amorçage. Une mise à jour qui nous est arrivée
+ * avant notre vue, ou que le pair n'a reçue qu'après son instantané sans nous l'adresser, est perdue :
+ * gkill passe de toute façon par la machine d'origine du gpid et ses renvois.
+ */
+
+/**
+ * @brief amorcage_init - état de l'amorçage, sans amorçage en cours
+ * 
+ */
+
+void amorcage_init(){
+    memset(&amorcage, 0, sizeof(amorcage));
+    amorcage.pair = -1;
+    amorcage.demandeurs = (char *) calloc(nb_max, sizeof(char));
+    if(!amorcage.demandeurs){
+        perror("amorcage_init");
+        exit(1);
+    }
+}
+
+/**
+ * @brief noeud_participe - 1 si un serveur de notre noeud participe à une vue
+ * 
+ * @param participe     un octet par rang, 1 si le rang participe
+ */
+
+int noeud_participe(const char *participe){
+    for(int i = 1; i < nb_proc; i++){
+        if(participe[i] && tab_chef[i] == tab_chef[rank])
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief amorcage_demander - (re)demande l'instantané à pair, en oubliant l'instantané partiel
+ * 
+ * @param pair      participant d'un autre noeud
+ */
+
+void amorcage_demander(int pair){
+    free(amorcage.instantane);
+    amorcage.instantane = NULL;
+    amorcage.pair = pair;
+    amorcage.recu = 0;
+    amorcage.limite_ms = maintenant_ms() + DELAI_AMORCAGE_MS;
+    envoyer(&rank, sizeof(int), pair, TAG_ETAT_DEMANDE);
+}
+
+/**
+ * @brief amorcage_commencer - chef d'un noeud qui retrouve un participant : demande un instantané de
+ *                             l'annuaire et des charges à un participant d'un autre noeud
+ * 
+ * @param ancienne      vue précédente, un octet par rang (tab_participe contient la nouvelle)
+ */
+
+void amorcage_commencer(const char *ancienne){
+    int pair = -1;
+
+    if(amorcage.en_cours)
+        return;
+    for(int i = 1; i < nb_proc; i++){
+        if(ancienne[i] && tab_participe[i] && tab_chef[i] != tab_chef[rank]
+           && (pair == -1 || tab_charge[i] < tab_charge[pair]))
+            pair = i;
+    }
+    if(pair == -1)
+        return;
+    amorcage.en_cours = 1;
+    amorcage.debut_ms = maintenant_ms();
+    amorcage.relances = 0;
+    amorcage.nb_avis = 0;
+    amorcage_demander(pair);
+    JOURNAL(LOG_INFO, "%s : amorçage de l'annuaire du noeud auprès de %d\n", hostname, pair);
+}
+
+/**
+ * @brief amorcage_relancer - redemande l'instantané, de préférence au participant le moins chargé d'un
+ *                            autre noeud qui n'est pas le pair actuel. Les mises à jour gardées restent
+ *                            à rejouer, sauf si on les oublie parce qu'elles sont trop nombreuses.
+ * 
+ * @param raison    cause de la relance, pour le journal
+ */
+
+void amorcage_relancer(const char *raison){
+    int pair = -1;
+
+    for(int i = 1; i < nb_proc; i++){
+        if(i != amorcage.pair && tab_participe[i] && tab_chef[i] != tab_chef[rank]
+           && (pair == -1 || tab_charge[i] < tab_charge[pair]))
+            pair = i;
+    }
+    // Personne d'autre : le pair actuel recommence un instantané (les blocs de l'ancien sont ignorés, cf recv_etat)
+    if(pair == -1)
+        pair = amorcage.pair;
+    JOURNAL(LOG_ERREUR, "%s : amorçage auprès de %d relancé auprès de %d (%s)\n", hostname, amorcage.pair, pair, raison);
+    amorcage.relances++;
+    amorcage_demander(pair);
+}
+
+/**
+ * @brief amorcage_progresser - relance l'amorçage quand aucun bloc de l'instantané n'est arrivé depuis
+ *                              DELAI_AMORCAGE_MS (pair lent, arrêté ou sorti de la vue)
+ * 
+ */
+
+void amorcage_progresser(){
+    if(amorcage.en_cours && maintenant_ms() >= amorcage.limite_ms)
+        amorcage_relancer("délai dépassé");
+}
+
+/**
+ * @brief amorcage_garder - garde une mise à jour de l'annuaire reçue pendant l'amorçage
+ * 
+ * @param tag       TAG_GPID, TAG_GKILL_GPID ou TAG_FIN_GPID
+ * @param source    émetteur
+ * @param avis      mise à jour
+ * @return int      1 si elle est gardée pour être rejouée, 0 si on doit l'appliquer tout de suite
+ */
+
+int amorcage_garder(int tag, int source, const struct avis_gpid *avis){
+    if(!amorcage.en_cours)
+        return 0;
+    // Le pair a reçu ces mises à jour avant nous : un nouvel instantané les contient
+    if(amorcage.nb_avis == MAX_AVIS_AMORCAGE){
+        amorcage.nb_avis = 0;
+        amorcage_relancer("trop de mises à jour gardées");
+    }
+    if(amorcage.nb_avis == amorcage.capacite_avis){
+        amorcage.capacite_avis = amorcage.capacite_avis ? amorcage.capacite_avis * 2 : 64;
+        amorcage.avis = (struct avis_garde *) realloc(amorcage.avis, amorcage.capacite_avis * sizeof(struct avis_garde));
+        if(!amorcage.avis){
+            perror("amorcage_garder");
+            exit(1);
+        }
+    }
+    amorcage.avis[amorcage.nb_avis].tag = tag;
+    amorcage.avis[amorcage.nb_avis].source = source;
+    amorcage.avis[amorcage.nb_avis].avis = *avis;
+    amorcage.nb_avis++;
+    return 1;
+}
+
+/**
+ * @brief instantane_envoyer - copie notre annuaire et nos charges en un seul tampon et l'envoie en blocs
+ * 
+ * @param destination   chef du noeud qui s'amorce
+ */
+
+void instantane_envoyer(int destination){
+    struct entete_instantane entete;
+    unsigned int sequence;
+    int nb;
+
+    // Majorant : toutes les cases de l'annuaire et de notre débordement occupées
+    int capacite_debordement = annuaire.debordement != NULL ? annuaire.debordement->capacite : 0;
+    int64_t taille_max = sizeof(struct entete_instantane) + (int64_t) nb_proc * sizeof(struct charge_versionnee)
+                         + ((int64_t) annuaire.capacite + capacite_debordement) * sizeof(struct entree_instantane);
+    char *tampon = (char *) malloc(taille_max);
+    if(!tampon){
+        perror("instantane_envoyer");
+        exit(1);
+    }
+    struct charge_versionnee *charges = (struct charge_versionnee *) (tampon + sizeof(struct entete_instantane));
+    struct entree_instantane *entrees = (struct entree_instantane *) (charges + nb_proc);
+
+    for(int i = 0; i < nb_proc; i++)
+        charge_lire(i, &charges[i]);
+    // Un autre serveur du noeud peut écrire dans l'annuaire pendant la copie : on recommence (cf annuaire_lire)
+    do{
+        sequence = atomic_load_explicit(&annuaire.entete->sequence, memory_order_acquire);
+        nb = 0;
+        for(int k = 0; k < annuaire.capacite; k++){
+            if(annuaire.cases[k].gpid == 0)
+                continue;
+            entrees[nb].gpid = annuaire.cases[k].gpid;
+            entrees[nb].rang = annuaire.cases[k].rang;
+            entrees[nb].indice = annuaire.cases[k].indice;
+            nb++;
+        }
+        atomic_thread_fence(memory_order_acquire);
+    }while((sequence & 1) || atomic_load_explicit(&annuaire.entete->sequence, memory_order_relaxed) != sequence);
+    for(int k = 0; k < capacite_debordement; k++){
+        const struct entree_gpid *e = &annuaire.debordement->cases[k];
+        if(e->gpid == 0)
+            continue;
+        entrees[nb].gpid = e->gpid;
+        entrees[nb].rang = e->rang;
+        entrees[nb].indice = e->indice;
+        nb++;
+    }
+
+    entete.taille = (char *) (entrees + nb) - tampon;
+    entete.nb_charges = nb_proc;
+    entete.nb_entrees = nb;
+    memcpy(tampon, &entete, sizeof(struct entete_instantane));
+    for(int64_t envoye = 0; envoye < entete.taille; envoye += TAILLE_MESSAGE){
+        int64_t reste = entete.taille - envoye;
+        envoyer(tampon + envoye, reste < TAILLE_MESSAGE ? (int) reste : TAILLE_MESSAGE, destination, TAG_ETAT);
+    }
+    free(tampon);
+    JOURNAL(LOG_INFO, "%s : instantané de l'annuaire envoyé à %d (%d gpid, %.1f Ko)\n", hostname, destination, nb,
+            entete.taille / 1e3);
+}
+
+/**
+ * @brief recv_demande_etat - un noeud s'amorce auprès de nous : on lui envoie notre instantané, ou à la
+ *                            fin de notre propre amorçage
+ * 
+ * @param source    chef du noeud qui s'amorce
+ */
+
+void recv_demande_etat(int source){
+    if(source < 1 || source >= nb_proc)
+        return;
+    if(amorcage.en_cours)
+        amorcage.demandeurs[source] = 1;
+    else
+        instantane_envoyer(source);
+}
+
+/**
+ * @brief amorcage_terminer - installe l'instantané reçu, rejoue les mises à jour gardées et répond aux
+ *                            noeuds qui attendaient le nôtre
+ * 
+ */
+
+void amorcage_terminer(){
+    struct entete_instantane entete;
+
+    memcpy(&entete, amorcage.instantane, sizeof(struct entete_instantane));
+    struct charge_versionnee *charges = (struct charge_versionnee *) (amorcage.instantane + sizeof(struct entete_instantane));
+    struct entree_instantane *entrees = (struct entree_instantane *) (charges + entete.nb_charges);
+
+    // Seul le chef écrit les charges des autres noeuds (cf NOEUD) : c'est nous
+    for(int i = 0; i < entete.nb_charges && i < nb_proc; i++){
+        if(tab_chef[i] != tab_chef[rank] && charges[i].version > tab_version[i])
+            charge_ecrire(i, charges[i].charge, charges[i].version);
+    }
+    int debordees = annuaire_remplacer_distants(entrees, entete.nb_entrees);
+    if(debordees > 0)
+        JOURNAL(LOG_INFO, "%s : annuaire du noeud plein, %d gpid de l'instantané gardés par ce serveur\n", hostname, debordees);
+
+    // Les mises à jour reçues pendant le transfert, dans leur ordre d'arrivée
+    for(int k = 0; k < amorcage.nb_avis; k++){
+        const struct avis_garde *g = &amorcage.avis[k];
+        if(g->tag == TAG_GPID)
+            annuaire_ajouter(g->avis.gpid, g->source, g->avis.indice, 0);
+        else if(g->tag == TAG_GKILL_GPID)
+            recv_gkill(g->source, g->avis.gpid, g->avis.indice);
+        else
+            recv_fin(g->source, &g->avis);
+    }
+
+    double duree_ms = maintenant_ms() - amorcage.debut_ms;
+    histo_ajouter(&metriques.duree_amorcage, (uint64_t) (duree_ms * 1e6));
+    JOURNAL(LOG_INFO, "%s : annuaire amorcé par %d en %.1f ms : %d gpid, %d charges (%.1f Ko), %d mises à jour rejouées\n",
+            hostname, amorcage.pair, duree_ms, entete.nb_entrees, entete.nb_charges, entete.taille / 1e3, amorcage.nb_avis);
+    free(amorcage.instantane);
+    amorcage.instantane = NULL;
+    amorcage.en_cours = 0;
+    amorcage.pair = -1;
+    amorcage.nb_avis = 0;
+
+    for(int i = 1; i < nb_proc; i++){
+        if(amorcage.demandeurs[i]){
+            amorcage.demandeurs[i] = 0;
+            instantane_envoyer(i);
+        }
+    }
+}
+
+/**
+ * @brief recv_etat - reçoit un bloc de l'instantané, et l'installe au dernier
+ * 
+ * @param source    émetteur
+ * @param msg       bloc
+ * @param taille    taille du bloc en octets
+ */
+
+void recv_etat(int source, const char *msg, int taille){
+    if(!amorcage.en_cours || source != amorcage.pair)
+        return;
+    if(amorcage.instantane == NULL){
+        struct entete_instantane entete;
+        if(taille >= (int) sizeof(struct entete_instantane))
+            memcpy(&entete, msg, sizeof(struct entete_instantane));
+        if(taille < (int) sizeof(struct entete_instantane) || entete.nb_charges < 0 || entete.nb_entrees < 0
+           || entete.taille != (int64_t) sizeof(struct entete_instantane)
+                               + entete.nb_charges * (int64_t) sizeof(struct charge_versionnee)
+                               + entete.nb_entrees * (int64_t) sizeof(struct entree_instantane)){
+            // Après une relance auprès du même pair, les blocs restants de l'ancien instantané arrivent d'abord
+            JOURNAL(amorcage.relances > 0 ? LOG_DEBUG : LOG_ERREUR, "%s : instantané invalide reçu de %d\n", hostname, source);
+            return;
+        }
+        amorcage.instantane = (char *) malloc(entete.taille);
+        if(!amorcage.instantane){
+            perror("recv_etat");
+            exit(1);
+        }
+        amorcage.taille = entete.taille;
+        amorcage.recu = 0;
+    }
+    if(amorcage.recu + taille > amorcage.taille)
+        taille = amorcage.taille - amorcage.recu;
+    memcpy(amorcage.instantane + amorcage.recu, msg, taille);
+    amorcage.recu += taille;
+    amorcage.limite_ms = maintenant_ms() + DELAI_AMORCAGE_MS;
+    if(amorcage.recu == amorcage.taille)
+        amorcage_terminer();
+}
+
+/*******************************************INSERTION**********************************************/
+
+/**
+ * @brief Ajoute un participant au réseau : le coordinateur choisit la machine qui entre
+ * 
+ */
+
+void AddMachine(){
+    demander_vue(VUE_INSERTION, 0);
+}
+
+
+/**
+ * @brief chemin_checkpoint - chemin du fichier de checkpoint d'un processus sur cette machine
+ *                            (le rang en fait partie : deux serveurs peuvent partager une machine)
+ * 
+ * @param chemin    chemin construit
+ * @param taille    taille de chemin
+ * @param gpid      gpid du processus
+ */
+
+void chemin_checkpoint(char *chemin, int taille, gpid_t gpid){
+    snprintf(chemin, taille, "%s/lb-%d-%lld.ckpt", repertoire_checkpoint, rank, (long long) gpid);
+}
+
+/**
+ * @brief migrer - démarre la migration d'un processus : on lui demande d'écrire son état
+ *                 (SIGNAL_CHECKPOINT), le checkpoint sera envoyé quand il se sera terminé
+ * 
+ * @param i             indice du processus dans la table process
+ * @param id_machine    identifiant de la machine destinataire
+ */
+
+void migrer(int i, int id_machine){
+    process[i].etat = ETAT_CHECKPOINT;
+    process[i].cible = id_machine;
+    process[i].fd = -1;
+    clock_gettime(CLOCK_MONOTONIC, &process[i].debut_migration);
+    process[i].limite_checkpoint_ms = maintenant_ms() + DELAI_CHECKPOINT_MS;
+    nb_migrations++;
+    controleur.echanges[id_machine].en_cours++;
+    JOURNAL(LOG_INFO, "%s demande le checkpoint du gpid %lld pour le transférer à %d\n", hostname, (long long) process[i].gpid, id_machine);
+    signaler_processus(i, SIGNAL_CHECKPOINT);
+}
+
+/**
+ * @brief migration_abandonner - le processus en ETAT_CHECKPOINT ne partira pas : on libère l'échange
+ *                               avec la cible et on la prévient (TAG_MIGRATION_ABANDON) pour qu'elle
+ *                               oublie la charge qu'elle nous avait promise
+ * 
+ * @param i             indice du processus dans la table process
+ */
+
+void migration_abandonner(int i){
+    metriques.migrations_abandonnees++;
+    nb_migrations--;
+    controleur.echanges[process[i].cible].en_cours--;
+    envoyer(&process[i].gpid, sizeof(gpid_t), process[i].cible, TAG_MIGRATION_ABANDON);
+}
+
+/**
+ * @brief migration_checkpoint_pret - le processus en ETAT_CHECKPOINT s'est terminé :
+ *                                    on envoie l'enveloppe du processus puis son checkpoint
+ * 
+ * @param i             indice du processus dans la table process
+ * @param etat_sortie   status renvoyé par waitpid (cf processus_termines)
+ */
+
+void migration_checkpoint_pret(int i, int etat_sortie){
+    char chemin[PATH_MAX];
+    struct stat infos;
+
+    process[i].pid = 0;
+    chemin_checkpoint(chemin, sizeof(chemin), process[i].gpid);
+
+    if(WIFEXITED(etat_sortie) && WEXITSTATUS(etat_sortie) == CODE_CHECKPOINT){
+        // Tâche coopérative : son état est dans le fichier de checkpoint
+        process[i].fd = open(chemin, O_RDONLY | O_CLOEXEC);
+        if(process[i].fd != -1 && fstat(process[i].fd, &infos) == 0){
+            process[i].taille_checkpoint = infos.st_size;
+        }else{
+            // Le processus sera relancé depuis le début sur la cible
+            JOURNAL(LOG_ERREUR, "%s : checkpoint du gpid %lld illisible (%s), %d le relancera depuis le début\n", hostname,
+                    (long long) process[i].gpid, strerror(errno), process[i].cible);
+            if(process[i].fd != -1)
+                close(process[i].fd);
+            process[i].fd = -1;
+            process[i].taille_checkpoint = 0;
+        }
+    }else if(WIFSIGNALED(etat_sortie) && WTERMSIG(etat_sortie) == SIGNAL_CHECKPOINT){
+        // Tâche qui ne gère pas le checkpoint : elle sera relancée depuis le début
+        process[i].taille_checkpoint = 0;
+    }else{
+        // La tâche s'est terminée d'elle-même (ou par un gkill) avant d'écrire son état : rien à migrer
+        migration_abandonner(i);
+        terminer_processus(i, etat_sortie);
+        return;
+    }
+
+    process[i].position_checkpoint = 0;
+    process[i].etat = ETAT_ENVOI;
+    envoyer_enveloppe_donnees(process[i].cible, TAG_TRANSFERT, process[i].gpid, process[i].groupe, process[i].argv, process[i].taille_checkpoint);
+}
+
+/**
+ * @brief migration_terminer - le checkpoint est entièrement envoyé : on retire le processus
+ *                             de cette machine
+ * 
+ * @param i         indice du processus dans la table process
+ */
+
+void migration_terminer(int i){
+    struct timespec fin;
+
+    clock_gettime(CLOCK_MONOTONIC, &fin);
+    uint64_t duree_ns = (fin.tv_sec - process[i].debut_migration.tv_sec) * 1000000000ULL + fin.tv_nsec - process[i].debut_migration.tv_nsec;
+    metriques.migrations_envoyees++;
+    metriques.octets_migres_envoyes += process[i].taille_checkpoint;
+    histo_ajouter(&metriques.duree_envoi, duree_ns);
+    JOURNAL(LOG_INFO, "%s a transféré le gpid %lld à %d : %lld octets en %.1f ms\n", hostname, (long long) process[i].gpid, process[i].cible,
+                      process[i].taille_checkpoint, duree_ns / 1e6);
+    nb_migrations--;
+    controleur.echanges[process[i].cible].en_cours--;
+    migration_retirer(i);
+}
+
+/**
+ * @brief migration_retirer - le processus appartient désormais à sa machine cible :
+ *                            on le retire de cette machine
+ * 
+ * @param i         indice du processus dans la table process
+ */
+
+void migration_retirer(int i){
+    if(process[i].fd != -1)
+        close(process[i].fd);
+    // Un gkill qui arrive encore ici suivra le processus chez sa nouvelle machine
+    renvoi_noter(process[i].gpid, process[i].cible);
+    registre_noter(REG_TRANSFERT, i, process[i].cible);
+    retirer_processus(i);
+}
+
+/**
+ * @brief migrations_progresser - fait avancer les migrations en cours sans bloquer : envoie
+ *                                les checkpoints par blocs (au plus FENETRE_MIGRATION envois en cours)
+ *                                et abandonne les demandes de checkpoint restées sans réponse
+ *                                DELAI_CHECKPOINT_MS ms
+ * 
+ */
+
+void migrations_progresser(){
+    char *bloc = NULL;
+    int taille_bloc = TAILLE_MESSAGE - sizeof(gpid_t);
+
+    if(nb_migrations == 0)
+        return;
+
+    double maintenant = maintenant_ms();
+    for(int i = 0; i < process_capacite; i++){
+        if(process[i].gpid == 0)
+            continue;
+
+        if(process[i].etat == ETAT_CHECKPOINT && maintenant >= process[i].limite_checkpoint_ms){
+            // La tâche ignore SIGNAL_CHECKPOINT : elle continue ici, et gkill l'atteint comme avant
+            JOURNAL(LOG_ERREUR, "%s : le gpid %lld n'a pas écrit son checkpoint en %d ms, il reste ici\n", hostname,
+                    (long long) process[i].gpid, DELAI_CHECKPOINT_MS);
+            migration_abandonner(i);
+            process[i].etat = ETAT_ACTIF;
+        }else if(process[i].etat == ETAT_ENVOI){
+            // Chaque bloc commence par le gpid pour que la cible retrouve le processus
+            while(process[i].position_checkpoint < process[i].taille_checkpoint){
+                envoi_progresser();
+                if(nb_envois >= FENETRE_MIGRATION)
+                    break;
+                if(bloc == NULL && (bloc = (char *) malloc(TAILLE_MESSAGE)) == NULL){
+                    // La cible relancera le processus depuis le début, on ne le garde pas ici
+                    JOURNAL(LOG_ERREUR, "%s : pas de mémoire pour envoyer le checkpoint du gpid %lld, %d le relancera depuis le début\n",
+                            hostname, (long long) process[i].gpid, process[i].cible);
+                    migration_abandonner(i);
+                    migration_retirer(i);
+                    break;
+                }
+                memcpy(bloc, &process[i].gpid, sizeof(gpid_t));
+                ssize_t lus = pread(process[i].fd, bloc + sizeof(gpid_t), taille_bloc, process[i].position_checkpoint);
+                if(lus <= 0){
+                    // Le reste du checkpoint est perdu : la cible relancera le processus depuis le début
+                    JOURNAL(LOG_ERREUR, "%s : lecture du checkpoint du gpid %lld impossible (%s), %d le relancera depuis le début\n",
+                            hostname, (long long) process[i].gpid, lus == 0 ? "fichier tronqué" : strerror(errno), process[i].cible);
+                    envoyer(&process[i].gpid, sizeof(gpid_t), process[i].cible, TAG_MIGRATION_ABANDON);
+                    process[i].taille_checkpoint = process[i].position_checkpoint;
+                    break;
+                }
+                envoyer(bloc, sizeof(gpid_t) + lus, process[i].cible, TAG_TRANSFERT_DONNEES);
+                process[i].position_checkpoint += lus;
+            }
+            if(process[i].etat == ETAT_ENVOI && process[i].position_checkpoint >= process[i].taille_checkpoint)
+                migration_terminer(i);
+        }
+    }
+    free(bloc);
+}
+
+/**
+ * @brief  transfert les taches d'une machine vers une autre qui particpe dans le réseau
+ * 
+ * @param id_machine        identifiant de la machine destinataire
+ * @param nb                nombre de tâches à transférer (équilibrage),
+ *                          -1 pour toutes les transférer (retrait du réseau)
+ */
+
+void transfert_tache(int id_machine, int nb){
+    // On parcours la table des processus lancé sur la machine
+    for(int i=0; i < process_capacite && nb != 0; i++){
+        // Si une tâche s'exécute et n'est pas déjà en cours de migration
+        if(process[i].gpid != 0 && process[i].etat == ETAT_ACTIF && process[i].pid != 0){
+            // On lui demande son checkpoint, l'envoi se fait ensuite dans migrations_progresser()
+            migrer(i, id_machine);
+            if(nb > 0)
+                nb--;
+        }
+    }
+
+}
+
+/*****************************************EQUILIBRAGE*********************************************/
+
+/*
+ * Le contrôleur d'équilibrage (option --equilibrage) tourne à chaque mesure de charge :
+ *  - hystérésis : une machine entre en surcharge au-dessus de SURCHARGE_POURCENT % de la charge
+ *    moyenne des participants et n'en sort qu'en repassant sous RETOUR_POURCENT % ;
+ *  - dimensionnement : elle calcule combien de tâches céder pour revenir à la moyenne en une fois
+ *    (cf charge_par_tache) et les répartit entre les machines sous la moyenne,
+ *    en proportion de ce qui manque à chacune pour atteindre la moyenne ;
+ *  - paires : chaque envoi est d'abord proposé (TAG_EQUILIBRAGE) et la cible répond avec le nombre
+ *    de tâches qu'elle accepte : ce qui l'amène à la moyenne, d'après sa propre charge et le poids
+ *    d'une tâche chez elle (les machines n'ont pas toutes le même nombre de coeurs). Une machine
+ *    refuse une proposition d'un pair avec qui un échange est en cours (proposition en attente ou
+ *    migrations dans un sens ou l'autre) : il y a au plus un équilibrage à la fois par paire, et
+ *    deux propositions croisées sont refusées. Les tâches acceptées comptent dans la charge de la
+ *    cible tant qu'elles ne sont pas arrivées et mesurées, pour que plusieurs propositions
+ *    simultanées ne lui fassent pas dépasser la moyenne ;
+ *  - repos : une machine qui a des migrations en cours ne propose rien, puis attend MESURES_REPOS
+ *    mesures pour que sa charge et celle des autres reflètent les tâches déplacées ; et des tâches
+ *    reçues d'une machine ne peuvent pas lui être renvoyées avant repos_equilibrage_ms.
+ */
+
+#ifndef SIMULATION
+
+/**
+ * @brief maintenant_ms - date monotone en millisecondes (toujours positive : 0 veut dire « jamais »
+ *                        dans les échanges du contrôleur). Le simulateur fournit son horloge virtuelle.
+ */
+
+double maintenant_ms(){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}
+
+#endif
+
+/**
+ * @brief controleur_init - état initial du contrôleur : aucun échange avec personne.
+ *                          Tout est à 0 : calloc suffit, les pages des pairs avec qui on n'échange
+ *                          jamais ne sont pas touchées (des milliers de rangs en simulation)
+ * 
+ * @param c         contrôleur
+ * @param nb        nombre de machines
+ */
+
+void controleur_init(struct controleur *c, int nb){
+    memset(c, 0, sizeof(struct controleur));
+    c->echanges = (struct echange *) calloc(nb, sizeof(struct echange));
+    if(!c->echanges){
+        perror("controleur_init");
+        exit(1);
+    }
+}
+
+/**
+ * @brief envoi_possible - 1 si des tâches peuvent partir de la machine de c vers le pair j : aucun
+ *                         échange en cours avec lui, et pas de tâches reçues de lui depuis moins
+ *                         de repos_equilibrage_ms (elles y retourneraient)
+ * 
+ * @param c             contrôleur de la machine qui céderait les tâches
+ * @param j             identifiant du pair
+ * @param maintenant    date en ms
+ * @return int          1 si l'envoi est possible, sinon 0
+ */
+
+int envoi_possible(const struct controleur *c, int j, double maintenant){
+    const struct echange *x = &c->echanges[j];
+    return x->en_cours == 0 && !x->demande
+           && (x->reception_ms == 0 || maintenant - x->reception_ms >= repos_equilibrage_ms);
+}
+
+/**
+ * @brief equilibrage_planifier - met à jour l'hystérésis et, si la machine est en surcharge et reposée,
+ *                                calcule les propositions qui la ramènent à la charge moyenne
+ * 
+ * @param c             contrôleur
+ * @param nb_taches     nombre de nos tâches migrables
+ * @param maintenant    date en ms
+ * @param plan          propositions calculées (au moins nb_proc cases)
+ * @return int          nombre de propositions
+ */
+
+int equilibrage_planifier(struct controleur *c, int nb_taches, double maintenant, struct demande_equilibrage *plan){
+    float moyenne = CalculCharge();
+    float charge = tab_charge[rank];
+
+    if(!c->en_surcharge){
+        if(charge > moyenne * SURCHARGE_POURCENT / 100.0 && charge - moyenne > ECART_MIN_CHARGE)
+            c->en_surcharge = 1;
+    }else if(charge < moyenne * RETOUR_POURCENT / 100.0 || charge - moyenne <= ECART_MIN_CHARGE){
+        c->en_surcharge = 0;
+    }
+    // Repos : tant que des réponses ou des migrations sont attendues, puis MESURES_REPOS mesures
+    for(int i = 1; i < nb_proc; i++){
+        if(c->echanges[i].demande || c->echanges[i].en_cours > 0){
+            c->repos_ms = maintenant + MESURES_REPOS * periode_moniteur_ms;
+            return 0;
+        }
+    }
+    if(!c->en_surcharge || nb_taches == 0 || maintenant < c->repos_ms)
+        return 0;
+
+    // Tâches à céder pour revenir à la moyenne : céder une tâche de trop nous ferait passer sous la moyenne
+    int a_ceder = (int) ((charge - moyenne) / charge_par_tache(nb_taches) + 0.5);
+    if(a_ceder > nb_taches)
+        a_ceder = nb_taches;
+
+    // Cibles possibles, de la moins chargée à la plus chargée, et ce qui manque à chacune pour la moyenne
+    int cibles[nb_proc];
+    int nb_cibles = 0;
+    float manque_total = 0;
+    for(int i = 1; i < nb_proc; i++){
+        if(i == rank || !tab_participe[i] || !envoi_possible(c, i, maintenant)
+           || charge_estimee(i) >= moyenne)
+            continue;
+        manque_total += moyenne - charge_estimee(i);
+        int k = nb_cibles++;
+        while(k > 0 && charge_estimee(cibles[k - 1]) > charge_estimee(i)){
+            cibles[k] = cibles[k - 1];
+            k--;
+        }
+        cibles[k] = i;
+    }
+
+    // Répartition au prorata du manque, la cible la moins chargée d'abord ; chaque cible réduit
+    // ensuite sa part à ce qui l'amène à la moyenne (equilibrage_accepter)
+    int nb_plan = 0;
+    int reste = a_ceder;
+    for(int k = 0; k < nb_cibles && reste > 0; k++){
+        int nb = (int) (a_ceder * (moyenne - charge_estimee(cibles[k])) / manque_total + 0.5);
+        if(nb < 1)
+            nb = 1;
+        if(nb > reste)
+            nb = reste;
+        plan[nb_plan].cible = cibles[k];
+        plan[nb_plan].nb = nb;
+        reste -= nb;
+        nb_plan++;
+    }
+    return nb_plan;
+}
+
+/**
+ * @brief equilibrage_accepter - réponse à une proposition d'équilibrage : on prend au plus
+ *                               ce qui nous amène à la charge moyenne
+ * 
+ * @param c             contrôleur
+ * @param source        machine qui propose ses tâches
+ * @param nb            nombre de tâches proposées
+ * @param charge_tache  charge qu'une de ces tâches ajouterait chez nous (cf charge_par_tache)
+ * @param maintenant    date en ms
+ * @return int          nombre de tâches acceptées (0 : refus)
+ */
+
+int equilibrage_accepter(struct controleur *c, int source, int nb, float charge_tache, double maintenant){
+    // Nos tâches qui viennent de partir vers source n'en reviennent pas
+    const struct echange *x = &c->echanges[source];
+    if(!tab_participe[rank] || charge_tache <= 0 || x->en_cours > 0 || x->demande
+       || (x->envoi_ms > 0 && maintenant - x->envoi_ms < repos_equilibrage_ms))
+        return 0;
+
+    // Charge promise aux équilibrages récents : tâches pas encore arrivées, ou pas encore mesurées
+    float promise = 0;
+    for(int i = 1; i < nb_proc; i++){
+        const struct echange *y = &c->echanges[i];
+        if(y->reception_ms > 0 && (y->en_cours > 0 || maintenant - y->reception_ms < MESURES_REPOS * periode_moniteur_ms))
+            promise += y->charge_promise;
+    }
+    int acceptes = (int) ((CalculCharge() - charge_estimee(rank) - promise) / charge_tache + 0.5);
+    if(acceptes > nb)
+        acceptes = nb;
+    if(acceptes <= 0)
+        return 0;
+    c->echanges[source].reception_ms = maintenant;
+    c->echanges[source].charge_promise = acceptes * charge_tache;
+    c->echanges[source].nb_promis = acceptes;
+    return acceptes;
+}
+
+/**
+ * @brief premier_en_surcharge - 1 si on est, d'après notre vue des charges, le participant de plus petit
+ *                               rang en surcharge : lui seul ajoute une machine quand aucune ne peut
+ *                               recevoir de tâches
+ * 
+ * @return int          1 si c'est à nous d'ajouter une machine
+ */
+
+int premier_en_surcharge(){
+    float moyenne = CalculCharge();
+    for(int i = 1; i < nb_proc; i++){
+        if(tab_participe[i] && tab_charge[i] > moyenne * SURCHARGE_POURCENT / 100.0)
+            return i == rank;
+    }
+    return 0;
+}
+
+/**
+ * @brief taches_migrables - nombre de nos processus qui tournent et ne sont pas déjà en migration
+ */
+
+int taches_migrables(){
+    int nb = 0;
+    for(int i = 0; i < process_capacite; i++){
+        if(process[i].gpid != 0 && process[i].etat == ETAT_ACTIF && process[i].pid != 0)
+            nb++;
+    }
+    return nb;
+}
+
+/**
+ * @brief equilibrer - tour du contrôleur d'équilibrage, après chaque mesure de charge
+ * 
+ */
+
+void equilibrer(){
+    struct demande_equilibrage plan[nb_proc];
+    double maintenant = maintenant_ms();
+
+    if(tab_participe[rank] != 1)
+        return;
+
+    int nb_plan = equilibrage_planifier(&controleur, taches_migrables(), maintenant, plan);
+    for(int k = 0; k < nb_plan; k++){
+        JOURNAL(LOG_INFO, "%s (charge %.2f) propose %d tâche(s) à %d (charge %.2f)\n", hostname, tab_charge[rank],
+                          plan[k].nb, plan[k].cible, charge_estimee(plan[k].cible));
+        envoyer(&plan[k].nb, sizeof(int), plan[k].cible, TAG_EQUILIBRAGE);
+        controleur.echanges[plan[k].cible].demande = 1;
+    }
+    if(nb_plan > 0)
+        return;
+
+    if(controleur.en_surcharge){
+        // Personne ne peut recevoir nos tâches : si le réseau est saturé, on fait entrer une machine,
+        // puis on lui laisse le temps de s'annoncer
+        if(maintenant >= controleur.repos_ms && CalculCharge() >= seuil_capacite && premier_en_surcharge()){
+            AddMachine();
+            controleur.repos_ms = maintenant + repos_equilibrage_ms;
+        }
+    }else{
+        souscharge();
+    }
+}
+
+/**
+ * @brief recv_equilibrage - une machine nous propose des tâches : on répond avec le nombre accepté
+ * 
+ * @param source        machine qui propose
+ * @param nb            nombre de tâches proposées
+ */
+
+void recv_equilibrage(int source, int nb){
+    int acceptes = equilibrage_accepter(&controleur, source, nb, charge_par_tache(taches_migrables()), maintenant_ms());
+    envoyer(&acceptes, sizeof(int), source, TAG_EQUILIBRAGE_REPONSE);
+}
+
+/**
+ * @brief recv_equilibrage_reponse - la cible a répondu à notre proposition : on migre les tâches acceptées
+ * 
+ * @param source        cible de la proposition
+ * @param acceptes      nombre de tâches acceptées
+ */
+
+void recv_equilibrage_reponse(int source, int acceptes){
+    struct echange *x = &controleur.echanges[source];
+
+    x->demande = 0;
+    // Après un refus, on essaiera les autres cibles à la prochaine mesure
+    if(acceptes > 0 && tab_participe[rank] == 1){
+        JOURNAL(LOG_INFO, "%s transfère %d tâche(s) à %d\n", hostname, acceptes, source);
+        x->envoi_ms = maintenant_ms();
+        transfert_tache(source, acceptes);
+    }
+}
+
+/**
+ * @brief recv_migration_abandon - une tâche qu'on avait acceptée de source ne viendra pas : on
+ *                                 retire sa part de la charge promise, pour ne pas refuser des
+ *                                 tâches à cause d'elle jusqu'à la fin de MESURES_REPOS.
+ *                                 Si son checkpoint est déjà en cours de réception, source n'a pas
+ *                                 pu le lire jusqu'au bout : on la relance depuis le début
+ * 
+ * @param source        machine qui abandonne la migration
+ * @param gpid          gpid de la tâche
+ */
+
+void recv_migration_abandon(int source, gpid_t gpid){
+    struct echange *x = &controleur.echanges[source];
+    struct entree_gpid e;
+
+    if(annuaire_lire(gpid, &e) && e.rang == rank && process[e.indice].gpid == gpid
+       && process[e.indice].etat == ETAT_RECEPTION && process[e.indice].cible == source){
+        reception_perdre(e.indice);
+        reception_terminer(e.indice);
+        return;
+    }
+    JOURNAL(LOG_INFO, "%s : %d abandonne la migration du gpid %lld\n", hostname, source, (long long) gpid);
+    if(x->nb_promis > 0){
+        x->charge_promise -= x->charge_promise / x->nb_promis;
+        x->nb_promis--;
+    }
+}
+
+
+/*******************************************RETRAIT***********************************************/
+
+/**
+ * @brief souscharge - détection de la sous-charge
+ * 
+ */
+
+void souscharge(){
+    int cpt = 0;
+    if(tab_participe[rank] == 1){ // participant
+        
+        // On calcul la charge globale moyenne
+        charge_globale = CalculCharge();  
+         
+        // Si on est en souscharge par rapport à la charge globale du réseau, sur MESURES_RETRAIT mesures de suite
+        // et sans migration en cours (une machine qui vient de céder ses tâches est forcément peu chargée)
+        if(tab_charge[rank] < charge_globale * MIN_POURCENT / 100.0)
+            controleur.mesures_sous_charge++;
+        else
+            controleur.mesures_sous_charge = 0;
+        if(controleur.mesures_sous_charge >= MESURES_RETRAIT && nb_migrations == 0){
+            JOURNAL(LOG_INFO, "Machine %s en souscharge\n", hostname);
+
+            // On cherche s'il y a au moins 2 participants dans le réseau
+            for(int i = 1; i < nb_proc; i++){
+                if(tab_participe[i] == 1){
+                    cpt++;
+                }
+
+                if(cpt == 2)
+                    break;
+            }
+
+            if(cpt < 2){
+                JOURNAL(LOG_INFO, "Pas assez de machine connecté pour en retirer.\n");
+                return;
+            }
+
+            // On parcours la table des processus (avec --elastique, en partant de la fin : les serveurs
+            // créés sortent les premiers, puis s'arrêtent)
+            for(int j = 1; j < nb_proc; j++){
+                int i = elastique > 0 ? nb_proc - j : j;
+
+                // Si le processus est participant et qu'il est en sous charge
+                if((tab_participe[i] == 1) && (tab_charge[i] < charge_globale * MIN_POURCENT / 100.0)){
+                    // ! cette vérification est importante car si jamais on a plusieurs machines en souscharge 
+                    // ! on doit enlever qu'UNE seule machine
+                    // ! donc on enlève la première qu'on trouve dans le tableau des charges globales du réseau
+                    // ! on évite ainsi un interblocage
+                    if(i == rank){ // je suis la première machine en sous charge
+                        JOURNAL(LOG_INFO, "Je suis en souscharge %s car %d=%d\n", hostname, i, rank);
+                        // Le coordinateur ordonne les sorties : on ne quitte le réseau (quitter_reseau)
+                        // qu'à l'installation de la vue qui nous retire
+                        controleur.mesures_sous_charge = 0;
+                        demander_vue(VUE_RETRAIT, rank);
+                    }
+                    /* sinon
+                    *    ce n'est pas moi qui est en premier mais quelqu'un d'autre
+                    *    je ne fais rien et c'est la machine concernant qui le fera
+                    */
+                    break;
+                }
+            }
+
+            
+        } // else rien car pas en sous charge
+
+    } // else non participant donc ne peux pas detecter de sous charge
+}
+
+/***************************************************************************************************
+                                Fonctions de gestions des charges
+***************************************************************************************************/
+
+/* Échantillonneur de charge : les fichiers de /proc restent ouverts et sont relus avec pread,
+   les échantillons et leur moyenne mobile exponentielle sont conservés dans un anneau */
+
+struct echantillon{
+    float brute;                // Charge composite mesurée
+    float lissee;               // Moyenne mobile exponentielle après cette mesure
+};
+
+struct echantillonneur{
+    int fd_stat;                                // "/proc/stat" ouvert (-1 si indisponible)
+    int fd_meminfo;                             // "/proc/meminfo" ouvert (-1 si indisponible)
+    long coeurs;                                // Nombre de coeurs en ligne
+    unsigned long long cpu_actif_precedent;     // Temps CPU actif cumulé lors de la mesure précédente
+    unsigned long long cpu_total_precedent;     // Temps CPU total cumulé lors de la mesure précédente
+    struct echantillon historique[HISTORIQUE_CHARGE]; // Anneau des derniers échantillons
+    int prochain;                               // Case de l'anneau qui recevra le prochain échantillon
+    int nb;                                     // Nombre d'échantillons dans l'anneau
+    float moyenne;                              // Moyenne mobile exponentielle courante
+}echantillonneur = {.fd_stat = -1, .fd_meminfo = -1};
+
+char tampon_proc[TAILLE_LECTURE_PROC];          // Tampon de lecture des fichiers de /proc
+
+/**
+ * @brief echantillonneur_ouvrir - ouvre une fois pour toutes les fichiers de /proc lus à chaque mesure
+ * 
+ */
+
+void echantillonneur_ouvrir(){
+    echantillonneur.fd_stat = open("/proc/stat", O_RDONLY | O_CLOEXEC);
+    if(echantillonneur.fd_stat == -1)
+        perror("echantillonneur : /proc/stat");
+    echantillonneur.fd_meminfo = open("/proc/meminfo", O_RDONLY | O_CLOEXEC);
+    if(echantillonneur.fd_meminfo == -1)
+        perror("echantillonneur : /proc/meminfo");
+    echantillonneur.coeurs = sysconf(_SC_NPROCESSORS_ONLN);
+    if(echantillonneur.coeurs < 1)
+        echantillonneur.coeurs = 1;
+}
+
+/**
+ * @brief echantillonneur_fermer - ferme les fichiers de /proc de l'échantillonneur
+ * 
+ */
+
+void echantillonneur_fermer(){
+    if(echantillonneur.fd_stat != -1)
+        close(echantillonneur.fd_stat);
+    if(echantillonneur.fd_meminfo != -1)
+        close(echantillonneur.fd_meminfo);
+    echantillonneur.fd_stat = -1;
+    echantillonneur.fd_meminfo = -1;
+}
+
+/**
+ * @brief lire_proc - relit entièrement un fichier de /proc déjà ouvert dans tampon_proc
+ * 
+ * @param fd        descripteur du fichier
+ * @return int      nombre d'octets lus (le tampon est terminé par '\0'), -1 en cas d'erreur
+ */
+
+int lire_proc(int fd){
+    int lus = 0;
+    ssize_t n;
+
+    if(fd == -1)
+        return -1;
+    while(lus < TAILLE_LECTURE_PROC - 1){
+        n = pread(fd, tampon_proc + lus, TAILLE_LECTURE_PROC - 1 - lus, lus);
+        if(n < 0)
+            return -1;
+        if(n == 0)
+            break;
+        lus += n;
+    }
+    tampon_proc[lus] = '\0';
+    return lus;
+}
+
+/**
+ * @brief lire_nombre - lit un entier non signé décimal en sautant les espaces qui le précèdent
+ * 
+ * @param p                     position de lecture, avancée après le nombre
+ * @return unsigned long long   le nombre lu (0 s'il n'y en a pas)
+ */
+
+static inline unsigned long long lire_nombre(const char **p){
+    unsigned long long n = 0;
+    const char *c = *p;
+
+    while(*c == ' ' || *c == '\t')
+        c++;
+    while(*c >= '0' && *c <= '9'){
+        n = n * 10 + (*c - '0');
+        c++;
+    }
+    *p = c;
+    return n;
+}
+
+/**
+ * @brief chercher_ligne - cherche une ligne commençant par cle dans tampon_proc
+ * 
+ * @param cle           début de la ligne recherchée (ex : "procs_running ")
+ * @return const char*  position juste après la clé, NULL si la ligne n'existe pas
+ */
+
+static const char* chercher_ligne(const char *cle){
+    int longueur = strlen(cle);
+    const char *ligne = tampon_proc;
+
+    while(ligne != NULL && *ligne != '\0'){
+        if(strncmp(ligne, cle, longueur) == 0)
+            return ligne + longueur;
+        ligne = strchr(ligne, '\n');
+        if(ligne != NULL)
+            ligne++;
+    }
+    return NULL;
+}
+
+/**
+ * @brief getCharge - mesure la charge composite de la machine et met à jour sa moyenne mobile :
+ *                    - utilisation CPU instantanée, depuis la mesure précédente ("/proc/stat")
+ *                    - processus prêts à s'exécuter par coeur en ligne ("procs_running" de "/proc/stat")
+ *                    - part de la mémoire utilisée (MemAvailable / MemTotal de "/proc/meminfo")
+ *                    La charge est rapportée au nombre de coeurs : une machine 64 coeurs et une
+ *                    machine 4 coeurs qui font tourner le même nombre de tâches n'ont pas la même charge.
+ *                    Aucune allocation ni ouverture de fichier : les descripteurs restent ouverts.
+ * 
+ * @return float      retourne la moyenne mobile de cette charge (0 = machine libre, environ 1 = machine saturée)
+ */
+ 
+float getCharge(){
+    struct echantillonneur *e = &echantillonneur;
+    const char *p;
+    float cpu = 0.0, file = 0.0, memoire = 0.0;
+
+    if(e->fd_stat == -1 && e->fd_meminfo == -1)
+        echantillonneur_ouvrir();
+
+    if(lire_proc(e->fd_stat) > 0){
+        // Première ligne : "cpu  user nice system idle iowait irq softirq steal ..."
+        if((p = chercher_ligne("cpu ")) != NULL){
+            unsigned long long v[8];
+            for(int i = 0; i < 8; i++)
+                v[i] = lire_nombre(&p);
+            unsigned long long actif = v[0] + v[1] + v[2] + v[5] + v[6] + v[7];
+            unsigned long long total = actif + v[3] + v[4];
+            // Utilisation CPU sur l'intervalle depuis la mesure précédente
+            if(total > e->cpu_total_precedent)
+                cpu = (float)(actif - e->cpu_actif_precedent) / (float)(total - e->cpu_total_precedent);
+            e->cpu_actif_precedent = actif;
+            e->cpu_total_precedent = total;
+        }
+        // File d'exécution par coeur, sans compter le serveur qui fait la mesure
+        if((p = chercher_ligne("procs_running ")) != NULL){
+            unsigned long long prets = lire_nombre(&p);
+            if(prets > 1)
+                file = (float)(prets - 1) / e->coeurs;
+        }
+    }
+
+    if(lire_proc(e->fd_meminfo) > 0){
+        const char *total = chercher_ligne("MemTotal:");
+        const char *disponible = chercher_ligne("MemAvailable:");
+        if(total != NULL && disponible != NULL){
+            unsigned long long mem_total = lire_nombre(&total);
+            unsigned long long mem_disponible = lire_nombre(&disponible);
+            if(mem_total > 0)
+                memoire = 1.0 - (float) mem_disponible / mem_total;
+        }
+    }
+
+    // Ajout de l'échantillon dans l'anneau avec la nouvelle moyenne mobile
+    float brute = POIDS_CPU * cpu + POIDS_FILE * file + POIDS_MEM * memoire;
+    e->moyenne = (e->nb == 0) ? brute : ALPHA_CHARGE * brute + (1.0 - ALPHA_CHARGE) * e->moyenne;
+    e->historique[e->prochain].brute = brute;
+    e->historique[e->prochain].lissee = e->moyenne;
+    e->prochain = (e->prochain + 1) % HISTORIQUE_CHARGE;
+    if(e->nb < HISTORIQUE_CHARGE)
+        e->nb++;
+
+    return e->moyenne;
+}
+
+/**
+ * @brief charge_ecrire - écrit une case de la table des charges, que les serveurs du noeud lisent
+ *                        pendant l'écriture (seul écrivain de la case : la séquence suffit)
+ * 
+ * @param i         identifiant de la machine
+ * @param charge    sa charge
+ * @param version   version de cette charge
+ */
+
+static inline void charge_ecrire(int i, float charge, int version){
+    atomic_fetch_add_explicit(&tab_sequence[i], 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    tab_charge[i] = charge;
+    tab_version[i] = version;
+    atomic_fetch_add_explicit(&tab_sequence[i], 1, memory_order_release);
+}
+
+/**
+ * @brief charge_lire - lit une charge et sa version d'un seul tenant (recommence si la case était en écriture)
+ * 
+ * @param i         identifiant de la machine
+ * @param c         reçoit la charge et sa version
+ */
+
+static inline void charge_lire(int i, struct charge_versionnee *c){
+    unsigned int sequence;
+    do{
+        sequence = atomic_load_explicit(&tab_sequence[i], memory_order_acquire);
+        c->charge = tab_charge[i];
+        c->version = tab_version[i];
+        atomic_thread_fence(memory_order_acquire);
+    }while((sequence & 1) || atomic_load_explicit(&tab_sequence[i], memory_order_relaxed) != sequence);
+}
+
+/**
+ * @brief notifyCharge - enregistre la charge mesurée de la machine dans la table du noeud, puis si on est
+ *                       le chef du noeud fait un tour de gossip : le vecteur complet des charges connues
+ *                       est envoyé au chef d'un seul autre noeud, situé à la distance 2^(tour mod log2(P))
+ *                       parmi les P noeuds qui ont un participant. Chaque noeud n'envoie qu'un message
+ *                       par tour et toutes les charges sont connues de tous en ceil(log2(P)) tours.
+ * 
+ * @param charge     charge de la machine qui vient d'être mesurée
+ * @return * void 
+ */
+ 
+void notifyCharge(float charge){
+    int chefs[nb_proc];
+    char noeud_participe[nb_proc];
+    int nb_chefs = 0;
+    int position = -1;
+
+    // Nouvelle version : les placements comptés dans tab_en_attente[rank] sont dans cette charge
+    charge_ecrire(rank, charge, tab_version[rank] + 1);
+    JOURNAL(LOG_DEBUG, "%d a pour charge %2f\n", rank, tab_charge[rank]);
+    if(tab_chef[rank] != rank)
+        return;
+
+    // Liste ordonnée des chefs des noeuds qui ont un participant et notre position dans cette liste
+    memset(noeud_participe, 0, nb_proc);
+    for(int i = 1; i < nb_proc; i++){
+        if(tab_participe[i])
+            noeud_participe[tab_chef[i]] = 1;
+    }
+    for(int i = 1; i < nb_proc; i++){
+        if(tab_chef[i] == i && noeud_participe[i]){
+            if(i == rank)
+                position = nb_chefs;
+            chefs[nb_chefs++] = i;
+        }
+    }
+    if(position == -1 || nb_chefs < 2)
+        return;
+
+    // Nombre de tours nécessaires pour couvrir tous les noeuds
+    int nb_tours = 0;
+    while((1 << nb_tours) < nb_chefs)
+        nb_tours++;
+    int distance = 1 << (tour_gossip % nb_tours);
+    tour_gossip++;
+
+    for(int i = 0; i < nb_proc; i++)
+        charge_lire(i, &tampon_gossip[i]);
+    envoyer(tampon_gossip, nb_proc * sizeof(struct charge_versionnee),
+            chefs[(position + distance) % nb_chefs], TAG_CHARGE);
+}
+
+/**
+ * @brief recv_charge - fusionne un vecteur de charges reçu par le chef du noeud : on ne garde que les
+ *                      charges plus récentes que celles déjà connues. Les serveurs du noeud écrivent
+ *                      eux-mêmes les leurs.
+ * 
+ * @param nb        nombre de charges du vecteur (l'émetteur a pu l'envoyer avant une création de serveur)
+ */
+
+void recv_charge(int nb){
+    for(int i = 0; i < nb && i < nb_proc; i++){
+        if(tab_chef[i] != tab_chef[rank] && tampon_gossip[i].version > tab_version[i])
+            charge_ecrire(i, tampon_gossip[i].charge, tampon_gossip[i].version);
+    }
+}
+
+/**
+ * @brief CalculCharge - calcule la moyenne des charges des machines
+ *                       participant dans le réseau
+ * 
+ * @return float      retourne la moyenne des charges
+ */
+
+float CalculCharge(){
+    float tmp_global = 0.0;
+    int nbr_machine = 0;
+    for(int i = 1; i < nb_proc; i++){
+        if(tab_participe[i] == 1){
+            tmp_global += tab_charge[i];
+            nbr_machine += tab_participe[i];
+        }
+    }
+    // Divise par le nombre de machine participantes
+    tmp_global /= nbr_machine*1.0;
+    return tmp_global;
+}
+
+/**
+ * @brief charge_estimee - charge d'une machine corrigée des placements qu'on lui a envoyés
+ *                         depuis sa dernière charge connue (une nouvelle version en tient compte)
+ * 
+ * @param i         identifiant de la machine
+ * @return float    charge estimée
+ */
+
+float charge_estimee(int i){
+    if(version_en_attente[i] != tab_version[i])
+        return tab_charge[i];
+    return tab_charge[i] + tab_en_attente[i] * CHARGE_PLACEMENT;
+}
+
+/**
+ * @brief placement_compter - compte un placement envoyé à une machine, jusqu'à sa prochaine charge
+ * 
+ * @param i         identifiant de la machine
+ */
+
+void placement_compter(int i){
+    if(version_en_attente[i] != tab_version[i]){
+        version_en_attente[i] = tab_version[i];
+        tab_en_attente[i] = 0;
+    }
+    tab_en_attente[i]++;
+}
+
+/**
+ * @brief charge_par_tache - poids estimé d'une tâche dans notre charge : notre charge partagée entre
+ *                           nos tâches, ou sur une machine sans tâche ce qu'ajoute une tâche qui
+ *                           occupe un coeur (utilisation CPU et file d'exécution, cf getCharge)
+ * 
+ * @param nb_taches     nombre de nos tâches migrables
+ * @return float        charge d'une tâche
+ */
+
+float charge_par_tache(int nb_taches){
+    if(nb_taches > 0 && tab_charge[rank] > 0)
+        return tab_charge[rank] / nb_taches;
+    return (POIDS_CPU + POIDS_FILE) / (echantillonneur.coeurs > 0 ? echantillonneur.coeurs : 1);
+}
+
+/**
+ * @brief machine_disponible - 1 si la machine participe et que sa charge estimée est sous seuil_capacite
+ * 
+ * @param i         identifiant de la machine
+ * @return int      1 si elle peut recevoir une tâche, sinon 0
+ */
+
+int machine_disponible(int i){
+    return tab_participe[i] && charge_estimee(i) < seuil_capacite;
+}
+
+/**
+ * @brief reseau_sature - 1 si aucune machine participante n'est disponible : les gstart attendent alors en file
+ * 
+ * @return int      1 si toutes les machines sont saturées, sinon 0
+ */
+
+int reseau_sature(){
+    for(int i = 1; i < nb_proc; i++){
+        if(machine_disponible(i))
+            return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief placement_min - la machine participante dont la charge estimée est la plus faible
+ * 
+ * @return int     identifiant de la machine
+ */
+
+int placement_min(){
+    int i=0;
+
+    // on cherche le premier identifiant de machine participant
+    do{ 
+        i++;
+    }while((tab_participe[i] == 0) && i < nb_proc);
+
+    int id = i;
+    float min = charge_estimee(i);
+    
+    // Parcours de la table des participants
+    for(int i = id + 1; i < nb_proc; i++){
+        // Si une machine participe et qu'elle a une charge inférieur à min
+        if(tab_participe[i] && (charge_estimee(i) < min)){
+            min = charge_estimee(i);
+            id = i;
+        }
+    }
+    return id;
+}
+
+/**
+ * @brief placement_deux_choix - tire deux participants au hasard et garde le moins chargé
+ *                               (évite que toutes les demandes d'une rafale aillent au même argmin)
+ * 
+ * @return int     identifiant de la machine
+ */
+
+int placement_deux_choix(){
+    int participants[nb_proc];
+    int nb_participants = 0;
+
+    for(int i = 1; i < nb_proc; i++){
+        if(tab_participe[i])
+            participants[nb_participants++] = i;
+    }
+    if(nb_participants < 2)
+        return placement_min();
+
+    int a = participants[rand() % nb_participants];
+    int b = participants[rand() % (nb_participants - 1)];
+    if(b == a) // tirage sans remise : b prend la place du dernier participant
+        b = participants[nb_participants - 1];
+    return (charge_estimee(b) < charge_estimee(a)) ? b : a;
+}
+
+/**
+ * @brief placement_pondere - tire un participant au hasard avec une probabilité
+ *                            proportionnelle à l'inverse de sa charge estimée
+ * 
+ * @return int     identifiant de la machine
+ */
+
+int placement_pondere(){
+    double poids[nb_proc];
+    double total = 0.0;
+
+    for(int i = 1; i < nb_proc; i++){
+        poids[i] = tab_participe[i] ? 1.0 / (charge_estimee(i) + 0.05) : 0.0;
+        total += poids[i];
+    }
+    if(total == 0.0)
+        return placement_min();
+
+    double tirage = total * rand() / ((double) RAND_MAX + 1.0);
+    int dernier = 1;
+    for(int i = 1; i < nb_proc; i++){
+        if(poids[i] == 0.0)
+            continue;
+        dernier = i;
+        tirage -= poids[i];
+        if(tirage < 0)
+            return i;
+    }
+    return dernier;
+}
+
+/**
+ * @brief getIdMachineMoinsCharge - choisit la machine qui recevra une tâche selon la politique
+ *                                  de placement (la machine doit être participante).
+ *                                  Le placement est compté pour corriger la charge de la machine
+ *                                  choisie jusqu'à sa prochaine mise à jour.
+ * 
+ * @return int     retourne l'identifiant de la machine choisie
+ */
+
+
+int getIdMachineMoinsCharge(){
+    int id;
+
+    switch(politique_placement){
+        case PLACEMENT_DEUX_CHOIX:
+            id = placement_deux_choix();
+            break;
+        case PLACEMENT_PONDERE:
+            id = placement_pondere();
+            break;
+        default:
+            id = placement_min();
+            break;
+    }
+    // Les tirages au hasard peuvent tomber sur une machine saturée alors qu'il en reste de libres
+    if(!machine_disponible(id) && !reseau_sature())
+        id = placement_min();
+    if(id > 0 && id < nb_proc)
+        placement_compter(id);
+    return id;
+}
+
+
+/***************************************************************************************************
+                                        Moniteur de charge
+***************************************************************************************************/
+
+/*
+ * Un thread moniteur mesure la charge toutes les periode_moniteur_ms millisecondes et dépose
+ * chaque mesure dans une file sans verrou à un producteur et un consommateur.
+ * La boucle de réception vide la file : c'est elle qui fait le gossip et les décisions
+ * d'équilibrage, le moniteur n'appelle jamais MPI et ne touche pas aux tables.
+ */
+
+struct mesure_charge{
+    float charge;               // Charge mesurée
+    struct timespec date;       // Date de la mesure (CLOCK_MONOTONIC)
+};
+
+struct file_moniteur{
+    struct mesure_charge cases[TAILLE_FILE_MONITEUR];
+    atomic_uint tete;           // Prochaine case lue (modifiée par la boucle seulement)
+    atomic_uint queue;          // Prochaine case écrite (modifiée par le moniteur seulement)
+}file_moniteur;
+
+pthread_t moniteur;                     // Thread de mesure de la charge
+atomic_int moniteur_actif;              // Mis à 0 par la boucle pour arrêter le moniteur
+
+/**
+ * @brief file_moniteur_deposer - dépose une mesure (côté moniteur). Si la boucle a pris
+ *                                TAILLE_FILE_MONITEUR mesures de retard, la mesure est perdue.
+ * 
+ * @param m         mesure à déposer
+ * @return int      1 si la mesure a été déposée, 0 si la file est pleine
+ */
+
+int file_moniteur_deposer(const struct mesure_charge *m){
+    unsigned int queue = atomic_load_explicit(&file_moniteur.queue, memory_order_relaxed);
+    unsigned int tete = atomic_load_explicit(&file_moniteur.tete, memory_order_acquire);
+
+    if(queue - tete == TAILLE_FILE_MONITEUR)
+        return 0;
+    file_moniteur.cases[queue % TAILLE_FILE_MONITEUR] = *m;
+    atomic_store_explicit(&file_moniteur.queue, queue + 1, memory_order_release);
+    return 1;
+}
+
+/**
+ * @brief file_moniteur_retirer - retire la plus ancienne mesure (côté boucle de réception)
+ * 
+ * @param m         mesure retirée
+ * @return int      1 si une mesure a été retirée, 0 si la file est vide
+ */
+
+int file_moniteur_retirer(struct mesure_charge *m){
+    unsigned int tete = atomic_load_explicit(&file_moniteur.tete, memory_order_relaxed);
+    unsigned int queue = atomic_load_explicit(&file_moniteur.queue, memory_order_acquire);
+
+    if(tete == queue)
+        return 0;
+    *m = file_moniteur.cases[tete % TAILLE_FILE_MONITEUR];
+    atomic_store_explicit(&file_moniteur.tete, tete + 1, memory_order_release);
+    return 1;
+}
+
+/**
+ * @brief boucle_moniteur - corps du thread moniteur : une mesure par période, à dates fixes
+ * 
+ * @param arg       non utilisé
+ * @return void*    NULL
+ */
+
+void* boucle_moniteur(void *arg){
+    struct timespec prochaine;
+    struct mesure_charge m;
+
+    clock_gettime(CLOCK_MONOTONIC, &prochaine);
+    while(atomic_load(&moniteur_actif)){
+        // Prochaine échéance (absolue, pour ne pas dériver)
+        prochaine.tv_nsec += (long) periode_moniteur_ms * 1000000L;
+        prochaine.tv_sec += prochaine.tv_nsec / 1000000000L;
+        prochaine.tv_nsec %= 1000000000L;
+        while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &prochaine, NULL) != 0 && atomic_load(&moniteur_actif))
+            ;
+
+        m.charge = getCharge();
+        clock_gettime(CLOCK_MONOTONIC, &m.date);
+        file_moniteur_deposer(&m);
+    }
+    return NULL;
+}
+
+/**
+ * @brief moniteur_demarrer - lance le thread moniteur
+ * 
+ */
+
+void moniteur_demarrer(){
+    atomic_store(&file_moniteur.tete, 0);
+    atomic_store(&file_moniteur.queue, 0);
+    atomic_store(&moniteur_actif, 1);
+    if(pthread_create(&moniteur, NULL, boucle_moniteur, NULL) != 0){
+        perror("moniteur_demarrer");
+        exit(1);
+    }
+}
+
+/**
+ * @brief moniteur_arreter - arrête le thread moniteur (attend au plus une période)
+ * 
+ */
+
+void moniteur_arreter(){
+    atomic_store(&moniteur_actif, 0);
+    pthread_join(moniteur, NULL);
+}
+
+/**
+ * @brief nouvelle_mesure - diffuse une charge mesurée et fait tourner le contrôleur d'équilibrage
+ *                          (mesures du moniteur, ou du simulateur)
+ * 
+ * @param charge    charge mesurée
+ */
+
+void nouvelle_mesure(float charge){
+    notifyCharge(charge);
+    if(equilibrage && tab_participe[rank] == 1)
+        equilibrer();
+}
+
+/**
+ * @brief traiter_mesures - vide la file du moniteur, appelé par la boucle de réception.
+ *                          Seule la mesure la plus récente est diffusée et sert à l'équilibrage.
+ * 
+ */
+
+void traiter_mesures() {
+    struct mesure_charge m;
+    int nouvelle = 0;
+
+    while(file_moniteur_retirer(&m))
+        nouvelle = 1;
+    if(nouvelle)
+        nouvelle_mesure(m.charge);
+}
+
+/***************************************************************************************************
+                                            TRANSIT CMD
+***************************************************************************************************/
+
+/**
+ * @brief recv_gkill - retire le GPID de l'annuaire
+ * 
+ * @param rank      identifiant de la machine qui était en charge du GPID
+ * @param gpid      identifiant global à retirer
+ * @param p         
+ */
+
+void recv_gkill(int rank, gpid_t gpid, int p){
+    annuaire_retirer(gpid, rank);
+}
+
+/**
+ * @brief diffuser_annuaire - envoie une mise à jour de l'annuaire au chef de chaque autre noeud qui a
+ *                            un participant : les serveurs de notre noeud lisent l'annuaire partagé
+ * 
+ * @param donnees   message (gpid, indice, ...)
+ * @param taille    taille du message en octets
+ * @param tag       TAG_GPID, TAG_GKILL_GPID ou TAG_FIN_GPID
+ */
+
+void diffuser_annuaire(const void *donnees, int taille, int tag){
+    char noeud_participe[nb_proc];
+
+    memset(noeud_participe, 0, nb_proc);
+    for(int i = 1; i < nb_proc; i++){
+        if(tab_participe[i])
+            noeud_participe[tab_chef[i]] = 1;
+    }
+    for(int i = 1; i < nb_proc; i++){
+        if(tab_chef[i] == i && i != tab_chef[rank] && noeud_participe[i])
+            envoyer(donnees, taille, i, tag);
+    }
+}
+
+/**
+ * @brief annoncer_gpid - informe les machines participantes qu'un gpid est maintenant chez nous
+ * 
+ * @param gpid              identifiant global du processus
+ * @param indice_process    indice du processus dans notre table process
+ */
+
+void annoncer_gpid(gpid_t gpid, int indice_process){
+    struct avis_gpid avis;
+
+    // Message contenant le gpid et l'indice de l'emplacement
+    memset(&avis, 0, sizeof(struct avis_gpid));
+    avis.gpid = gpid;
+    avis.indice = indice_process;
+    diffuser_annuaire(&avis, sizeof(struct avis_gpid), TAG_GPID);
+}
+
+/**
+ * @brief retirer_processus - retire un processus de notre table et de l'annuaire,
+ *                            puis demande aux participants de le retirer du leur
+ * 
+ * @param p         indice du processus dans notre table process
+ */
+
+void retirer_processus(int p){
+    char chemin[PATH_MAX];
+    struct avis_gpid avis;
+    gpid_t gpid = process[p].gpid;
+
+    // Un checkpoint restauré ou abandonné n'a plus de raison d'exister
+    chemin_checkpoint(chemin, sizeof(chemin), gpid);
+    unlink(chemin);
+
+    process_liberer(p);
+    annuaire_retirer(gpid, rank);
+
+    // On envoie le gpid et son indice dans la table de chaque machine
+    // pour que chaque participant le retire
+    memset(&avis, 0, sizeof(struct avis_gpid));
+    avis.gpid = gpid;
+    avis.indice = p;
+    diffuser_annuaire(&avis, sizeof(struct avis_gpid), TAG_GKILL_GPID);
+}
+
+/**
+ * @brief terminer_processus - un processus s'est terminé : on libère sa case et on diffuse
+ *                             son status de fin et sa durée aux participants
+ * 
+ * @param p         indice du processus dans notre table process
+ * @param status    status renvoyé par waitpid
+ */
+
+void terminer_processus(int p, int status){
+    struct timespec fin;
+    struct avis_gpid avis;
+    gpid_t gpid = process[p].gpid;
+
+    clock_gettime(CLOCK_MONOTONIC, &fin);
+    int duree_ms = (fin.tv_sec - process[p].debut.tv_sec) * 1000 + (fin.tv_nsec - process[p].debut.tv_nsec) / 1000000;
+    if(WIFSIGNALED(status))
+        JOURNAL(LOG_DEBUG, "%s : le processus %s (gpid %lld) a été tué par le signal %d après %.1f s\n", hostname, process[p].cmd, (long long) gpid, WTERMSIG(status), duree_ms / 1e3);
+    else
+        JOURNAL(LOG_DEBUG, "%s : le processus %s (gpid %lld) s'est terminé avec le code %d après %.1f s\n", hostname, process[p].cmd, (long long) gpid, WEXITSTATUS(status), duree_ms / 1e3);
+
+    registre_noter(REG_FIN, p, 0);
+    process_liberer(p);
+    annuaire_retirer(gpid, rank);
+
+    memset(&avis, 0, sizeof(struct avis_gpid));
+    avis.gpid = gpid;
+    avis.indice = p;
+    avis.status = status;
+    avis.duree_ms = duree_ms;
+    diffuser_annuaire(&avis, sizeof(struct avis_gpid), TAG_FIN_GPID);
+}
+
+/**
+ * @brief recv_fin - un processus d'une autre machine s'est terminé : on retire son gpid de l'annuaire
+ *                   et l'éventuel renvoi laissé par son départ de chez nous
+ * 
+ * @param rang      machine qui possédait le processus
+ * @param avis      gpid, indice, status de fin et durée en ms
+ */
+
+void recv_fin(int rang, const struct avis_gpid *avis){
+    annuaire_retirer(avis->gpid, rang);
+    renvoi_oublier(avis->gpid);
+}
+
+/***************************************************************************************************
+                                                CMD
+***************************************************************************************************/
+
+/*
+ * Les tâches sont lancées avec posix_spawnp et non fork + exec : glibc crée le fils avec
+ * clone(CLONE_VM | CLONE_VFORK), sans copier les tables de pages du serveur (tampons MPI
+ * enregistrés compris), et le fils n'exécute rien d'autre qu'exec.
+ * En simulation, lancer_processus et signaler_processus créent et signalent des tâches virtuelles
+ * (cf SIMULATION).
+ */
+
+#ifndef SIMULATION
+
+posix_spawnattr_t attributs_lanceur;            // Masque des signaux des tâches (SIGCHLD débloqué)
+char** environnement_taches = NULL;             // Notre environnement sans LB_CHECKPOINT / LB_RESTORE, puis 2 cases libres
+int nb_environnement_taches = 0;                // Nombre de variables recopiées dans environnement_taches
+
+/**
+ * @brief lanceur_init - prépare une fois pour toutes les attributs et l'environnement des tâches
+ * 
+ */
+
+void lanceur_init(){
+    extern char **environ;
+    sigset_t masque;
+    int nb_variables = 0;
+
+    while(environ[nb_variables] != NULL)
+        nb_variables++;
+    environnement_taches = (char **) malloc((nb_variables + 3) * sizeof(char *));
+    if(!environnement_taches){
+        perror("lanceur_init");
+        exit(1);
+    }
+    for(int i = 0; i < nb_variables; i++){
+        if(strncmp(environ[i], "LB_CHECKPOINT=", 14) != 0 && strncmp(environ[i], "LB_RESTORE=", 11) != 0)
+            environnement_taches[nb_environnement_taches++] = environ[i];
+    }
+
+    // Les tâches démarrent avec notre masque de signaux, SIGCHLD débloqué
+    pthread_sigmask(SIG_SETMASK, NULL, &masque);
+    sigdelset(&masque, SIGCHLD);
+    posix_spawnattr_init(&attributs_lanceur);
+    posix_spawnattr_setsigmask(&attributs_lanceur, &masque);
+    posix_spawnattr_setflags(&attributs_lanceur, POSIX_SPAWN_SETSIGMASK);
+}
+
+/**
+ * @brief lanceur_fermer - libère les attributs et l'environnement des tâches
+ * 
+ */
+
+void lanceur_fermer(){
+    posix_spawnattr_destroy(&attributs_lanceur);
+    free(environnement_taches);
+}
+
+/**
+ * @brief lancer_processus - crée le processus de la case indice_process à partir de son argv.
+ *                           La tâche reçoit dans son environnement LB_CHECKPOINT, le fichier où écrire
+ *                           son état quand elle reçoit SIGNAL_CHECKPOINT, et LB_RESTORE, le fichier d'où
+ *                           reprendre si elle est relancée après une migration.
+ *                           Avec --sorties, sa sortie standard et sa sortie d'erreur sont ajoutées
+ *                           à lb-<gpid>.out et lb-<gpid>.err.
+ * 
+ * @param indice_process    indice du processus dans la table process
+ * @param restauration      checkpoint à restaurer, ou NULL pour un démarrage normal
+ * @return int              0 si le processus est lancé, -1 si la commande n'a pas pu être exécutée
+ */
+
+int lancer_processus(int indice_process, const char *restauration){
+    char chemin[PATH_MAX];
+    char variable_checkpoint[PATH_MAX + 16];
+    char variable_restauration[PATH_MAX + 16];
+    char sortie[PATH_MAX];
+    char erreur[PATH_MAX];
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_t *redirections = NULL;
+    gpid_t gpid = process[indice_process].gpid;
+    pid_t pid;
+
+    // Les deux dernières cases de l'environnement sont propres à la tâche
+    int n = nb_environnement_taches;
+    chemin_checkpoint(chemin, sizeof(chemin), gpid);
+    snprintf(variable_checkpoint, sizeof(variable_checkpoint), "LB_CHECKPOINT=%s", chemin);
+    environnement_taches[n++] = variable_checkpoint;
+    if(restauration != NULL){
+        snprintf(variable_restauration, sizeof(variable_restauration), "LB_RESTORE=%s", restauration);
+        environnement_taches[n++] = variable_restauration;
+    }
+    environnement_taches[n] = NULL;
+
+    if(repertoire_sorties != NULL){
+        // O_APPEND : une tâche migrée ou relancée continue ses fichiers de sortie
+        snprintf(sortie, sizeof(sortie), "%s/lb-%lld.out", repertoire_sorties, (long long) gpid);
+        snprintf(erreur, sizeof(erreur), "%s/lb-%lld.err", repertoire_sorties, (long long) gpid);
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, sortie, O_WRONLY | O_CREAT | O_APPEND, 0644);
+        posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, erreur, O_WRONLY | O_CREAT | O_APPEND, 0644);
+        redirections = &actions;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &process[indice_process].debut);
+    int erreur_lancement = posix_spawnp(&pid, process[indice_process].argv[0], redirections, &attributs_lanceur,
+                                        process[indice_process].argv, environnement_taches);
+    if(redirections != NULL)
+        posix_spawn_file_actions_destroy(redirections);
+
+    process[indice_process].etat = ETAT_ACTIF;
+    if(erreur_lancement != 0){
+        JOURNAL(LOG_ERREUR, "%s : impossible de lancer %s : %s\n", hostname, process[indice_process].argv[0], strerror(erreur_lancement));
+        process[indice_process].pid = 0;
+        return -1;
+    }
+    process[indice_process].pid = pid;
+    index_pid_ajouter(pid, indice_process);
+    if(repertoire_registre != NULL){
+        // La date de démarrage distingue le processus d'un autre qui reprendrait son pid (cf REGISTRE)
+        process[indice_process].depart = depart_processus(pid);
+        registre_noter(REG_LANCE, indice_process, process[indice_process].groupe);
+    }
+    if(date_surcharge_us != 0)
+        elastique_premier_processus();
+    return 0;
+}
+
+/**
+ * @brief signaler_processus - envoie un signal à un de nos processus
+ * 
+ * @param indice_process    indice du processus dans la table process
+ * @param signal            numéro du signal
+ * @return int              0 si le signal a été envoyé, sinon -1 (errno)
+ */
+
+int signaler_processus(int indice_process, int signal){
+    // Un processus repris n'est pas notre fils : son pid a pu être réutilisé depuis sa fin
+    if(process[indice_process].repris && depart_processus(process[indice_process].pid) != process[indice_process].depart){
+        errno = ESRCH;
+        return -1;
+    }
+    return kill(process[indice_process].pid, signal);
+}
+
+#endif
+
+/**
+ * @brief gstart - permet de créer un processus exécutant une commande donnée
+ *                 en paramètre sur la machine la moins chargée du réseau
+ * 
+ * @param args      tableau d'arguments pour la commande args[0] à lancer
+ * @param gpid      identifiant global unique sur le réseau
+ * @param indice    indice du tableau process
+ * @param groupe    groupe du processus (0 si aucun)
+ * @return * void 
+ */
+
+
+void gstart(char * args[], gpid_t gpid, int indice_process, int groupe){
+    /* Le père enregistre les informations du fils :
+    *  - identifiant du processus (locale à la machine)
+    *  - identifiant globale du processus (globale au réseau)
+    *  - la commande, et la commande complète pour pouvoir la relancer après une migration
+    */ 
+    (process + indice_process)->gpid = gpid;
+    (process + indice_process)->cmd = strdup(args[0]);
+    (process + indice_process)->argv = argv_dupliquer(args);
+    (process + indice_process)->groupe = groupe;
+
+    if(lancer_processus(indice_process, NULL) == -1){
+        // Comme un exec raté : le processus se termine aussitôt avec le code 127
+        annuaire_ajouter(gpid, rank, indice_process, 0);
+        terminer_processus(indice_process, W_EXITCODE(127, 0));
+        return;
+    }
+    JOURNAL(LOG_DEBUG, "%s crée le processus %s qui a pour pid %d et gpid %lld.\n", hostname, args[0], process[indice_process].pid, (long long) gpid);
+    annuaire_ajouter(gpid, rank, indice_process, process[indice_process].pid);
+}
+
+/**
+ * @brief lire_stat_processus - temps CPU et mémoire résidente d'un processus, lus dans /proc/<pid>/stat
+ *                              (rss y figure aussi : une seule lecture au lieu de stat + statm)
+ * 
+ * @param pid           pid du processus
+ * @param temps_cpu     temps CPU utilisateur + système en secondes
+ * @param rss           mémoire résidente en Ko
+ * @return int          0 si la lecture a réussi, sinon -1
+ */
+
+int lire_stat_processus(pid_t pid, float *temps_cpu, int64_t *rss){
+    char chemin[32];
+    char tampon[1024];
+    unsigned long utime, stime;
+    long pages;
+
+    snprintf(chemin, sizeof(chemin), "/proc/%d/stat", pid);
+    int fd = open(chemin, O_RDONLY | O_CLOEXEC);
+    if(fd == -1)
+        return -1;
+    ssize_t lus = read(fd, tampon, sizeof(tampon) - 1);
+    close(fd);
+    if(lus <= 0)
+        return -1;
+    tampon[lus] = '\0';
+
+    // Le nom de la commande peut contenir des espaces : on repart de la dernière parenthèse
+    char *p = strrchr(tampon, ')');
+    if(p == NULL || sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu %*d %*d %*d %*d %*d %*d %*u %*u %ld",
+                           &utime, &stime, &pages) != 3)
+        return -1;
+    *temps_cpu = (float) (utime + stime) / sysconf(_SC_CLK_TCK);
+    *rss = (int64_t) pages * (sysconf(_SC_PAGESIZE) / 1024);
+    return 0;
+}
+
+/**
+ * @brief gps - répond à une requête gps : la liste de nos processus en un seul message
+ *              (avec -l, temps CPU et mémoire de chacun lus dans /proc)
+ * 
+ * @param option        1 si option -l (format long), sinon 0
+ * @param requete       numéro de la requête, renvoyé tel quel
+ * @param demandeur     rang de la machine qui a lancé gps
+ */
+ 
+void gps(int option, int requete, int demandeur){
+    struct entete_gps entete;
+    struct timespec maintenant;
+    int nb_lignes = 0;
+
+    // Une machine qui ne participe plus répond quand même (sans processus) pour ne pas faire attendre
+    if(tab_participe[rank] == 1){
+        for(int p = 0; p < process_capacite; p++){
+            if(process[p].gpid != 0)
+                nb_lignes++;
+        }
+    }
+
+    int taille = sizeof(struct entete_gps) + nb_lignes * sizeof(struct ligne_gps);
+    char *tampon = (char *) calloc(1, taille);
+    if(!tampon){
+        perror("gps");
+        exit(1);
+    }
+    memset(&entete, 0, sizeof(struct entete_gps));
+    entete.requete = requete;
+    entete.nb_lignes = nb_lignes;
+    entete.uid = getuid();
+    entete.en_attente = file_attente.nb;
+    entete.longueur_max = file_attente.longueur_max;
+    entete.mis_en_file = file_attente.mis_en_file;
+    entete.distribues = file_attente.distribues;
+    entete.refuses = file_attente.refuses;
+    entete.attente_moyenne_ms = file_attente.distribues ? file_attente.attente_totale_ms / file_attente.distribues : 0;
+    entete.attente_max_ms = file_attente.attente_max_ms;
+    memcpy(entete.hostname, hostname, sizeof(entete.hostname));
+    memcpy(tampon, &entete, sizeof(struct entete_gps));
+
+    struct ligne_gps *lignes = (struct ligne_gps *) (tampon + sizeof(struct entete_gps));
+    clock_gettime(CLOCK_MONOTONIC, &maintenant);
+    int n = 0;
+    for(int p = 0; p < process_capacite && n < nb_lignes; p++){
+        if(process[p].gpid == 0)
+            continue;
+        struct ligne_gps *l = &lignes[n++];
+        l->gpid = process[p].gpid;
+        l->pid = process[p].pid;
+        l->groupe = process[p].groupe;
+        l->rang = rank;
+        strncpy(l->cmd, process[p].cmd, TAILLE_CMD_GPS - 1);
+        // Un processus en cours de migration (pid 0) n'a pas de statistiques
+        if(option == 1 && process[p].pid != 0 && lire_stat_processus(process[p].pid, &l->temps_cpu, &l->rss) == 0){
+            double duree = (maintenant.tv_sec - process[p].debut.tv_sec) + (maintenant.tv_nsec - process[p].debut.tv_nsec) / 1e9;
+            l->cpu = duree > 0 ? 100.0 * l->temps_cpu / duree : 0;
+        }
+    }
+    envoyer(tampon, taille, demandeur, TAG_GPS_REPONSE);
+    free(tampon);
+}
+
+
+/**
+ * @brief gkill - permet d'envoyer un signal sig à un de nos processus, directement avec kill(2).
+ *                Le pid ne peut pas avoir été réutilisé : nos processus ne sont récupérés
+ *                (waitpid) que par processus_termines(), qui libère aussi leur case, et la date
+ *                de démarrage d'un processus repris est vérifiée avant le signal (cf REGISTRE).
+ * 
+ * @param sig      numéro du signal
+ * @param pid      identifiant du processus
+ * @param gpid     identifiant global du processus
+ * @param p        indice du processus dans la table process
+ * @return int     1 si le signal a été envoyé, sinon 0
+ */
+ 
+int gkill(int signal, int pid, gpid_t gpid, int p){
+    // Un processus dont le checkpoint part ou arrive sera relancé ailleurs : on ne le retire pas ici.
+    // Un processus à qui on a demandé son checkpoint tourne encore : il reçoit le signal (s'il le
+    // termine, la migration est abandonnée, cf migration_checkpoint_pret)
+    if((process[p].etat != ETAT_ACTIF && process[p].etat != ETAT_CHECKPOINT) || pid == 0){
+        JOURNAL(LOG_INFO, "%s : le gpid %lld est en cours de migration\n", hostname, (long long) gpid);
+        return 0;
+    }
+
+    if(signaler_processus(p, signal) == -1){
+        perror("gkill : kill");
+        return 0;
+    }
+    // Un processus repris terminé par ce signal n'aura pas d'autre status (cf registre_progresser)
+    process[p].signal = signal;
+    registre_noter(REG_SIGNAL, p, signal);
+    // Si le signal termine le processus, processus_termines() libère sa case et prévient les participants
+    return 1;
+}
+
+/***************************************************************************************************
+                                        gkill groupés
+***************************************************************************************************/
+
+/*
+ * Un gkill vise une liste de gpid, un groupe (donné au gstart) ou un motif de nom de commande.
+ * Une liste de gpid est découpée par machine d'origine dès le menu, puis chaque machine signale
+ * ses processus et fait suivre les autres gpid à leur propriétaire (cf Renvois des gpid) : sans
+ * migration, un gkill coûte un message par machine visée. Un groupe ou un motif est envoyé à un
+ * participant (TAG_RECHERCHE_GPID) qui le diffuse une fois à chaque participant. Les signaux sont
+ * envoyés directement avec kill(2).
+ */
+
+/**
+ * @brief envoyer_selection - envoie une sélection de gkill en un seul message
+ * 
+ * @param destination   rang du destinataire
+ * @param tag           TAG_RECHERCHE_GPID ou TAG_GKILL
+ * @param s             en-tête de la sélection
+ * @param donnees       s->nb gpid (SELECTION_GPID), le motif (SELECTION_MOTIF) ou NULL
+ */
+
+void envoyer_selection(int destination, int tag, const struct selection *s, const void *donnees){
+    int taille_donnees = (s->type == SELECTION_GPID) ? s->nb * (int) sizeof(gpid_t) : s->nb;
+    int taille = sizeof(struct selection) + taille_donnees;
+    char *tampon = (char *) malloc(taille);
+    if(!tampon){
+        perror("envoyer_selection");
+        exit(1);
+    }
+    memcpy(tampon, s, sizeof(struct selection));
+    if(taille_donnees > 0)
+        memcpy(tampon + sizeof(struct selection), donnees, taille_donnees);
+    envoyer(tampon, taille, destination, tag);
+    free(tampon);
+}
+
+/**
+ * @brief selection_decoder - vérifie une sélection reçue
+ * 
+ * @param msg       message reçu
+ * @param taille    taille du message en octets
+ * @param s         en-tête de la sélection (copié, le message n'est pas forcément aligné)
+ * @return char*    début des données de la sélection, ou NULL si le message est invalide
+ */
+
+char* selection_decoder(char *msg, int taille, struct selection *s){
+    if(taille < (int) sizeof(struct selection))
+        return NULL;
+    memcpy(s, msg, sizeof(struct selection));
+    int taille_donnees = taille - (int) sizeof(struct selection);
+    if(s->nb < 0)
+        return NULL;
+    if(s->type == SELECTION_GPID && s->nb * (int) sizeof(gpid_t) != taille_donnees)
+        return NULL;
+    if(s->type == SELECTION_MOTIF && (s->nb != taille_donnees || s->nb == 0 || msg[taille - 1] != '\0'))
+        return NULL;
+    if(s->type == SELECTION_GROUPE && taille_donnees != 0)
+        return NULL;
+    if(s->type != SELECTION_GPID && s->type != SELECTION_GROUPE && s->type != SELECTION_MOTIF)
+        return NULL;
+    return msg + sizeof(struct selection);
+}
+
+/**
+ * @brief gkill_gpid - signale ceux des gpid de la sélection qui sont chez nous et fait suivre les autres :
+ *                     un seul TAG_GKILL par machine. Le menu (rang 0) n'a pas d'annuaire : il envoie
+ *                     chaque gpid à sa machine d'origine.
+ * 
+ * @param s         en-tête de la sélection (SELECTION_GPID)
+ * @param donnees   s->nb gpid
+ */
+
+void gkill_gpid(const struct selection *s, const char *donnees){
+    int nb_par_rang[nb_proc];
+    int debut[nb_proc + 1];
+    int rangs[s->nb > 0 ? s->nb : 1];
+    gpid_t tries[s->nb > 0 ? s->nb : 1];
+    int nb_signales = 0;
+
+    // Tri des gpid par machine destinataire (tri par dénombrement sur le rang)
+    memset(nb_par_rang, 0, sizeof(nb_par_rang));
+    for(int k = 0; k < s->nb; k++){
+        gpid_t gpid;
+        struct entree_gpid e;
+        memcpy(&gpid, donnees + k * sizeof(gpid_t), sizeof(gpid_t));
+        if(rank == 0){
+            // Un serveur créé puis arrêté (cf ELASTICITE) a cédé ses processus : l'annuaire du coordinateur les connaît
+            int origine = gpid > 0 ? GPID_RANG(gpid) : -1;
+            if(origine >= nb_proc && origine < nb_max)
+                rangs[k] = COORDINATEUR_VUE;
+            else
+                rangs[k] = (origine >= 1 && origine < nb_proc) ? origine : -1;
+        }else
+            rangs[k] = gpid_destination(gpid, &e);
+        if(rangs[k] == rank){
+            nb_signales += gkill(s->signal, e.pid, gpid, e.indice);
+            rangs[k] = -1;
+        }else if(rangs[k] == -1 || s->renvois >= MAX_RENVOIS_GKILL){
+            JOURNAL(LOG_INFO, "Le processus avec le gpid %lld n'existe pas.\n", (long long) gpid);
+            rangs[k] = -1;
+        }else{
+            nb_par_rang[rangs[k]]++;
+        }
+    }
+    if(nb_signales > 0)
+        JOURNAL(LOG_INFO, "%s : signal %d envoyé à %d processus\n", hostname, s->signal, nb_signales);
+
+    debut[0] = 0;
+    for(int i = 0; i < nb_proc; i++)
+        debut[i + 1] = debut[i] + nb_par_rang[i];
+    int position[nb_proc];
+    memcpy(position, debut, nb_proc * sizeof(int));
+    for(int k = 0; k < s->nb; k++){
+        if(rangs[k] != -1)
+            memcpy(&tries[position[rangs[k]]++], donnees + k * sizeof(gpid_t), sizeof(gpid_t));
+    }
+
+    for(int i = 0; i < nb_proc; i++){
+        if(nb_par_rang[i] == 0)
+            continue;
+        struct selection partie = *s;
+        partie.nb = nb_par_rang[i];
+        if(rank != 0){
+            partie.renvois++;
+            metriques.gkill_renvoyes += nb_par_rang[i];
+        }
+        envoyer_selection(i, TAG_GKILL, &partie, &tries[debut[i]]);
+    }
+}
+
+/**
+ * @brief gkill_selection - envoie le signal à nos processus qui font partie de la sélection
+ * 
+ * @param s         en-tête de la sélection
+ * @param donnees   gpid ou motif de la sélection
+ */
+
+void gkill_selection(const struct selection *s, const char *donnees){
+    int nb_signales = 0;
+
+    if(s->type == SELECTION_GPID){
+        gkill_gpid(s, donnees);
+        return;
+    }
+    for(int p = 0; p < process_capacite; p++){
+        if(process[p].gpid == 0)
+            continue;
+        if(s->type == SELECTION_GROUPE && process[p].groupe != s->groupe)
+            continue;
+        if(s->type == SELECTION_MOTIF && fnmatch(donnees, process[p].cmd, 0) != 0)
+            continue;
+        nb_signales += gkill(s->signal, process[p].pid, process[p].gpid, p);
+    }
+    if(nb_signales > 0)
+        JOURNAL(LOG_INFO, "%s : signal %d envoyé à %d processus\n", hostname, s->signal, nb_signales);
+}
+
+/**
+ * @brief recv_recherche_gpid - diffuse un gkill de groupe ou de motif à chaque participant, qui trie
+ *                              ses propres processus
+ * 
+ * @param msg       sélection reçue
+ * @param taille    taille de la sélection en octets
+ */
+
+void recv_recherche_gpid(char *msg, int taille){
+    struct selection s;
+    char *donnees = selection_decoder(msg, taille, &s);
+    if(donnees == NULL){
+        JOURNAL(LOG_ERREUR, "%s : sélection de gkill invalide\n", hostname);
+        return;
+    }
+
+    // Une liste de gpid se route seule (cf gkill_gpid) : seuls un groupe ou un motif sont diffusés
+    if(s.type != SELECTION_GPID){
+        for(int i = 1; i < nb_proc; i++){
+            if(i != rank && tab_participe[i])
+                envoyer(msg, taille, i, TAG_GKILL);
+        }
+    }
+    gkill_selection(&s, donnees);
+}
+
+/***************************************************************************************************
+                                        Fin des processus
+***************************************************************************************************/
+
+/**
+ * @brief processus_fini - un de nos processus s'est terminé : s'il migrait, son checkpoint est prêt
+ *                         à partir, sinon il est terminé
+ * 
+ * @param i         indice du processus dans la table process
+ * @param status    status renvoyé par waitpid
+ * @return int      1 si le processus est terminé, 0 s'il part vers une autre machine
+ */
+
+int processus_fini(int i, int status){
+    if(process[i].etat == ETAT_CHECKPOINT){
+        // Le processus a écrit son checkpoint (ou n'a pas survécu à SIGNAL_CHECKPOINT) : on l'envoie
+        migration_checkpoint_pret(i, status);
+        return 0;
+    }
+    terminer_processus(i, status);
+    return 1;
+}
+
+/**
+ * @brief corriger_charge - corrige tout de suite la charge locale après la fin de processus
+ *                          (CHARGE_PLACEMENT par processus) sans attendre la prochaine mesure
+ * 
+ * @param nb_termines   nombre de processus terminés
+ */
+
+void corriger_charge(int nb_termines){
+    if(nb_termines > 0){
+        float charge = tab_charge[rank] - nb_termines * CHARGE_PLACEMENT;
+        notifyCharge(charge > 0 ? charge : 0);
+    }
+}
+
+/**
+ * @brief processus_termines - récupère nos processus terminés, sans bloquer. fd_fils n'est lisible
+ *                             qu'après un SIGCHLD : sans fin de processus, cela ne coûte qu'un read.
+ * 
+ */
+
+void processus_termines(){
+    struct signalfd_siginfo infos[16];
+    int status;
+    pid_t pid;
+    int nb_termines = 0;
+
+    // Les SIGCHLD ne s'empilent pas : on vide fd_fils puis on récupère tous les fils terminés
+    if(read(fd_fils, infos, sizeof(infos)) <= 0)
+        return;
+    while(read(fd_fils, infos, sizeof(infos)) > 0)
+        ;
+
+    while((pid = waitpid(-1, &status, WNOHANG)) > 0){
+        // Le pid est récupéré : il quitte l'index, et sa case doit toujours le porter
+        int i = index_pid_retirer(pid);
+        if(i == -1 || process[i].pid != pid || process[i].gpid == 0 || process[i].repris)
+            continue;
+        nb_termines += processus_fini(i, status);
+    }
+    corriger_charge(nb_termines);
+}
+
+#ifndef SIMULATION
+
+/***************************************************************************************************
+                                            REGISTRE
+***************************************************************************************************/
+
+/*
+ * Avec --registre=dir, chaque serveur (sauf le rang 0) tient le registre de ses tâches dans
+ * dir/lb-<rang>.reg : lancements, fins, gkill et transferts y sont ajoutés à la suite, dans un fichier
+ * projeté en mémoire (MAP_SHARED). Un ajout ne coûte qu'une copie, sans appel système : l'enregistrement
+ * est écrit puis sa taille en dernier, si bien qu'un serveur qui s'arrête brutalement laisse un registre
+ * lisible jusqu'à son dernier ajout complet (le noyau garde les pages ; une panne de la machine n'est pas
+ * couverte, le registre n'est pas synchronisé sur le disque).
+ *
+ * Au redémarrage, le serveur relit son registre et reconstruit sa table des processus, la séquence de
+ * ses gpid et ses renvois. Une tâche toujours vivante (même pid et même date de démarrage, cf
+ * depart_processus) est reprise telle quelle : elle n'est pas relancée, et rien n'est diffusé, les gkill
+ * la retrouvent par sa machine d'origine (cf Renvois des gpid). Une tâche qui a laissé un checkpoint est
+ * relancée à partir de celui-ci ; les autres sont terminées (TAG_FIN_GPID, avec le dernier signal
+ * envoyé par gkill comme status). Une tâche reprise n'est pas notre fils : sa fin est relevée par
+ * registre_progresser, qui vérifie sa date de démarrage toutes les DELAI_REGISTRE_MS ms.
+ *
+ * Le registre est compacté (les tâches présentes et les renvois seulement, écrits dans un nouveau
+ * fichier qui remplace l'ancien par rename) après la reprise, quand il dépasse COMPACTION_MIN
+ * enregistrements de plus que deux par tâche présente, et à l'arrêt du serveur. Un serveur créé par
+ * MPI_Comm_spawn ne redémarre pas : il part d'un registre vide et l'efface à son arrêt.
+ *
+ * Seule l'ouverture du registre au démarrage est fatale. Si le fichier ne peut plus grandir ou si la
+ * compaction échoue (disque plein...), le serveur garde ses tâches et continue sans registre (cf
+ * registre_desactiver) : le fichier garde ses enregistrements complets, un redémarrage ne reprendra
+ * que ceux-là.
+ */
+
+struct{
+    char chemin[PATH_MAX];      // dir/lb-<rang>.reg
+    int fd;
+    char *base;                 // Projection du fichier (NULL sans registre)
+    size_t taille;              // Taille du fichier et de la projection
+    size_t fin;                 // Position du prochain enregistrement
+    int nb;                     // Nombre d'enregistrements
+    int nb_repris;              // Tâches reprises encore en cours
+    int cree;                   // 1 pour un serveur créé par MPI_Comm_spawn
+    double prochaine_verification;  // Date (ms) de la prochaine vérification des tâches reprises
+}registre = {.fd = -1};
+
+/**
+ * @brief depart_processus - date de démarrage d'un processus, en tops d'horloge depuis le démarrage de
+ *                           la machine (22e champ de /proc/<pid>/stat) : avec le pid, elle identifie le
+ *                           processus même si son pid est réutilisé plus tard
+ * 
+ * @param pid       pid du processus
+ * @return unsigned long long   date de démarrage, ou 0 si le processus n'existe plus (ou est un zombie)
+ */
+
+unsigned long long depart_processus(pid_t pid){
+    char chemin[32];
+    char tampon[1024];
+    char etat;
+    unsigned long long depart;
+
+    snprintf(chemin, sizeof(chemin), "/proc/%d/stat", pid);
+    int fd = open(chemin, O_RDONLY | O_CLOEXEC);
+    if(fd == -1)
+        return 0;
+    ssize_t lus = read(fd, tampon, sizeof(tampon) - 1);
+    close(fd);
+    if(lus <= 0)
+        return 0;
+    tampon[lus] = '\0';
+
+    // Le nom de la commande peut contenir des espaces : on repart de la dernière parenthèse
+    char *p = strrchr(tampon, ')');
+    if(p == NULL || sscanf(p + 2, "%c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %*u %*u %*d %*d %*d %*d %*d %*d %llu",
+                           &etat, &depart) != 2 || etat == 'Z')
+        return 0;
+    return depart;
+}
+
+/**
+ * @brief registre_projeter - ouvre un registre et le projette en mémoire ; un fichier vide ou qui n'est
+ *                            pas le registre de ce serveur est remis à zéro
+ * 
+ * @param chemin    fichier du registre
+ * @param vider     1 pour partir d'un registre vide
+ * @return int      0, ou -1 en cas d'échec (errno donne la cause, le registre n'est alors ni ouvert ni projeté)
+ */
+
+int registre_projeter(const char *chemin, int vider){
+    struct stat infos;
+
+    registre.base = MAP_FAILED;
+    registre.fd = open(chemin, O_RDWR | O_CREAT | O_CLOEXEC | (vider ? O_TRUNC : 0), 0600);
+    if(registre.fd != -1 && fstat(registre.fd, &infos) == 0){
+        registre.taille = infos.st_size < TAILLE_REGISTRE_MIN ? TAILLE_REGISTRE_MIN : (size_t) infos.st_size;
+        if((size_t) infos.st_size == registre.taille || ftruncate(registre.fd, registre.taille) == 0)
+            registre.base = (char *) mmap(NULL, registre.taille, PROT_READ | PROT_WRITE, MAP_SHARED, registre.fd, 0);
+    }
+    if(registre.base == MAP_FAILED){
+        int cause = errno;
+        if(registre.fd != -1)
+            close(registre.fd);
+        registre.fd = -1;
+        registre.base = NULL;
+        errno = cause;
+        return -1;
+    }
+    registre.fin = sizeof(struct entete_registre);
+    registre.nb = 0;
+
+    struct entete_registre *entete = (struct entete_registre *) registre.base;
+    if(entete->magique != MAGIQUE_REGISTRE || entete->rang != rank){
+        if(infos.st_size > 0 && !vider)
+            JOURNAL(LOG_ERREUR, "%s : %s n'est pas le registre du rang %d, il est remis à zéro\n", hostname, chemin, rank);
+        memset(registre.base, 0, registre.taille);
+        entete->magique = MAGIQUE_REGISTRE;
+        entete->rang = rank;
+    }
+    return 0;
+}
+
+/**
+ * @brief registre_ecrire - ajoute un enregistrement à la fin du registre (le fichier double s'il est plein)
+ * 
+ * @param type      REG_LANCE, REG_FIN, REG_SIGNAL, REG_TRANSFERT ou REG_COMPTEUR
+ * @param gpid      gpid concerné (0 pour REG_COMPTEUR)
+ * @param p         indice du processus dans la table process, ou -1
+ * @param valeur    groupe, signal ou machine, selon le type
+ * @return int      0, ou -1 si le fichier n'a pas pu grandir (errno donne la cause, le registre est inchangé)
+ */
+
+int registre_ecrire(int type, gpid_t gpid, int p, int valeur){
+    struct enregistrement e;
+    int taille_arguments = 0;
+
+    memset(&e, 0, sizeof(struct enregistrement));
+    if(type == REG_LANCE){
+        for(e.argc = 0; process[p].argv[e.argc] != NULL; e.argc++)
+            taille_arguments += strlen(process[p].argv[e.argc]) + 1;
+    }
+    e.taille = (sizeof(struct enregistrement) + taille_arguments + 7) & ~7u;
+    e.type = type;
+    e.gpid = gpid;
+    if(p != -1){
+        e.depart = process[p].depart;
+        e.pid = process[p].pid;
+    }
+    e.valeur = valeur;
+    e.cpt_gpid = cpt_gpid;
+    e.epoque_gpid = epoque_gpid;
+
+    // On garde la place de la taille nulle qui marque la fin du registre
+    if(registre.fin + e.taille + sizeof(uint32_t) > registre.taille){
+        size_t taille = registre.taille * 2;
+        while(registre.fin + e.taille + sizeof(uint32_t) > taille)
+            taille *= 2;
+        char *base = registre.base;
+        if(ftruncate(registre.fd, taille) == -1
+           || (base = (char *) mremap(registre.base, registre.taille, taille, MREMAP_MAYMOVE)) == MAP_FAILED)
+            return -1;
+        registre.base = base;
+        registre.taille = taille;
+    }
+
+    // La fin du registre, puis le contenu, puis la taille : un arrêt brutal ne laisse jamais d'enregistrement à moitié écrit
+    char *place = registre.base + registre.fin;
+    *(uint32_t *) (place + e.taille) = 0;
+    memcpy(place + sizeof(uint32_t), (char *) &e + sizeof(uint32_t), sizeof(struct enregistrement) - sizeof(uint32_t));
+    char *arguments = place + sizeof(struct enregistrement);
+    for(int k = 0; k < e.argc; k++){
+        int n = strlen(process[p].argv[k]) + 1;
+        memcpy(arguments, process[p].argv[k], n);
+        arguments += n;
+    }
+    __atomic_store_n((uint32_t *) place, e.taille, __ATOMIC_RELEASE);
+    registre.fin += e.taille;
+    registre.nb++;
+    return 0;
+}
+
+/**
+ * @brief registre_desactiver - une écriture du registre a échoué : le serveur garde ses tâches et
+ *                              continue sans registre (cf REGISTRE)
+ * 
+ * @param operation     opération qui a échoué (errno donne la cause)
+ */
+
+void registre_desactiver(const char *operation){
+    JOURNAL(LOG_ERREUR, "%s : %s du registre %s impossible (%s), le serveur continue sans registre\n", hostname, operation,
+            registre.chemin, strerror(errno));
+    munmap(registre.base, registre.taille);
+    close(registre.fd);
+    registre.base = NULL;
+    registre.fd = -1;
+    // Un serveur créé ne relit jamais son registre
+    if(registre.cree)
+        unlink(registre.chemin);
+}
+
+/**
+ * @brief registre_noter - ajoute un événement d'un de nos processus au registre (sans --registre, ne fait rien)
+ * 
+ * @param type              REG_LANCE, REG_FIN, REG_SIGNAL ou REG_TRANSFERT
+ * @param indice_process    indice du processus dans la table process
+ * @param valeur            groupe, signal ou machine, selon le type
+ */
+
+void registre_noter(int type, int indice_process, int valeur){
+    if(registre.base != NULL && registre_ecrire(type, process[indice_process].gpid, indice_process, valeur) == -1)
+        registre_desactiver("agrandissement");
+}
+
+/**
+ * @brief registre_compacter - réécrit le registre avec les seules tâches présentes et les renvois,
+ *                             dans un nouveau fichier qui remplace l'ancien ; en cas d'échec, l'ancien
+ *                             registre reste en place et le serveur continue sans registre
+ * 
+ */
+
+void registre_compacter(){
+    char temporaire[PATH_MAX];
+    char *ancienne_base = registre.base;
+    size_t ancienne_taille = registre.taille;
+    size_t ancienne_fin = registre.fin;
+    int ancien_nb = registre.nb;
+    int ancien_fd = registre.fd;
+
+    snprintf(temporaire, sizeof(temporaire), "%s/.lb-%d.reg.tmp", repertoire_registre, rank);
+    int erreur = registre_projeter(temporaire, 1);
+    if(erreur == 0)
+        erreur = registre_ecrire(REG_COMPTEUR, 0, -1, 0);
+    for(int i = 0; erreur == 0 && i < process_capacite; i++){
+        // Un checkpoint en cours de réception n'a pas encore de processus : l'émetteur le garde
+        if(process[i].gpid == 0 || process[i].etat == ETAT_RECEPTION)
+            continue;
+        erreur = registre_ecrire(REG_LANCE, process[i].gpid, i, process[i].groupe);
+        if(erreur == 0 && process[i].signal != 0)
+            erreur = registre_ecrire(REG_SIGNAL, process[i].gpid, i, process[i].signal);
+    }
+    for(int k = 0; erreur == 0 && k < TAILLE_RENVOIS; k++){
+        if(renvois[k].gpid != 0)
+            erreur = registre_ecrire(REG_TRANSFERT, renvois[k].gpid, -1, renvois[k].rang);
+    }
+    if(erreur == 0)
+        erreur = rename(temporaire, registre.chemin);
+
+    if(erreur == -1){
+        // L'ancien registre est complet : on le garde tel quel et on abandonne le nouveau
+        int cause = errno;
+        if(registre.base != NULL)
+            munmap(registre.base, registre.taille);
+        if(registre.fd != -1)
+            close(registre.fd);
+        unlink(temporaire);
+        registre.base = ancienne_base;
+        registre.taille = ancienne_taille;
+        registre.fin = ancienne_fin;
+        registre.nb = ancien_nb;
+        registre.fd = ancien_fd;
+        errno = cause;
+        registre_desactiver("compaction");
+        return;
+    }
+    munmap(ancienne_base, ancienne_taille);
+    close(ancien_fd);
+}
+
+/* Case de la table provisoire gpid -> indice de la relecture */
+
+struct case_registre{
+    gpid_t gpid;
+    int indice;
+};
+
+static inline struct case_registre* registre_case(struct case_registre *cases, int masque, gpid_t gpid){
+    int i = (int)((((uint64_t) gpid * 11400714819323198485ull) >> 32) & (uint64_t) masque);
+    while(cases[i].gpid != 0 && cases[i].gpid != gpid)
+        i = (i + 1) & masque;
+    return &cases[i];
+}
+
+/**
+ * @brief registre_relire - rejoue le registre dans la table des processus, puis reprend, relance ou
+ *                          termine chaque tâche restée présente
+ * 
+ */
+
+void registre_relire(){
+    struct enregistrement *e;
+    size_t fin;
+    int nb_lances = 0, nb_enregistrements = 0;
+    int nb_repris = 0, nb_relances = 0, nb_termines = 0;
+    double debut = maintenant_ms();
+
+    // Premier passage : fin du registre (taille nulle ou invalide) et nombre de lancements
+    for(fin = sizeof(struct entete_registre); fin + sizeof(struct enregistrement) <= registre.taille; fin += e->taille){
+        e = (struct enregistrement *) (registre.base + fin);
+        if(e->taille < sizeof(struct enregistrement) || e->taille % 8 != 0 || fin + e->taille > registre.taille)
+            break;
+        nb_lances += e->type == REG_LANCE;
+        nb_enregistrements++;
+    }
+
+    // Table provisoire gpid -> case, sans retrait : une case n'est valable que si elle porte encore ce gpid
+    int capacite = 64;
+    while(capacite < 2 * nb_lances)
+        capacite *= 2;
+    struct case_registre *cases = (struct case_registre *) calloc(capacite, sizeof(struct case_registre));
+    long long *decalages = (long long *) malloc(process_capacite * sizeof(long long));
+    int capacite_decalages = process_capacite;
+    if(!cases || !decalages){
+        perror("registre_relire");
+        exit(1);
+    }
+
+    // Second passage : les arguments ne sont décodés que pour les tâches restées présentes
+    for(size_t position = sizeof(struct entete_registre); position < fin; position += e->taille){
+        e = (struct enregistrement *) (registre.base + position);
+        struct case_registre *c = NULL;
+        int p = -1;
+        if(e->gpid != 0){
+            c = registre_case(cases, capacite - 1, e->gpid);
+            if(c->gpid == e->gpid && process[c->indice].gpid == e->gpid)
+                p = c->indice;
+        }
+        switch(e->type){
+            case REG_LANCE:
+                if(p == -1){
+                    p = process_allouer();
+                    if(process_capacite > capacite_decalages){
+                        capacite_decalages = process_capacite;
+                        decalages = (long long *) realloc(decalages, capacite_decalages * sizeof(long long));
+                        if(!decalages){
+                            perror("registre_relire");
+                            exit(1);
+                        }
+                    }
+                    c->gpid = e->gpid;
+                    c->indice = p;
+                }
+                process[p].gpid = e->gpid;
+                process[p].pid = e->pid;
+                process[p].depart = e->depart;
+                process[p].groupe = e->valeur;
+                process[p].signal = 0;
+                decalages[p] = position;
+                renvoi_oublier(e->gpid);
+                break;
+            case REG_FIN:
+                if(p != -1)
+                    process_liberer(p);
+                break;
+            case REG_TRANSFERT:
+                if(p != -1)
+                    process_liberer(p);
+                renvoi_noter(e->gpid, e->valeur);
+                break;
+            case REG_SIGNAL:
+                if(p != -1)
+                    process[p].signal = e->valeur;
+                break;
+        }
+        cpt_gpid = e->cpt_gpid;
+        epoque_gpid = e->epoque_gpid;
+    }
+    free(cases);
+    registre.fin = fin;
+    registre.nb = nb_enregistrements;
+
+    // Les arguments sont tous décodés avant la première écriture : une relance ou une fin ajoute un
+    // enregistrement, qui peut déplacer la projection ou désactiver le registre
+    struct timespec monotone, boot;
+    clock_gettime(CLOCK_MONOTONIC, &monotone);
+    clock_gettime(CLOCK_BOOTTIME, &boot);
+    long tops = sysconf(_SC_CLK_TCK);
+    for(int i = 0; i < process_capacite; i++){
+        if(process[i].gpid == 0)
+            continue;
+        e = (struct enregistrement *) (registre.base + decalages[i]);
+        const char *argument = (const char *) (e + 1);
+        process[i].argv = (char **) malloc((e->argc + 1) * sizeof(char *));
+        if(!process[i].argv){
+            perror("registre_relire");
+            exit(1);
+        }
+        for(int k = 0; k < e->argc; k++){
+            process[i].argv[k] = strdup(argument);
+            argument += strlen(argument) + 1;
+        }
+        process[i].argv[e->argc] = NULL;
+        process[i].cmd = strdup(e->argc > 0 ? process[i].argv[0] : "?");
+        process[i].etat = ETAT_ACTIF;
+        process[i].debut = monotone;
+    }
+    free(decalages);
+
+    for(int i = 0; i < process_capacite; i++){
+        char chemin[PATH_MAX];
+
+        if(process[i].gpid == 0)
+            continue;
+        if(process[i].pid != 0 && process[i].depart != 0 && depart_processus(process[i].pid) == process[i].depart){
+            // Toujours vivante : sa durée part de sa vraie date de démarrage
+            long long age_ns = (boot.tv_sec - (long long) (process[i].depart / tops)) * 1000000000LL + boot.tv_nsec
+                               - (long long) (process[i].depart % tops) * 1000000000LL / tops;
+            long long debut_ns = monotone.tv_sec * 1000000000LL + monotone.tv_nsec - age_ns;
+            process[i].debut.tv_sec = debut_ns / 1000000000LL;
+            process[i].debut.tv_nsec = debut_ns % 1000000000LL;
+            process[i].repris = 1;
+            annuaire_ajouter(process[i].gpid, rank, i, process[i].pid);
+            nb_repris++;
+            continue;
+        }
+        chemin_checkpoint(chemin, sizeof(chemin), process[i].gpid);
+        if(access(chemin, R_OK) == 0 && lancer_processus(i, chemin) == 0){
+            annuaire_ajouter(process[i].gpid, rank, i, process[i].pid);
+            nb_relances++;
+        }else{
+            terminer_processus(i, process[i].signal);
+            nb_termines++;
+        }
+    }
+    registre.nb_repris = nb_repris;
+
+    if(registre.base != NULL)
+        registre_compacter();
+    JOURNAL(LOG_INFO, "%s : registre relu en %.1f ms : %d enregistrements, %d tâches reprises, %d relancées, %d terminées\n",
+            hostname, maintenant_ms() - debut, nb_enregistrements, nb_repris, nb_relances, nb_termines);
+}
+
+/**
+ * @brief registre_ouvrir - ouvre le registre du serveur (option --registre) et, après un redémarrage,
+ *                          reprend les tâches qu'il contient
+ * 
+ */
+
+void registre_ouvrir(){
+    if(repertoire_registre == NULL || rank == 0)
+        return;
+    snprintf(registre.chemin, sizeof(registre.chemin), "%s/lb-%d.reg", repertoire_registre, rank);
+    registre.cree = inter_rang[rank] != MPI_COMM_NULL;
+    if(registre_projeter(registre.chemin, registre.cree) == -1){
+        perror("registre : ouverture");
+        exit(1);
+    }
+    if(!registre.cree)
+        registre_relire();
+    registre.prochaine_verification = maintenant_ms() + DELAI_REGISTRE_MS;
+}
+
+/**
+ * @brief registre_progresser - relève la fin des tâches reprises et compacte le registre quand il
+ *                              a trop grandi (boucle de réception)
+ * 
+ */
+
+void registre_progresser(){
+    int nb_termines = 0;
+    char chemin[PATH_MAX];
+
+    // Sans registre (désactivé), les tâches reprises sont toujours suivies
+    if((registre.base == NULL && registre.nb_repris == 0) || maintenant_ms() < registre.prochaine_verification)
+        return;
+    registre.prochaine_verification = maintenant_ms() + DELAI_REGISTRE_MS;
+
+    for(int i = 0; registre.nb_repris > 0 && i < process_capacite; i++){
+        if(process[i].gpid == 0 || !process[i].repris || process[i].pid == 0
+           || depart_processus(process[i].pid) == process[i].depart)
+            continue;
+        // Son status est perdu : on le déduit de ce qu'on lui a demandé
+        int status = process[i].signal;
+        if(process[i].etat == ETAT_CHECKPOINT){
+            chemin_checkpoint(chemin, sizeof(chemin), process[i].gpid);
+            status = access(chemin, R_OK) == 0 ? W_EXITCODE(CODE_CHECKPOINT, 0) : SIGNAL_CHECKPOINT;
+        }
+        registre.nb_repris--;
+        nb_termines += processus_fini(i, status);
+    }
+    corriger_charge(nb_termines);
+
+    if(registre.base != NULL && registre.nb > COMPACTION_MIN + 2 * processus_presents())
+        registre_compacter();
+}
+
+/**
+ * @brief registre_fermer - compacte le registre pour le prochain démarrage (l'efface pour un serveur créé)
+ * 
+ */
+
+void registre_fermer(){
+    if(registre.base == NULL)
+        return;
+    if(registre.cree)
+        unlink(registre.chemin);
+    else
+        registre_compacter();
+    munmap(registre.base, registre.taille);
+    close(registre.fd);
+    registre.base = NULL;
+}
+
+#else
+
+/**
+ * @brief registre_noter - sans effet dans le simulateur : aucun serveur n'y redémarre, il n'y a pas de
+ *                         tâche à reprendre (cf REGISTRE). Les appels restent communs aux deux versions.
+ */
+
+void registre_noter(int type, int indice_process, int valeur){
+    (void) type;
+    (void) indice_process;
+    (void) valeur;
+}
+
+#endif
+
+#ifndef SIMULATION
+
+/***************************************************************************************************
+                                                TEST
+***************************************************************************************************/
+
+/**
+ * @brief test_gstart - gestion de la fonction gstart avant de l'envoyer dans le réseau
+ * 
+ * @param opt_gstart 
+ */
+
+
+
+void test_gstart(int opt_gstart){
+    char* commande[4]= {NULL, NULL, NULL, NULL};
+    char path[50];
+    char option[5];
+    int nb_sleep;
+    int taille_etat;
+    int groupe = 0;
+    int priorite = 0;
+    static int numero_gstart = 0;
+    struct enveloppe e;
+    struct accuse_gstart accuse;
+    // Selon l'option choisi dans le menu
+    switch (opt_gstart){
+    case 1: // date
+        commande[0] = "date";
+        break;
+
+    case 2: // ls
+        printf("Vous avez choisis la commande \"ls\"\n");
+        printf("Veuillez indiquer quel répertoire vous voulez lister : \n");
+        printf("\tEntrez \"none\" pour le répertoire courant\n");
+        printf("\tSinon entrez le path\n");
+        saisir("%s", &path);
+        printf("Voulez vous ajouter une option? Si oui veuillez taper l'option sinon entrez \"none\"\n");
+        saisir("%s",&option);
+        printf("path %s\n",path);
+        printf("option %s\n",option);
+        commande[0] = "ls";
+        if(strcmp(path, "none") == 0){ // répertoire courant
+            if(strcmp(option, "none") != 0){ // pas d'option
+                commande[1] = option;
+            }
+        }else{ // autre répertoire
+            if(strcmp(option, "none") == 0){ // pas d'option
+                commande[1] = path;
+            }else{ // avec option
+                commande[1] = option;
+                commande[2] = path;
+            }
+        }
+        break;
+
+    case 3: // ps
+        printf("Vous avez choisis la commande \"ps\"\n");
+        printf("Voulez vous ajouter une option? Si oui veuillez taper l'option sinon entrez \"none\"\n");
+        saisir("%s",&option);
+        printf("\n");
+        if(strcmp(option, "none") == 0){ // pas d'option
+            commande[0] = "ps";
+        }else{ // avec option
+            commande[0] = "ps";
+            commande[1] = option;
+        }
+        break;
+        
+    case 4: // executable
+        printf("Vous avez choisis de lancer un exécutable\n");
+        printf("Veuillez entrer un nombre de secondes. Attention : Par défaut il sera à 2.\n");
+        saisir("%d", &nb_sleep);
+        if(nb_sleep < 2)    nb_sleep = 2;
+        printf("Taille de l'état de la tâche en Mo (transféré avec elle si elle migre) :\n");
+        saisir("%d", &taille_etat);
+        if(taille_etat < 0)    taille_etat = 0;
+        char tmp[12];
+        char tmp_etat[12];
+        sprintf(tmp,"%d",nb_sleep);
+        sprintf(tmp_etat,"%d",taille_etat);
+        commande[0] = "./test";
+        commande[1] = tmp;
+        commande[2] = tmp_etat;
+        break;
+        
+    default:
+        printf("no good to be here \n");
+        break;
+    }
+
+    // Le groupe permettra de viser toutes les tâches du groupe avec un seul gkill
+    printf("Groupe de la tâche (0 pour aucun) :\n");
+    saisir("%d", &groupe);
+    printf("Priorité de la tâche si elle doit attendre (0 par défaut, la plus grande passe en premier) :\n");
+    saisir("%d", &priorite);
+
+    // Envoie la commande en un seul message, avec un numéro pour recevoir la réponse du réseau
+    memset(&e, 0, sizeof(struct enveloppe));
+    e.tag = TAG_GSTART;
+    e.flags = groupe;
+    e.priorite = priorite;
+    e.utilisateur = getuid();
+    e.demandeur = rank;
+    e.numero = ++numero_gstart;
+    if(envoyer_enveloppe_entete(1, &e, commande) == -1)
+        return;
+    envoi_terminer();
+
+    // Les lancements des gstart précédents qui attendaient en file peuvent arriver avant notre réponse.
+    // On sert les créations et les arrêts de serveurs en attendant (--elastique)
+    do{
+        struct timespec pause = {0, ATTENTE_BOUCLE_US * 1000};
+        int taille, source;
+        char *msg;
+        while((msg = recevoir(TAG_GSTART_ACK, &taille, &source)) == NULL){
+            elastique_servir();
+            nanosleep(&pause, NULL);
+        }
+        memcpy(&accuse, msg, sizeof(struct accuse_gstart));
+        free(msg);
+        if(accuse.numero != e.numero && accuse.etat == ACCUSE_LANCE)
+            printf("Le gstart n°%d qui attendait a été lancé : gpid %lld\n", accuse.numero, (long long) accuse.gpid);
+    }while(accuse.numero != e.numero);
+
+    switch(accuse.etat){
+    case ACCUSE_LANCE:
+        printf("gstart n°%d lancé : gpid %lld\n", accuse.numero, (long long) accuse.gpid);
+        break;
+    case ACCUSE_EN_FILE:
+        printf("Toutes les machines sont saturées : le gstart n°%d attend en file (%d en attente sur cette machine)\n",
+               accuse.numero, accuse.longueur_file);
+        break;
+    default:
+        printf("Le réseau est saturé et sa file d'attente est pleine : gstart n°%d refusé, réessayez plus tard\n", accuse.numero);
+        break;
+    }
+}
+
+
+/**
+ * @brief comparer_lignes_gps - ordre des lignes de gps : par gpid croissant
+ */
+
+int comparer_lignes_gps(const void *a, const void *b){
+    const struct ligne_gps *x = (const struct ligne_gps *) a;
+    const struct ligne_gps *y = (const struct ligne_gps *) b;
+    return (x->gpid > y->gpid) - (x->gpid < y->gpid);
+}
+
+/**
+ * @brief test_gps - gps distribué : demande la liste de leurs processus à toutes les machines,
+ *                   fusionne les réponses en une seule table triée par gpid et l'affiche.
+ *                   Les machines qui n'ont pas répondu après DELAI_GPS_MS sont signalées ;
+ *                   leur réponse tardive sera ignorée par la requête suivante (numéro de requête).
+ * 
+ */
+
+void test_gps(){
+    static int requete_gps = 0;
+    int option = 0;
+    char y_or_n[2];
+    int demande[2];
+    int nb_reponses = 0;
+    int nb_serveurs;                                                        // Rangs interrogés (--elastique : nb_proc peut changer)
+    int repondu[nb_max];
+    char (*hotes)[MPI_MAX_PROCESSOR_NAME] = calloc(nb_max, MPI_MAX_PROCESSOR_NAME);
+    int uids[nb_max];
+    struct entete_gps *files = calloc(nb_max, sizeof(struct entete_gps));    // Métriques des files d'attente
+    int en_attente = 0;
+    struct ligne_gps *lignes = NULL;
+    int nb_lignes = 0;
+    int capacite_lignes = 0;
+    struct timespec maintenant, limite;
+
+    if(!hotes || !files){
+        perror("test_gps");
+        exit(1);
+    }
+    
+    //demande à l'utilisateur s'il veut faire gps ou gps -l
+    do{
+        printf("Voulez-vous un affichage en format long ? (y/n)\n");
+        saisir("%s", &y_or_n);
+        if(strcmp(y_or_n, "y") == 0){
+            option = 1;
+            break;
+        }
+        if(strcmp(y_or_n, "n") == 0){
+            break;
+        }
+        printf("Nous n'avons pas compris votre commande.\n");
+    }while(1);
+
+    //Envoi un message en précisant le format d'affichage (option) et le numéro de la requête à toutes les machines
+    requete_gps++;
+    demande[0] = option;
+    demande[1] = requete_gps;
+    nb_serveurs = nb_proc;
+    for(int i = 1; i < nb_serveurs; i++){
+        envoyer(demande, 2 * sizeof(int), i, TAG_GPS);
+    }
+    envoi_terminer();
+
+    // Réception des réponses, dans l'ordre où elles arrivent, jusqu'à la date limite
+    memset(repondu, 0, sizeof(repondu));
+    clock_gettime(CLOCK_MONOTONIC, &limite);
+    limite.tv_sec += DELAI_GPS_MS / 1000;
+    limite.tv_nsec += (DELAI_GPS_MS % 1000) * 1000000L;
+    if(limite.tv_nsec >= 1000000000L){
+        limite.tv_sec++;
+        limite.tv_nsec -= 1000000000L;
+    }
+    while(nb_reponses < nb_serveurs - 1){
+        int taille, source;
+
+        clock_gettime(CLOCK_MONOTONIC, &maintenant);
+        if(maintenant.tv_sec > limite.tv_sec || (maintenant.tv_sec == limite.tv_sec && maintenant.tv_nsec >= limite.tv_nsec))
+            break;
+        // La réponse a une taille quelconque : elle est reçue dans un tampon à sa taille
+        char *reponse = recevoir(TAG_GPS_REPONSE, &taille, &source);
+        if(reponse == NULL){
+            struct timespec pause = {0, ATTENTE_BOUCLE_US * 1000};
+            elastique_servir();
+            nanosleep(&pause, NULL);
+            continue;
+        }
+
+        struct entete_gps entete;
+        memcpy(&entete, reponse, sizeof(struct entete_gps));
+        if(taille < (int) sizeof(struct entete_gps) || entete.requete != requete_gps || source >= nb_serveurs
+           || entete.nb_lignes != (taille - (int) sizeof(struct entete_gps)) / (int) sizeof(struct ligne_gps)){
+            free(reponse); // réponse tardive à une requête précédente
+            continue;
+        }
+        if(nb_lignes + entete.nb_lignes > capacite_lignes){
+            capacite_lignes = 2 * (nb_lignes + entete.nb_lignes);
+            lignes = (struct ligne_gps *) realloc(lignes, capacite_lignes * sizeof(struct ligne_gps));
+            if(!lignes){
+                perror("test_gps");
+                exit(1);
+            }
+        }
+        memcpy(lignes + nb_lignes, reponse + sizeof(struct entete_gps), entete.nb_lignes * sizeof(struct ligne_gps));
+        nb_lignes += entete.nb_lignes;
+        memcpy(hotes[source], entete.hostname, MPI_MAX_PROCESSOR_NAME);
+        hotes[source][MPI_MAX_PROCESSOR_NAME - 1] = '\0';
+        uids[source] = entete.uid;
+        files[source] = entete;
+        en_attente += entete.en_attente;
+        repondu[source] = 1;
+        nb_reponses++;
+        free(reponse);
+    }
+
+    qsort(lignes, nb_lignes, sizeof(struct ligne_gps), comparer_lignes_gps);
+    if(option == 0){ // gps
+        printf("PID\tGPID\tCMD\n");
+        for(int k = 0; k < nb_lignes; k++)
+            printf("%d\t%lld\t%s\n", lignes[k].pid, (long long) lignes[k].gpid, lignes[k].cmd);
+    }else{  // gps -l
+        printf("HOST\t\tUID\tPID\tGPID\tGROUPE\tCMD\tCPU\tMEM\n");
+        for(int k = 0; k < nb_lignes; k++){
+            struct ligne_gps *l = &lignes[k];
+            printf("%s\t\t%d\t%d\t%lld\t%d\t%s\t%.1f%%\t%lld Ko\n", hotes[l->rang], uids[l->rang], l->pid, (long long) l->gpid,
+                   l->groupe, l->cmd, l->cpu, (long long) l->rss);
+        }
+        // Files d'attente des machines qui ont été saturées au moins une fois
+        int titre = 0;
+        for(int i = 1; i < nb_serveurs; i++){
+            struct entete_gps *f = &files[i];
+            if(!repondu[i] || (f->mis_en_file == 0 && f->refuses == 0))
+                continue;
+            if(!titre){
+                printf("HOST\t\tATTENTE\tMAX\tEN FILE\tSORTIS\tREFUSES\tMOY (ms)\tMAX (ms)\n");
+                titre = 1;
+            }
+            printf("%s\t\t%d\t%d\t%lld\t%lld\t%lld\t%.1f\t\t%.1f\n", hotes[i], f->en_attente, f->longueur_max,
+                   (long long) f->mis_en_file, (long long) f->distribues, (long long) f->refuses,
+                   f->attente_moyenne_ms, f->attente_max_ms);
+        }
+    }
+    if(en_attente > 0)
+        printf("%d gstart attendent qu'une machine passe sous la charge %.2f\n", en_attente, seuil_capacite);
+    for(int i = 1; i < nb_serveurs; i++){
+        if(!repondu[i])
+            printf("La machine %d n'a pas répondu dans les %d ms\n", i, DELAI_GPS_MS);
+    }
+    free(lignes);
+    free(hotes);
+    free(files);
+}
+
+/**
+ * @brief test_gkill - gestion de la fonction gskill avant de l'envoyer dans le réseau
+ * 
+ */
+
+void test_gkill(){
+   int sig;
+   long long gpid;
+   int cible;
+   int id_machine;
+   char y_or_n[2];
+   char motif[256];
+   struct selection s;
+   gpid_t gpids[(TAILLE_MESSAGE - sizeof(struct selection)) / sizeof(gpid_t)];
+   
+    printf("Connaissez-vous le GPID du processus à qui vous allez envoyer un signal ? (y/n)\n");
+    saisir("%s", &y_or_n);
+    if(strcmp(y_or_n, "n") == 0 ){
+        printf("Vous devez passer par la commande \"gps\"\n");
+        //sleep(2);
+    }else{
+        do{
+            printf(" Liste des signaux:\n");
+            //system("kill -l");
+            printf(" 1) SIGHUP       2) SIGINT       3) SIGQUIT      4) SIGILL       5) SIGTRAP\n");
+            printf(" 6) SIGABRT      7) SIGBUS       8) SIGFPE       9) SIGKILL     10) SIGUSR1\n");
+            printf(" 11) SIGSEGV     12) SIGUSR2     13) SIGPIPE     14) SIGALRM     15) SIGTERM\n");
+            printf(" 16) SIGSTKFLT   17) SIGCHLD     18) SIGCONT     19) SIGSTOP     20) SIGTSTP\n");
+            printf(" 21) SIGTTIN     22) SIGTTOU     23) SIGURG      24) SIGXCPU     25) SIGXFSZ\n");
+            printf(" 26) SIGVTALRM   27) SIGPROF     28) SIGWINCH    29) SIGIO       30) SIGPWR\n");
+            printf(" 31) SIGSYS      34) SIGRTMIN    35) SIGRTMIN+1  36) SIGRTMIN+2  37) SIGRTMIN+3\n");
+            printf(" 38) SIGRTMIN+4  39) SIGRTMIN+5  40) SIGRTMIN+6  41) SIGRTMIN+7  42) SIGRTMIN+8\n");
+            printf(" 43) SIGRTMIN+9  44) SIGRTMIN+10 45) SIGRTMIN+11 46) SIGRTMIN+12 47) SIGRTMIN+13\n");
+            printf(" 48) SIGRTMIN+14 49) SIGRTMIN+15 50) SIGRTMAX-14 51) SIGRTMAX-13 52) SIGRTMAX-12\n");
+            printf(" 53) SIGRTMAX-11 54) SIGRTMAX-10 55) SIGRTMAX-9  56) SIGRTMAX-8  57) SIGRTMAX-7\n");
+            printf(" 58) SIGRTMAX-6  59) SIGRTMAX-5  60) SIGRTMAX-4  61) SIGRTMAX-3  62) SIGRTMAX-2\n");
+            printf(" 63) SIGRTMAX-1  64) SIGRTMAX\n");
+            printf("\nVeuillez entrer le numéro du signal: \n");
+            saisir("%d", &sig);
+            if(sig>0 && sig <= 64){ // vérification du numéro de signal entrer par l'utilisateur
+                break;
+            }
+            printf("\nNous n'avons pas compris le numéro que vous avez indiquer. Veuillez réessayer\n");
+        }while(1);
+        // envoyer la sélection à une machine participante car celle qui lance les test ne fait jamais de recv
+        id_machine = (rank != nb_proc - 1) ? (rank+1)%nb_proc : 1;
+        s.signal = sig;
+        s.groupe = 0;
+        s.nb = 0;
+        s.renvois = 0;
+
+        printf("Processus visés :\n");
+        printf("1 - un ou plusieurs GPID\n");
+        printf("2 - tous les processus d'un groupe\n");
+        printf("3 - les processus dont la commande correspond à un motif (ex : \"./test*\")\n");
+        saisir("%d", &cible);
+        if(cible == 2){
+            s.type = SELECTION_GROUPE;
+            printf("Veuillez entrer le groupe \n");
+            saisir("%d", &s.groupe);
+            envoyer_selection(id_machine, TAG_RECHERCHE_GPID, &s, NULL);
+        }else if(cible == 3){
+            s.type = SELECTION_MOTIF;
+            printf("Veuillez entrer le motif \n");
+            saisir("%255s", motif);
+            s.nb = strlen(motif) + 1;
+            envoyer_selection(id_machine, TAG_RECHERCHE_GPID, &s, motif);
+        }else{
+            // Les GPID sont envoyés directement à leur machine d'origine, par paquets d'un message au plus
+            s.type = SELECTION_GPID;
+            printf("Veuillez entrer les GPID, terminés par 0 \n");
+            while(saisir("%lld", &gpid) == 1 && gpid != 0){
+                gpids[s.nb++] = gpid;
+                if(s.nb == (int) (sizeof(gpids) / sizeof(gpid_t))){
+                    gkill_gpid(&s, (char *) gpids);
+                    s.nb = 0;
+                }
+            }
+            if(s.nb > 0)
+                gkill_gpid(&s, (char *) gpids);
+        }
+        envoi_terminer();
+    }
+}
+
+/**
+ * @brief test_present - envoi un message à toutes les machines
+ *                       A la reception de ce message, si la machine participe dans le réseau
+ *                       elle devra faire un affichage (cf fonction receive TAG_PRESENT)
+ *                       
+ */
+
+void test_present(){
+    int k = 0;
+    for(int i = 1; i < nb_proc; i++){
+        envoyer(&k, sizeof(int), i, TAG_PRESENT);
+    }
+    envoi_terminer();
+}
+
+#endif
+
+/***************************************************************************************************
+                                               LANCER
+***************************************************************************************************/
+
+/**
+ * @brief lancer_gstart - permet de générer un GPID unique, de notifier ce dernier à toutes les machines
+ *                        et ensuite lance l'appel à la fonction gstart
+ * 
+ * @param argv         contient le nom de la commande [option] [arguments]
+ * @param groupe       groupe du processus (0 si aucun)
+ * @return gpid_t      gpid attribué au processus
+ */
+
+gpid_t lancer_gstart(char **argv, int groupe){
+    int indice_process;
+    gpid_t gpid;
+    
+    // Génération du gpid : notre rang, l'époque et la séquence (cf gpid_t)
+    gpid = GPID(rank, epoque_gpid, cpt_gpid);
+    if(++cpt_gpid == 0){
+        cpt_gpid = 1;
+        epoque_gpid = (epoque_gpid + 1) & ((1 << BITS_EPOQUE_GPID) - 1);
+    }
+    
+    // réservation d'un emplacement disponible dans le tableau process
+    indice_process = process_allouer();
+
+    // Envoi un message du GPID généré à toutes les machines participantes dans le réseau 
+    annoncer_gpid(gpid, indice_process);
+    
+    // Création d'un processus + exécution de la tache
+    gstart(argv, gpid, indice_process, groupe);
+    return gpid;
+}
+
+
+/***************************************************************************************************
+                                           FILE D'ATTENTE
+***************************************************************************************************/
+
+/*
+ * Quand toutes les machines participantes ont une charge estimée d'au moins seuil_capacite, un gstart
+ * n'est plus placé : la machine qui le reçoit le garde dans sa file (la file est donc répartie entre
+ * les serveurs) et le distribue dès qu'une machine repasse sous le seuil, que ce soit par une charge
+ * reçue ou par la fin d'un de nos processus. Les gstart sortent de la file :
+ *  - par priorité décroissante ;
+ *  - à priorité égale, en servant d'abord l'utilisateur qui a eu le moins de tâches distribuées
+ *    (un utilisateur qui revient dans la file est rattrapé sur les autres, il ne peut pas
+ *    réclamer le temps où il n'avait rien soumis) ;
+ *  - puis dans leur ordre d'arrivée.
+ * Au-delà de taille_max_file gstart en attente, les soumissions accusées sont refusées
+ * (ACCUSE_REFUSE) : c'est au demandeur de ralentir et de resoumettre.
+ */
+
+/**
+ * @brief accuser_gstart - répond au demandeur d'un gstart soumis avec un numéro (rien sinon)
+ * 
+ * @param e         en-tête de l'enveloppe du gstart
+ * @param gpid      gpid attribué, 0 si le processus n'est pas lancé
+ * @param etat      ACCUSE_LANCE, ACCUSE_EN_FILE ou ACCUSE_REFUSE
+ */
+
+void accuser_gstart(const struct enveloppe *e, gpid_t gpid, int etat){
+    struct accuse_gstart accuse;
+
+    if(e->numero == 0)
+        return;
+    accuse.numero = e->numero;
+    accuse.gpid = gpid;
+    accuse.etat = etat;
+    accuse.longueur_file = file_attente.nb;
+    envoyer(&accuse, sizeof(struct accuse_gstart), e->demandeur, TAG_GSTART_ACK);
+}
+
+/**
+ * @brief lancer_gstart_accuse - lance le gstart sur notre machine et l'accuse au demandeur
+ * 
+ * @param commande  éléments de la commande, terminés par NULL
+ * @param e         en-tête de l'enveloppe du gstart
+ */
+
+void lancer_gstart_accuse(char **commande, const struct enveloppe *e){
+    metriques.sauts_gstart[e->sauts < MAX_SAUTS ? e->sauts : MAX_SAUTS]++;
+    if(e->sauts > metriques.sauts_max)
+        metriques.sauts_max = e->sauts;
+    gpid_t gpid = lancer_gstart(commande, e->flags);
+    accuser_gstart(e, gpid, ACCUSE_LANCE);
+}
+
+/**
+ * @brief tache_avant - ordre du tas d'un utilisateur : priorité décroissante puis arrivée croissante
+ */
+
+static inline int tache_avant(const struct tache_en_attente *a, const struct tache_en_attente *b){
+    return a->priorite > b->priorite || (a->priorite == b->priorite && a->arrivee < b->arrivee);
+}
+
+/**
+ * @brief file_utilisateur - file d'un utilisateur, créée à sa première soumission
+ * 
+ * @param uid       utilisateur
+ * @return int      indice de sa file dans file_attente.utilisateurs
+ */
+
+int file_utilisateur(int uid){
+    for(int i = 0; i < file_attente.nb_utilisateurs; i++){
+        if(file_attente.utilisateurs[i].uid == uid)
+            return i;
+    }
+    if(file_attente.nb_utilisateurs == file_attente.capacite_utilisateurs){
+        file_attente.capacite_utilisateurs = file_attente.capacite_utilisateurs ? 2 * file_attente.capacite_utilisateurs : 8;
+        file_attente.utilisateurs = (struct file_utilisateur *) realloc(file_attente.utilisateurs,
+                                    file_attente.capacite_utilisateurs * sizeof(struct file_utilisateur));
+        if(!file_attente.utilisateurs){
+            perror("file_utilisateur");
+            exit(1);
+        }
+    }
+    struct file_utilisateur *u = &file_attente.utilisateurs[file_attente.nb_utilisateurs];
+    memset(u, 0, sizeof(struct file_utilisateur));
+    u->uid = uid;
+    return file_attente.nb_utilisateurs++;
+}
+
+/**
+ * @brief file_attente_ajouter - met un gstart en attente (copie de son enveloppe)
+ * 
+ * @param e         en-tête de l'enveloppe
+ * @param msg       enveloppe reçue
+ * @param taille    taille de l'enveloppe en octets
+ * @return int      0 si le gstart est en file, -1 s'il est refusé car la file est pleine
+ */
+
+int file_attente_ajouter(const struct enveloppe *e, const char *msg, int taille){
+    // Un gstart sans numéro ne peut pas être refusé (personne n'attend de réponse),
+    // ni un gstart déjà accepté par une autre file (son demandeur n'a plus de quoi le resoumettre)
+    if(file_attente.nb >= taille_max_file && e->numero != 0 && !e->admis){
+        file_attente.refuses++;
+        return -1;
+    }
+
+    int indice = file_utilisateur(e->utilisateur);    // peut déplacer file_attente.utilisateurs
+    struct file_utilisateur *u = &file_attente.utilisateurs[indice];
+    if(u->nb == 0){
+        // L'utilisateur revient : il repart au moins au niveau du moins servi des utilisateurs en attente
+        double min = -1;
+        for(int i = 0; i < file_attente.nb_utilisateurs; i++){
+            struct file_utilisateur *v = &file_attente.utilisateurs[i];
+            if(v->nb > 0 && (min < 0 || v->servi < min))
+                min = v->servi;
+        }
+        if(min > u->servi)
+            u->servi = min;
+    }
+    if(u->nb == u->capacite){
+        u->capacite = u->capacite ? 2 * u->capacite : 16;
+        u->taches = (struct tache_en_attente *) realloc(u->taches, u->capacite * sizeof(struct tache_en_attente));
+        if(!u->taches){
+            perror("file_attente_ajouter");
+            exit(1);
+        }
+    }
+
+    struct tache_en_attente t;
+    t.msg = (char *) malloc(taille);
+    if(!t.msg){
+        perror("file_attente_ajouter");
+        exit(1);
+    }
+    memcpy(t.msg, msg, taille);
+    t.taille = taille;
+    t.priorite = e->priorite;
+    t.arrivee = file_attente.arrivees++;
+    clock_gettime(CLOCK_MONOTONIC, &t.date);
+
+    // Insertion dans le tas : la tâche remonte tant qu'elle passe avant son parent
+    int i = u->nb++;
+    while(i > 0 && tache_avant(&t, &u->taches[(i - 1) / 2])){
+        u->taches[i] = u->taches[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    u->taches[i] = t;
+
+    file_attente.nb++;
+    file_attente.mis_en_file++;
+    if(file_attente.nb > file_attente.longueur_max)
+        file_attente.longueur_max = file_attente.nb;
+    return 0;
+}
+
+/**
+ * @brief file_attente_tete - file de l'utilisateur dont le gstart sera distribué en premier : la plus
+ *                            haute priorité en tête d'une file, et à priorité égale le moins servi
+ * 
+ * @return struct file_utilisateur*     file choisie (son gstart est taches[0]), NULL si tout est vide
+ */
+
+struct file_utilisateur *file_attente_tete(){
+    struct file_utilisateur *choisi = NULL;
+
+    for(int i = 0; i < file_attente.nb_utilisateurs; i++){
+        struct file_utilisateur *u = &file_attente.utilisateurs[i];
+        if(u->nb == 0)
+            continue;
+        if(choisi == NULL || u->taches[0].priorite > choisi->taches[0].priorite
+           || (u->taches[0].priorite == choisi->taches[0].priorite
+               && (u->servi < choisi->servi || (u->servi == choisi->servi && u->taches[0].arrivee < choisi->taches[0].arrivee))))
+            choisi = u;
+    }
+    return choisi;
+}
+
+/**
+ * @brief file_attente_retirer - retire le prochain gstart à distribuer (cf file_attente_tete)
+ * 
+ * @param t         gstart retiré (son enveloppe est à libérer par l'appelant)
+ * @return int      1 si un gstart a été retiré, 0 si la file est vide
+ */
+
+int file_attente_retirer(struct tache_en_attente *t){
+    struct file_utilisateur *choisi = file_attente_tete();
+    if(choisi == NULL)
+        return 0;
+
+    *t = choisi->taches[0];
+    choisi->servi++;
+    file_attente.nb--;
+
+    // Le dernier élément du tas redescend depuis la racine
+    struct tache_en_attente dernier = choisi->taches[--choisi->nb];
+    int i = 0;
+    while(2 * i + 1 < choisi->nb){
+        int fils = 2 * i + 1;
+        if(fils + 1 < choisi->nb && tache_avant(&choisi->taches[fils + 1], &choisi->taches[fils]))
+            fils++;
+        if(!tache_avant(&choisi->taches[fils], &dernier))
+            break;
+        choisi->taches[i] = choisi->taches[fils];
+        i = fils;
+    }
+    if(choisi->nb > 0)
+        choisi->taches[i] = dernier;
+    return 1;
+}
+
+/**
+ * @brief file_attente_distribuer - distribue les gstart en attente tant qu'une machine est disponible.
+ *                                  Appelée à chaque tour de la boucle de réception : une charge
+ *                                  reçue ou un processus terminé suffit à relancer la distribution.
+ *                                  Une machine qui ne participe plus confie sa file à un participant.
+ *                                  Un gstart replacé SAUTS_PLACEMENT fois n'est plus replacé : en tête
+ *                                  de file, il bloque la distribution jusqu'à ce que notre machine se libère.
+ * 
+ */
+
+void file_attente_distribuer(){
+    struct tache_en_attente t;
+    struct enveloppe e;
+    struct timespec maintenant;
+
+    while(file_attente.nb > 0){
+        int id_machine = 0;
+        int32_t place = 0;
+        int32_t sauts;
+
+        if(tab_participe[rank] == 0){
+            id_machine = participant_suivant();
+            if(id_machine == -1)
+                return;
+        }else if(reseau_sature()){
+            return;
+        }
+
+        memcpy(&sauts, file_attente_tete()->taches[0].msg + offsetof(struct enveloppe, sauts), sizeof(int32_t));
+        if(tab_participe[rank] != 0 && sauts >= SAUTS_PLACEMENT && !machine_disponible(rank))
+            return;
+
+        file_attente_retirer(&t);
+        if(tab_participe[rank] != 0){
+            if(sauts >= SAUTS_PLACEMENT){
+                // Il n'est plus replacé (cf recv_gstart) : notre machine vient de se libérer
+                placement_compter(rank);
+                id_machine = rank;
+            }else{
+                // getIdMachineMoinsCharge compte le placement : la boucle s'arrête quand tout est de nouveau saturé
+                id_machine = getIdMachineMoinsCharge();
+                place = 1;
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &maintenant);
+        double attente_ms = (maintenant.tv_sec - t.date.tv_sec) * 1e3 + (maintenant.tv_nsec - t.date.tv_nsec) / 1e6;
+        file_attente.distribues++;
+        file_attente.attente_totale_ms += attente_ms;
+        if(attente_ms > file_attente.attente_max_ms)
+            file_attente.attente_max_ms = attente_ms;
+
+        if(id_machine == rank){
+            char **commande = enveloppe_decoder(t.msg, t.taille, &e);
+            metriques.placements[DECISION_LOCAL]++;
+            lancer_gstart_accuse(commande, &e);
+        }else{
+            // La machine choisie lance la tâche si elle n'est pas saturée entre temps,
+            // sinon elle la garde dans sa file sans pouvoir la refuser
+            int32_t admis = 1;
+            int32_t epoque = epoque_vue;
+            sauts++;
+            memcpy(t.msg + offsetof(struct enveloppe, place), &place, sizeof(int32_t));
+            memcpy(t.msg + offsetof(struct enveloppe, admis), &admis, sizeof(int32_t));
+            memcpy(t.msg + offsetof(struct enveloppe, sauts), &sauts, sizeof(int32_t));
+            memcpy(t.msg + offsetof(struct enveloppe, epoque), &epoque, sizeof(int32_t));
+            metriques.placements[place ? DECISION_TRANSMIS : DECISION_RELAIS]++;
+            envoyer(t.msg, t.taille, id_machine, TAG_GSTART);
+        }
+        free(t.msg);
+    }
+}
+
+/**
+ * @brief file_attente_vider - libère la file à l'arrêt du serveur et affiche ses métriques
+ * 
+ */
+
+void file_attente_vider(){
+    struct tache_en_attente t;
+    int abandonnes = 0;
+
+    while(file_attente_retirer(&t)){
+        free(t.msg);
+        abandonnes++;
+    }
+    if(file_attente.mis_en_file > 0 || file_attente.refuses > 0)
+        JOURNAL(LOG_INFO, "%s : file d'attente : %lld gstart mis en file, %lld distribués, %lld refusés, %d abandonnés, "
+                          "longueur max %d, attente moyenne %.1f ms, max %.1f ms\n", hostname, file_attente.mis_en_file,
+                          file_attente.distribues, file_attente.refuses, abandonnes, file_attente.longueur_max,
+                          file_attente.distribues ? file_attente.attente_totale_ms / file_attente.distribues : 0.0,
+                          file_attente.attente_max_ms);
+    for(int i = 0; i < file_attente.nb_utilisateurs; i++)
+        free(file_attente.utilisateurs[i].taches);
+    free(file_attente.utilisateurs);
+    memset(&file_attente, 0, sizeof(file_attente));
+}
+
+/***************************************************************************************************
+                                                RECV
+***************************************************************************************************/
+
+/**
+ * @brief recv_gstart - traite une commande gstart : on la lance si on est la machine
+ *                      la moins chargée, sinon on fait suivre l'enveloppe reçue telle quelle.
+ *                      Si toutes les machines sont saturées, elle attend dans notre file,
+ *                      comme un gstart déjà replacé SAUTS_PLACEMENT fois (cf file_attente_distribuer).
+ *                      Une machine qui ne participe pas la fait suivre en un saut à un
+ *                      participant de sa vue.
+ * 
+ * @param commande      éléments de la commande, terminés par NULL
+ * @param e             en-tête de l'enveloppe (groupe dans flags, accusé à envoyer si numero != 0)
+ * @param msg           enveloppe reçue
+ * @param taille        taille de l'enveloppe en octets
+ */
+
+void recv_gstart(char **commande, const struct enveloppe *e, char *msg, int taille){
+    int id_machine;
+    int32_t place = 0;
+    int32_t sauts = e->sauts + 1;
+    int32_t epoque = epoque_vue;
+
+    if(tab_participe[rank] == 0 && !(e->place && e->epoque > epoque_vue)){ // si je ne participe pas
+        // Je l'envoie directement à un participant de ma vue (le rang 0 ne fait que le menu)
+        id_machine = participant_suivant();
+        if(id_machine == -1){
+            metriques.placements[DECISION_LOCAL]++;
+            lancer_gstart_accuse(commande, e);
+            return;
+        }
+        metriques.placements[DECISION_RELAIS]++;
+    }else if(e->place && tab_participe[rank] == 0){
+        // Placé par une vue plus récente que la nôtre, qui nous compte déjà parmi les participants
+        placement_compter(rank);
+        metriques.placements[DECISION_LOCAL]++;
+        lancer_gstart_accuse(commande, e);
+        return;
+    }else if((e->place || e->sauts >= SAUTS_PLACEMENT) && machine_disponible(rank)){
+        // Une autre machine nous a choisis et on a encore de la place : pas de nouveau placement
+        placement_compter(rank);
+        metriques.placements[DECISION_LOCAL]++;
+        lancer_gstart_accuse(commande, e);
+        return;
+    }else if(reseau_sature() || e->sauts >= SAUTS_PLACEMENT){
+        // Toutes les machines sont saturées, ou les vues divergent et il a déjà été replacé
+        // SAUTS_PLACEMENT fois : le gstart attend dans notre file que notre machine se libère
+        if(file_attente_ajouter(e, msg, taille) == -1){
+            metriques.placements[DECISION_REFUS]++;
+            accuser_gstart(e, 0, ACCUSE_REFUSE);
+        }else{
+            metriques.placements[DECISION_FILE]++;
+            if(!e->admis)  // le demandeur sait déjà qu'il est en file
+                accuser_gstart(e, 0, ACCUSE_EN_FILE);
+        }
+        return;
+    }else{
+        // Sinon je suis participant
+        //Récupère la machine l'identifiant de la machine la moins chargé du réseau
+        id_machine = getIdMachineMoinsCharge();
+        if(id_machine == rank){ // si je suis la machine la moins chargée du réseau
+            metriques.placements[DECISION_LOCAL]++;
+            lancer_gstart_accuse(commande, e);
+            return;
+        }
+        place = 1;
+        metriques.placements[DECISION_TRANSMIS]++;
+    }
+    // Fait suivre la commande à id_machine, sans la réencoder
+    memcpy(msg + offsetof(struct enveloppe, place), &place, sizeof(int32_t));
+    memcpy(msg + offsetof(struct enveloppe, sauts), &sauts, sizeof(int32_t));
+    memcpy(msg + offsetof(struct enveloppe, epoque), &epoque, sizeof(int32_t));
+    envoyer(msg, taille, id_machine, TAG_GSTART);
+}
+
+/**
+ * @brief relancer_depuis_debut - relance un processus transféré sans checkpoint (ou dont le checkpoint
+ *                                est perdu) et l'annonce aux participants
+ * 
+ * @param i         indice du processus dans la table process
+ */
+
+void relancer_depuis_debut(int i){
+    int lance = lancer_processus(i, NULL);
+    metriques.migrations_recues++;
+    JOURNAL(LOG_INFO, "%s relance le processus %s (gpid %lld) depuis le début, pid %d\n", hostname, process[i].cmd, (long long) process[i].gpid, process[i].pid);
+    annuaire_ajouter(process[i].gpid, rank, i, process[i].pid);
+    annoncer_gpid(process[i].gpid, i);
+    if(lance == -1)
+        terminer_processus(i, W_EXITCODE(127, 0));
+}
+
+/**
+ * @brief reception_terminer - le checkpoint d'un processus transféré est entièrement reçu, ou perdu
+ *                             (fd à -1) : on relance le processus à partir du checkpoint, ou depuis le début
+ * 
+ * @param i         indice du processus dans la table process
+ */
+
+void reception_terminer(int i){
+    char chemin[PATH_MAX];
+    struct timespec fin;
+
+    nb_migrations--;
+    controleur.echanges[process[i].cible].en_cours--;
+    if(process[i].fd == -1){
+        relancer_depuis_debut(i);
+        return;
+    }
+
+    close(process[i].fd);
+    process[i].fd = -1;
+    chemin_checkpoint(chemin, sizeof(chemin), process[i].gpid);
+    int lance = lancer_processus(i, chemin);
+    clock_gettime(CLOCK_MONOTONIC, &fin);
+    uint64_t duree_ns = (fin.tv_sec - process[i].debut_migration.tv_sec) * 1000000000ULL + fin.tv_nsec - process[i].debut_migration.tv_nsec;
+    metriques.migrations_recues++;
+    metriques.octets_migres_recus += process[i].taille_checkpoint;
+    histo_ajouter(&metriques.duree_reception, duree_ns);
+    JOURNAL(LOG_INFO, "%s restaure le processus %s (gpid %lld) : %lld octets reçus en %.1f ms, pid %d\n", hostname,
+                      process[i].cmd, (long long) process[i].gpid, process[i].taille_checkpoint, duree_ns / 1e6, process[i].pid);
+    annuaire_ajouter(process[i].gpid, rank, i, process[i].pid);
+    annoncer_gpid(process[i].gpid, i);
+    if(lance == -1)
+        terminer_processus(i, W_EXITCODE(127, 0));
+}
+
+/**
+ * @brief reception_perdre - on ne peut plus écrire le checkpoint reçu : on l'efface, le processus
+ *                           sera relancé depuis le début (cf reception_terminer)
+ * 
+ * @param i         indice du processus dans la table process
+ */
+
+void reception_perdre(int i){
+    char chemin[PATH_MAX];
+
+    if(process[i].fd == -1)
+        return;
+    close(process[i].fd);
+    process[i].fd = -1;
+    chemin_checkpoint(chemin, sizeof(chemin), process[i].gpid);
+    unlink(chemin);
+}
+
+/**
+ * @brief recv_transfert - reçoit l'enveloppe d'un processus transféré par une autre machine.
+ *                         Sans checkpoint il est relancé tout de suite, sinon on attend ses
+ *                         taille_donnees octets (TAG_TRANSFERT_DONNEES) avant de le restaurer.
+ * 
+ * @param source            machine qui transfère le processus
+ * @param gpid              gpid du processus
+ * @param argv              commande complète du processus, terminée par NULL
+ * @param groupe            groupe du processus (0 si aucun)
+ * @param taille_donnees    taille du checkpoint en octets (0 s'il n'y en a pas)
+ */
+
+void recv_transfert(int source, gpid_t gpid, char **argv, int groupe, long long taille_donnees){
+    char chemin[PATH_MAX];
+
+    // Réservation d'une case de la table des processus (elle s'agrandit si elle est pleine)
+    int indice_process = process_allouer();
+    renvoi_oublier(gpid);
+    process[indice_process].gpid = gpid;
+    process[indice_process].cmd = strdup(argv[0]);
+    process[indice_process].argv = argv_dupliquer(argv);
+    process[indice_process].groupe = groupe;
+
+    if(taille_donnees == 0){
+        relancer_depuis_debut(indice_process);
+        return;
+    }
+
+    // Le checkpoint est écrit dans notre répertoire au fur et à mesure de son arrivée. Si on ne peut pas
+    // l'écrire (fd à -1), on en reçoit quand même les blocs, puis le processus est relancé depuis le début
+    chemin_checkpoint(chemin, sizeof(chemin), gpid);
+    process[indice_process].fd = open(chemin, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if(process[indice_process].fd == -1)
+        JOURNAL(LOG_ERREUR, "%s : impossible d'écrire le checkpoint du gpid %lld dans %s (%s), il sera relancé depuis le début\n",
+                hostname, (long long) gpid, chemin, strerror(errno));
+    process[indice_process].etat = ETAT_RECEPTION;
+    process[indice_process].cible = source;
+    controleur.echanges[source].en_cours++;
+    process[indice_process].taille_checkpoint = taille_donnees;
+    process[indice_process].position_checkpoint = 0;
+    clock_gettime(CLOCK_MONOTONIC, &process[indice_process].debut_migration);
+    nb_migrations++;
+    annuaire_ajouter(gpid, rank, indice_process, 0);
+}
+
+/**
+ * @brief recv_transfert_donnees - écrit un bloc du checkpoint d'un processus transféré ;
+ *                                 au dernier bloc le processus est relancé à partir du checkpoint
+ * 
+ * @param gpid      gpid du processus
+ * @param donnees   bloc du checkpoint
+ * @param taille    taille du bloc en octets
+ */
+
+void recv_transfert_donnees(gpid_t gpid, const char *donnees, int taille){
+    struct entree_gpid e;
+    if(!annuaire_lire(gpid, &e) || e.rang != rank || process[e.indice].etat != ETAT_RECEPTION){
+        JOURNAL(LOG_ERREUR, "%s : bloc de checkpoint inattendu pour le gpid %lld\n", hostname, (long long) gpid);
+        return;
+    }
+    int i = e.indice;
+
+    // Les blocs d'un même émetteur arrivent dans l'ordre : on écrit à la suite
+    if(process[i].fd != -1 && pwrite(process[i].fd, donnees, taille, process[i].position_checkpoint) != taille){
+        JOURNAL(LOG_ERREUR, "%s : écriture du checkpoint du gpid %lld impossible (%s), il sera relancé depuis le début\n",
+                hostname, (long long) gpid, strerror(errno));
+        reception_perdre(i);
+    }
+    process[i].position_checkpoint += taille;
+    if(process[i].position_checkpoint >= process[i].taille_checkpoint)
+        reception_terminer(i);
+}
+
+/**
+ * @brief traiter_message - traitement d'un message reçu. Aucun traitement ne bloque sur le réseau.
+ * 
+ * @param source        rang de l'émetteur
+ * @param tag           TAG du message
+ * @param msg           contenu du message
+ * @param taille        taille du message en octets
+ * @return int          1 si le serveur doit s'arrêter (TAG_END), sinon 0
+ */
+
+int traiter_message(int source, int tag, char *msg, int taille){
+    int *entiers = (int *) msg;             // Vue entière du message (TAG_GPS, TAG_EQUILIBRAGE, ...)
+    struct avis_gpid avis;                  // TAG_GPID, TAG_GKILL_GPID, TAG_FIN_GPID
+    struct enveloppe e;                     // TAG_GSTART, TAG_TRANSFERT
+    char **commande = NULL;                 // TAG_GSTART, TAG_TRANSFERT
+    struct demande_vue demande;             // TAG_VUE_DEMANDE
+
+    switch (tag){
+        case TAG_CHARGE:
+            // Récupère le vecteur des charges de la machine source et le fusionne avec le nôtre
+            if(taille > nb_max * (int) sizeof(struct charge_versionnee))
+                taille = nb_max * sizeof(struct charge_versionnee);
+            memcpy(tampon_gossip, msg, taille);
+            recv_charge(taille / sizeof(struct charge_versionnee));
+            break;
+
+        case TAG_GSTART:
+            // Réception d'une commande à lancer, décodée sans copie dans le tampon de réception
+            commande = enveloppe_decoder(msg, taille, &e);
+            if(commande == NULL || e.argc == 0){
+                JOURNAL(LOG_ERREUR, "%s : enveloppe TAG_GSTART invalide reçue de %d\n", hostname, source);
+                break;
+            }
+            recv_gstart(commande, &e, msg, taille);
+            break;
+        
+        case TAG_GPID:
+            // Réception du gpid généré par la machine source
+            if(taille != sizeof(struct avis_gpid))
+                break;
+            memcpy(&avis, msg, sizeof(struct avis_gpid));
+            if(amorcage_garder(tag, source, &avis))
+                break;
+            annuaire_ajouter(avis.gpid, source, avis.indice, 0);
+            break;
+        
+        case TAG_GPS:
+            // Réception du message GPS : on renvoie la liste de nos processus au demandeur
+            gps(entiers[0], entiers[1], source);
+            break;
+
+        case TAG_GKILL :
+            // gpid à signaler ou à faire suivre (ou un groupe / motif à chercher chez nous)
+            {
+                struct selection sel;
+                char *donnees = selection_decoder(msg, taille, &sel);
+                if(donnees != NULL)
+                    gkill_selection(&sel, donnees);
+            }
+            break;
+    
+        case TAG_GKILL_GPID :
+            // Réception de l'information que GPID de la machine source n'est plus là
+            if(taille != sizeof(struct avis_gpid))
+                break;
+            memcpy(&avis, msg, sizeof(struct avis_gpid));
+            if(amorcage_garder(tag, source, &avis))
+                break;
+            recv_gkill(source, avis.gpid, avis.indice);
+            break;
+
+        case TAG_FIN_GPID :
+            // Le processus GPID de la machine source s'est terminé
+            if(taille != sizeof(struct avis_gpid))
+                break;
+            memcpy(&avis, msg, sizeof(struct avis_gpid));
+            if(amorcage_garder(tag, source, &avis))
+                break;
+            recv_fin(source, &avis);
+            break;
+        
+        case TAG_RECHERCHE_GPID:
+            // Diffusion d'un gkill de groupe ou de motif à tous les participants
+            if(tab_participe[rank] == 0 && participant_suivant() != -1){ // Je ne suis pas participant : un participant de ma vue diffuse
+                envoyer(msg, taille, participant_suivant(), TAG_RECHERCHE_GPID);
+            }else{ // Je suis participant : je connais les autres participants
+                recv_recherche_gpid(msg, taille);
+            }
+            break;
+
+        case TAG_VUE_DEMANDE:
+            // Demande d'entrée ou de sortie adressée au coordinateur
+            if(rank != COORDINATEUR_VUE || taille != (int) sizeof(struct demande_vue)){
+                JOURNAL(LOG_ERREUR, "%s : demande de vue invalide reçue de %d\n", hostname, source);
+                break;
+            }
+            memcpy(&demande, msg, sizeof(struct demande_vue));
+            recv_demande_vue(&demande);
+            break;
+
+        case TAG_TRANSFERT:
+            // L'enveloppe porte le gpid, la commande complète et la taille du checkpoint qui suit
+            commande = enveloppe_decoder(msg, taille, &e);
+            if(commande == NULL || e.argc == 0 || e.taille_donnees < 0){
+                JOURNAL(LOG_ERREUR, "%s : enveloppe TAG_TRANSFERT invalide reçue de %d\n", hostname, source);
+                break;
+            }
+            recv_transfert(source, e.gpid, commande, e.flags, e.taille_donnees);
+            break;
+
+        case TAG_TRANSFERT_DONNEES:
+            // Bloc du checkpoint d'un processus transféré : le gpid puis les octets
+            if(taille < (int) sizeof(gpid_t))
+                break;
+            {
+                gpid_t gpid;
+                memcpy(&gpid, msg, sizeof(gpid_t));
+                recv_transfert_donnees(gpid, msg + sizeof(gpid_t), taille - sizeof(gpid_t));
+            }
+            break;
+
+        case TAG_EQUILIBRAGE:
+            // Une machine en surcharge nous propose des tâches
+            recv_equilibrage(source, entiers[0]);
+            break;
+
+        case TAG_EQUILIBRAGE_REPONSE:
+            // Nombre de tâches acceptées par la machine à qui on a fait une proposition
+            recv_equilibrage_reponse(source, entiers[0]);
+            break;
+
+        case TAG_MIGRATION_ABANDON:
+            // Une tâche qu'on avait acceptée ne viendra pas : le gpid
+            if(taille < (int) sizeof(gpid_t))
+                break;
+            {
+                gpid_t gpid;
+                memcpy(&gpid, msg, sizeof(gpid_t));
+                recv_migration_abandon(source, gpid);
+            }
+            break;
+
+        case TAG_VUE:
+            // Nouvelle vue des participants diffusée par le coordinateur
+            recv_vue(msg, taille);
+            break;
+
+        case TAG_ETAT_DEMANDE:
+            // Un noeud qui retrouve un participant demande notre annuaire et nos charges
+            recv_demande_etat(source);
+            break;
+
+        case TAG_ETAT:
+            // Bloc de l'instantané que l'on a demandé
+            recv_etat(source, msg, taille);
+            break;
+
+        case TAG_END:
+            // L'utilisateur a décider de quitter le menu
+            // La machine doit arrêter 
+            // Avec --elastique, le rang 0 ne prévient que le coordinateur : lui seul sait quels serveurs
+            // existent encore. Il prévient les autres, puis confirme au rang 0
+            if(elastique > 0 && rank == COORDINATEUR_VUE){
+                for(int i = 0; i < nb_proc; i++){
+                    if(i != rank)
+                        envoyer(&rank, sizeof(int), i, TAG_END);
+                }
+            }
+            return 1;
+#ifndef SIMULATION
+        case TAG_AGRANDIR:
+            // Le coordinateur crée un serveur, avec tous les rangs
+            if(taille == (int) sizeof(struct redimensionnement))
+                agrandir((struct redimensionnement *) msg);
+            break;
+
+        case TAG_RETRECIR:
+            // Le dernier serveur créé s'arrête
+            if(taille == (int) sizeof(struct redimensionnement))
+                retrecir_commencer(((struct redimensionnement *) msg)->rang);
+            break;
+
+        case TAG_ADIEU:
+            // Plus aucun message de l'émetteur ne viendra avant la déconnexion (cf elastique_progresser)
+            depart.adieux++;
+            break;
+#endif
+        
+        case TAG_PRESENT:
+            // Réception d'un message de type TAG_PRESENT
+            // Si je suis participante alors j'affiche pour indiquer ma présence dans le réseau
+            if(tab_participe[rank] == 1){
+                printf("%s participe au réseau et à un serveur d'id %d\n",hostname,rank);
+            }
+            break;
+            
+        default:
+            JOURNAL(LOG_ERREUR, "%s  Erreur : Ne doit pas arriver ici, tag %d\n", hostname, tag);
+            break;
+    }
+    return 0;
+}
+
+#ifndef SIMULATION
+
+/**
+ * @brief receive - boucle d'événements : relève les réceptions terminées, les traite dans
+ *                  leur ordre de dépôt, reposte les tampons et traite les mesures du moniteur
+ * 
+ */
+ 
+
+void receive() {
+    int end = 0;            //TAG_END
+    int taille;
+    uint64_t dernier_message = horloge_ns();
+
+    moteur_demarrer();
+    moniteur_demarrer();
+
+    while(end == 0){
+        int nb_terminees = moteur_progresser();
+
+        // On traite les réceptions de chaque anneau dans leur ordre de dépôt, tant que la plus ancienne est terminée
+        for(int k = 0; end == 0 && k < nb_anneaux; k++){
+            struct anneau *a = anneaux[k];
+            while(end == 0 && a->terminee[a->prochaine]){
+                int i = a->prochaine;
+                MPI_Get_count(&a->status[i], MPI_BYTE, &taille);
+                uint64_t debut = horloge_ns();
+                end = traiter_message(a->status[i].MPI_SOURCE, a->status[i].MPI_TAG, a->tampons[i], taille);
+                metrique_reception(a->status[i].MPI_TAG, taille, horloge_ns() - debut);
+                reception_poster(a, i);
+                a->prochaine = (a->prochaine + 1) % NB_RECEPTIONS;
+            }
+        }
+
+        traiter_mesures();
+        processus_termines();
+        registre_progresser();
+        migrations_progresser();
+        amorcage_progresser();
+        if(file_attente.nb > 0)
+            file_attente_distribuer();
+        metriques_progresser();
+        if(end == 0)
+            end = elastique_progresser();
+
+        // Tant que les messages arrivent, la boucle ne fait pas de pause : une pause dès que l'anneau
+        // est vide limiterait le débit à NB_RECEPTIONS messages par pause
+        if(nb_terminees > 0){
+            dernier_message = horloge_ns();
+        }else if(horloge_ns() - dernier_message > ATTENTE_ACTIVITE_US * 1000ULL){
+            struct timespec pause = {0, ATTENTE_BOUCLE_US * 1000};
+            nanosleep(&pause, NULL);
+        }
+    }
+    moniteur_arreter();
+    moteur_arreter();
+    file_attente_vider();
+    metriques_resume();
+}
+
+#endif
+
+#ifndef SIMULATION
+
+/***************************************************************************************************
+                                                LOT
+***************************************************************************************************/
+
+/**
+ * @brief terminer_reseau - demande à tous les serveurs de s'arrêter (TAG_END) et attend la fin des envois
+ * 
+ */
+
+void terminer_reseau(){
+    // Avec --elastique, le coordinateur fait suivre aux serveurs qui existent encore (cf ELASTICITE)
+    for(int i = 1; i < (elastique > 0 ? COORDINATEUR_VUE + 1 : nb_proc); i++){
+        envoyer(&rank, sizeof(int), i, TAG_END);
+    }
+    envoi_terminer();
+    if(elastique > 0)
+        elastique_attendre_fin();
+}
+
+/**
+ * @brief decouper_ligne - découpe sur place une ligne du lot en arguments : les blancs les séparent,
+ *                         '...' et "..." protègent les blancs, un '#' en début d'argument commente
+ *                         la fin de la ligne
+ * 
+ * @param ligne     ligne lue, modifiée (les arguments pointent dedans)
+ * @param argv      au moins strlen(ligne) / 2 + 2 cases, terminé par NULL
+ * @return int      nombre d'arguments, -1 si un guillemet n'est pas fermé
+ */
+
+int decouper_ligne(char *ligne, char **argv){
+    int argc = 0;
+    char *lecture = ligne;
+    char *ecriture = ligne;     // Toujours avant lecture : les guillemets retirés raccourcissent la ligne
+
+    while(1){
+        while(*lecture != '\0' && isspace((unsigned char) *lecture))
+            lecture++;
+        if(*lecture == '\0' || *lecture == '#')
+            break;
+
+        argv[argc++] = ecriture;
+        char guillemet = 0;
+        while(*lecture != '\0' && (guillemet || !isspace((unsigned char) *lecture))){
+            if(guillemet != 0 && *lecture == guillemet)
+                guillemet = 0;
+            else if(guillemet == 0 && (*lecture == '\'' || *lecture == '"'))
+                guillemet = *lecture;
+            else
+                *ecriture++ = *lecture;
+            lecture++;
+        }
+        if(guillemet != 0)
+            return -1;
+
+        char separateur = *lecture;
+        *ecriture++ = '\0';
+        if(separateur == '\0')
+            break;
+        lecture++;
+    }
+    argv[argc] = NULL;
+    return argc;
+}
+
+/* État d'une soumission en lot */
+
+struct soumission{
+    int numero;                 // Numéro de la ligne (0 : case libre)
+    char *msg;                  // Enveloppe, gardée pour la resoumettre après un refus
+    int taille;                 // Taille de l'enveloppe
+    int refusee;                // 1 si la soumission attend reessai pour repartir
+    struct timespec reessai;    // Date de la prochaine soumission après un refus
+};
+
+struct{
+    struct soumission en_vol[FENETRE_SOUMISSION];  // gstart sans réponse ou refusés
+    int nb_en_vol;              // Cases occupées de en_vol
+    int destination;            // Dernier serveur qui a reçu un gstart (tour de rôle)
+    int delai_ms;               // Délai avant la prochaine resoumission (doublé à chaque refus)
+    struct timespec *dates;     // Date de la première soumission de chaque ligne
+    int capacite_dates;
+    double *latences;           // Soumission -> lancement de chaque processus lancé, en ms
+    int nb_lances;              // gstart lancés (ACCUSE_LANCE)
+    int nb_en_file;             // gstart mis en file (ACCUSE_EN_FILE)
+    int nb_refus;               // Refus reçus (ACCUSE_REFUSE), un gstart peut être refusé plusieurs fois
+}lot;
+
+/**
+ * @brief lot_envoyer - envoie une soumission au serveur suivant (tour de rôle)
+ * 
+ * @param s     soumission
+ */
+
+void lot_envoyer(struct soumission *s){
+    lot.destination = lot.destination % (nb_proc - 1) + 1;
+    envoyer(s->msg, s->taille, lot.destination, TAG_GSTART);
+}
+
+/**
+ * @brief lot_accuses - relève les réponses TAG_GSTART_ACK arrivées, sans bloquer.
+ *                      Un lancement affiche "numéro<TAB>gpid" (le numéro est celui de la ligne) ;
+ *                      un lancement ou une mise en file libère la place dans la fenêtre ;
+ *                      un refus garde la place et programme une nouvelle soumission.
+ * 
+ * @return int      nombre de réponses reçues
+ */
+
+int lot_accuses(){
+    struct accuse_gstart accuse;
+    struct timespec maintenant;
+    int taille, source;
+    char *msg;
+    int nb = 0;
+
+    envoi_progresser();
+    elastique_servir();
+    while((msg = recevoir(TAG_GSTART_ACK, &taille, &source)) != NULL){
+        memcpy(&accuse, msg, sizeof(struct accuse_gstart));
+        free(msg);
+        clock_gettime(CLOCK_MONOTONIC, &maintenant);
+        nb++;
+
+        struct soumission *s = NULL;
+        for(int i = 0; i < FENETRE_SOUMISSION; i++){
+            if(lot.en_vol[i].numero == accuse.numero){
+                s = &lot.en_vol[i];
+                break;
+            }
+        }
+
+        if(accuse.etat == ACCUSE_REFUSE && s != NULL){
+            // La file du serveur est pleine : on ralentit et on resoumet plus tard, ailleurs
+            lot.nb_refus++;
+            s->refusee = 1;
+            s->reessai = maintenant;
+            s->reessai.tv_nsec += lot.delai_ms * 1000000L;
+            s->reessai.tv_sec += s->reessai.tv_nsec / 1000000000L;
+            s->reessai.tv_nsec %= 1000000000L;
+            lot.delai_ms = lot.delai_ms * 2 < DELAI_REESSAI_MAX_MS ? lot.delai_ms * 2 : DELAI_REESSAI_MAX_MS;
+        }else{
+            if(accuse.etat == ACCUSE_LANCE){
+                struct timespec *d = &lot.dates[accuse.numero];
+                lot.latences[lot.nb_lances++] = (maintenant.tv_sec - d->tv_sec) * 1e3 + (maintenant.tv_nsec - d->tv_nsec) / 1e6;
+                printf("%d\t%lld\n", accuse.numero, (long long) accuse.gpid);
+            }else{
+                lot.nb_en_file++;
+            }
+            lot.delai_ms = DELAI_REESSAI_MS;
+            if(s != NULL){
+                free(s->msg);
+                memset(s, 0, sizeof(struct soumission));
+                lot.nb_en_vol--;
+            }
+        }
+    }
+    return nb;
+}
+
+/**
+ * @brief lot_attendre - relève les réponses et resoumet les refus arrivés à échéance
+ *                       jusqu'à ce qu'il reste au plus max_en_vol soumissions dans la fenêtre
+ * 
+ * @param max_en_vol    nombre de soumissions sans réponse acceptées
+ */
+
+void lot_attendre(int max_en_vol){
+    struct timespec maintenant;
+
+    while(1){
+        int nb = lot_accuses();
+        if(lot.nb_en_vol <= max_en_vol)
+            return;
+        clock_gettime(CLOCK_MONOTONIC, &maintenant);
+        for(int i = 0; i < FENETRE_SOUMISSION; i++){
+            struct soumission *s = &lot.en_vol[i];
+            if(s->numero != 0 && s->refusee && (maintenant.tv_sec > s->reessai.tv_sec
+               || (maintenant.tv_sec == s->reessai.tv_sec && maintenant.tv_nsec >= s->reessai.tv_nsec))){
+                s->refusee = 0;
+                lot_envoyer(s);
+            }
+        }
+        if(nb == 0){
+            struct timespec pause = {0, ATTENTE_BOUCLE_US * 1000};
+            nanosleep(&pause, NULL);
+        }
+    }
+}
+
+/**
+ * @brief lire_directives - retire les directives en tête d'une ligne du lot :
+ *                          "@prio=N" (priorité) et "@user=nom|uid" (utilisateur du partage équitable)
+ * 
+ * @param argv          arguments de la ligne, décalés pour commencer à la commande
+ * @param priorite      priorité lue (inchangée sans directive)
+ * @param utilisateur   uid lu (inchangé sans directive)
+ * @return int          0, ou -1 si une directive est invalide
+ */
+
+int lire_directives(char **argv, int *priorite, int *utilisateur){
+    static char dernier_nom[64] = "";
+    static int dernier_uid = -1;
+    int n = 0;
+
+    while(argv[n] != NULL && argv[n][0] == '@'){
+        char *fin;
+        if(strncmp(argv[n], "@prio=", 6) == 0){
+            *priorite = strtol(argv[n] + 6, &fin, 10);
+            if(*fin != '\0' || fin == argv[n] + 6)
+                return -1;
+        }else if(strncmp(argv[n], "@user=", 6) == 0){
+            char *nom = argv[n] + 6;
+            long uid = strtol(nom, &fin, 10);
+            if(*fin == '\0' && fin != nom){
+                *utilisateur = uid;
+            }else if(strcmp(nom, dernier_nom) == 0){
+                *utilisateur = dernier_uid;
+            }else{
+                struct passwd *pw = getpwnam(nom);
+                if(pw == NULL)
+                    return -1;
+                *utilisateur = dernier_uid = pw->pw_uid;
+                snprintf(dernier_nom, sizeof(dernier_nom), "%s", nom);
+            }
+        }else{
+            return -1;
+        }
+        n++;
+    }
+    // Les arguments de la commande prennent la place des directives
+    int i = 0;
+    do{
+        argv[i] = argv[i + n];
+    }while(argv[i++] != NULL);
+    return 0;
+}
+
+/**
+ * @brief comparer_latences - ordre croissant des latences (percentiles du lot)
+ */
+
+int comparer_latences(const void *a, const void *b){
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief soumettre_lot - soumet sans interaction une commande par ligne du fichier (option --lot) :
+ *                        les gstart partent à tour de rôle vers les serveurs, au plus
+ *                        FENETRE_SOUMISSION attendent une réponse. Un gstart mis en file libère
+ *                        sa place ; un gstart refusé la garde et repart après un délai.
+ *                        On attend que tout soit lancé, puis on arrête le réseau.
+ * 
+ * @param chemin    fichier des commandes, "-" pour l'entrée standard
+ */
+
+void soumettre_lot(const char *chemin){
+    FILE *fichier = strcmp(chemin, "-") == 0 ? stdin : fopen(chemin, "r");
+    char *ligne = NULL;
+    size_t capacite_ligne = 0;
+    ssize_t longueur;
+    char **argv_lot = NULL;
+    int taille_argv_lot = 0;
+    struct enveloppe e;
+    struct timespec debut, fin;
+    int numero_ligne = 0;
+    int nb_soumis = 0;          // gstart envoyés (une fois par ligne)
+    int nb_rejets = 0;          // lignes ignorées car invalides
+
+    if(fichier == NULL){
+        perror(chemin);
+        terminer_reseau();
+        return;
+    }
+    memset(&lot, 0, sizeof(lot));
+    lot.delai_ms = DELAI_REESSAI_MS;
+
+    clock_gettime(CLOCK_MONOTONIC, &debut);
+    while(1){
+        entree_attendre(fichier);
+        if((longueur = getline(&ligne, &capacite_ligne, fichier)) == -1)
+            break;
+        numero_ligne++;
+        if(longueur / 2 + 2 > taille_argv_lot){
+            taille_argv_lot = longueur / 2 + 2;
+            argv_lot = (char **) realloc(argv_lot, taille_argv_lot * sizeof(char *));
+            if(!argv_lot){
+                perror("soumettre_lot");
+                exit(1);
+            }
+        }
+        int argc = decouper_ligne(ligne, argv_lot);
+        if(argc == 0)
+            continue;
+        int priorite = 0;
+        int utilisateur = getuid();
+        if(argc < 0 || lire_directives(argv_lot, &priorite, &utilisateur) == -1 || argv_lot[0] == NULL){
+            fprintf(stderr, "%s:%d : ligne invalide, ignorée\n", chemin, numero_ligne);
+            nb_rejets++;
+            continue;
+        }
+
+        // La fenêtre est pleine : on attend une réponse des serveurs
+        lot_attendre(FENETRE_SOUMISSION - 1);
+
+        memset(&e, 0, sizeof(struct enveloppe));
+        e.tag = TAG_GSTART;
+        e.demandeur = rank;
+        e.numero = numero_ligne;
+        e.priorite = priorite;
+        e.utilisateur = utilisateur;
+        lot.destination = lot.destination % (nb_proc - 1) + 1;
+        if(envoyer_enveloppe_entete(lot.destination, &e, argv_lot) == -1){
+            nb_rejets++;
+            continue;
+        }
+
+        // On garde l'enveloppe tant que le gstart n'est ni lancé ni en file
+        struct soumission *s = lot.en_vol;
+        while(s->numero != 0)
+            s++;
+        s->numero = numero_ligne;
+        s->taille = sizeof(struct enveloppe) + e.taille_argv;
+        s->msg = (char *) malloc(s->taille);
+        if(numero_ligne >= lot.capacite_dates){
+            lot.capacite_dates = 2 * numero_ligne + 1024;
+            lot.dates = (struct timespec *) realloc(lot.dates, lot.capacite_dates * sizeof(struct timespec));
+            lot.latences = (double *) realloc(lot.latences, lot.capacite_dates * sizeof(double));
+        }
+        if(!s->msg || !lot.dates || !lot.latences){
+            perror("soumettre_lot");
+            exit(1);
+        }
+        memcpy(s->msg, tampon_enveloppe, s->taille);
+        clock_gettime(CLOCK_MONOTONIC, &lot.dates[numero_ligne]);
+        lot.nb_en_vol++;
+        nb_soumis++;
+    }
+
+    // Plus rien à soumettre : on attend les réponses, puis le lancement des gstart mis en file
+    lot_attendre(0);
+    while(lot.nb_lances < nb_soumis){
+        if(lot_accuses() == 0){
+            struct timespec pause = {0, ATTENTE_BOUCLE_US * 1000};
+            nanosleep(&pause, NULL);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &fin);
+
+    double duree = (fin.tv_sec - debut.tv_sec) + (fin.tv_nsec - debut.tv_nsec) / 1e9;
+    fprintf(stderr, "lot %s : %d processus lancés en %.3f s (%.0f/s), %d mis en file, %d refus, %d lignes ignorées\n",
+            chemin, lot.nb_lances, duree, duree > 0 ? lot.nb_lances / duree : 0.0, lot.nb_en_file, lot.nb_refus, nb_rejets);
+    if(lot.nb_lances > 0){
+        qsort(lot.latences, lot.nb_lances, sizeof(double), comparer_latences);
+        fprintf(stderr, "lot %s : soumission -> lancement p50 %.1f ms, p99 %.1f ms, max %.1f ms\n", chemin,
+                lot.latences[lot.nb_lances / 2], lot.latences[(int) (lot.nb_lances * 0.99)], lot.latences[lot.nb_lances - 1]);
+    }
+    fflush(stdout);
+
+    if(fichier != stdin)
+        fclose(fichier);
+    free(ligne);
+    free(argv_lot);
+    free(lot.dates);
+    free(lot.latences);
+    terminer_reseau();
+}
+
+/***************************************************************************************************
+                                                MENU
+***************************************************************************************************/
+
+/*
+Fonction qui affiche le menu
+*/
+
+/**
+ * @brief menu - Affichage du menu à l'utilisateur
+ * 
+ */
+
+void menu() {
+    int option;
+    char opt_gstart[50];
+    char quit[50];
+    
+    printf("Projet PSAR - Un répartiteur de charge pour des machines en réseau\n");
+    menu :
+        printf("\n~~~~ Commandes ~~~~\n");
+        printf("0 : Explication des commandes\n");
+        printf("1 : gstart\n");
+        printf("2 : gps [-l]\n");
+        printf("3 : gkill\n");
+        printf("4 : afficher les machines connecté sur le réseau\n");
+        printf("5 : Quitter le MENU\n");
+
+        printf("Entrez une option\n");
+        saisir("%d", &option);
+        printf("option vaut %d\n", option);
+        switch (option){
+            case 0:
+                printf("Explication des commandes : \n");
+                printf("----------------------------------------------------------------------------------------------------------------------------------\n");
+                printf("gstart : \n");
+                printf("\tCrée un processus exécutant “ prog arguments ” sur la machine la moins chargée du réseau.\n");
+                printf("\n\tprog :\n");
+                printf("\t\t0 - date : Affiche la date et l'heure actuelle.\n");
+                printf("\t\t1 - ls [arg] : Liste le contenu du répertoire selon les options préciser dans arg.\n");
+                printf("\t\t2 - ps [-l] : Liste les processus en cours d'exécution dans la machine la moins chargée (format standard ou format long avec -l).\n");
+                printf("\t\t3 - Tâche de X secondes (./test), avec un état de Y Mo transféré si elle migre.\n");
+                printf("\n");
+                printf("----------------------------------------------------------------------------------------------------------------------------------\n");
+                printf("gps : \n");
+                printf("\tSans l'option -l:\n");
+                printf("\t\tAffiche la liste de tous les processus qui ont été lancés sur le réseau.\n");
+                printf("\tAvec l'option -l:\n");
+                printf("\t\tAffiche un format long (noms executable, machine, uid, CPU, mémoire).\n");
+                printf("----------------------------------------------------------------------------------------------------------------------------------\n");
+                printf("gkill -sig gpid... | -g groupe | motif : \n");
+                printf("\tsig : identifiant d'un signal.\n");
+                printf("\tgpid : identifiant global unique sur le réseau d'un processus.\n");
+                printf("\tgroupe : groupe donné aux processus lors du gstart.\n");
+                printf("\tmotif : motif de nom de commande (ex : \"./test*\").\n");
+                printf("----------------------------------------------------------------------------------------------------------------------------------\n");
+
+                printf("\nEntrez une touche pour retourner dans le menu principal.\n");
+                saisir("%s", &quit);
+                goto menu;
+                break;
+                
+            case 1:
+                do{
+                    printf("Vous avez choisi la commande gstart.\n");
+                    printf("Entrer le nom d'une commande ou d'un exécutable que vous voulez exécuter:\n");
+                    printf("~~~~ Commandes ~~~~\n");
+                    printf("1 - date\n");
+                    printf("2 - ls [arg]\n");
+                    printf("3 - ps [-l]\n");
+                    printf("4 - Lancer une tâche de X seconde(s)\n");
+                    printf("5 - Retour au menu\n");
+                    printf("Veuillez entrer une valeur.\n");
+                    saisir("%s",&opt_gstart);
+                    int opt_gstart2 = atoi(opt_gstart);
+                    if( opt_gstart2 == 5) {
+                        goto menu;
+                    }else if( opt_gstart2>= 1 && opt_gstart2< 5){
+                        
+                        test_gstart(opt_gstart2);
+                        // sleep(2);
+                    }else {
+                        printf("Nous n'avons pas compris votre commande.\n");
+                        //sleep(2);
+                    }
+                }while(1);
+                break;
+
+            case 2:
+                printf("Vous avez choisi la commande gps.\n");
+                test_gps();
+                goto menu;
+                break;
+            case 3:
+                printf("Vous avez choisi gkill\n");
+                printf("Pour pouvoir faire gkill, vous devez connaitre les processus existants dans le réseau.\n");
+                test_gkill();
+                goto menu;
+                break;
+
+            case 4:
+                printf("Les machines présentes sur le réseau sont :\n");
+                test_present();
+                goto menu;
+                break;
+            case 5:
+                printf("Vous avez choisi de quitter le MENU\n");
+                printf("Merci et Au revoir :) \n");
+                terminer_reseau();
+                break;
+
+            default:
+                printf("Nous n'avons pas compris votre commande.\nRetour au menu principal.\n");
+                goto menu;
+                break;
+        }
+}
+
+/***************************************************************************************************
+                                                MAIN
+***************************************************************************************************/
+
+int main (int argc, char* argv[]) {  
+    // Initialisation de notre programme
+    Init(argc, argv);
+
+    if(rank == 0){
+        if(fichier_lot != NULL)
+            soumettre_lot(fichier_lot);
+        else
+            menu();
+    }else{
+        receive();
+    }
+
+    // Finalisation de notre programme
+    Final();
+
+    return 0;
+}
+
+
+#else
+
+/***************************************************************************************************
+                                            SIMULATION
+***************************************************************************************************/
+
+/*
+ * Compilé avec -DSIMULATION (gcc seul, sans MPI), le programme simule une grappe entière dans un seul
+ * processus : nb_proc serveurs virtuels exécutent le code des serveurs tel quel (placement, gossip,
+ * file d'attente, contrôleur d'équilibrage, migrations) sur une horloge virtuelle, à événements discrets.
+ *  - messages : envoyer() dépose le message dans la file d'événements avec sa date d'arrivée. L'interface
+ *    de chaque rang sérialise ses envois (taille / --debit) et chaque paire de rangs a une latence fixe
+ *    (--latence plus jusqu'à 50 % tirés de la graine) : les messages d'un émetteur à un destinataire
+ *    arrivent dans l'ordre, comme avec MPI. Un serveur traite ses événements un par un, chaque message
+ *    lui coûte --traitement us ;
+ *  - serveurs : les variables globales d'un serveur (ETAT_RANG) sont rangées dans son rang_simule et
+ *    rechargées quand il traite un événement ;
+ *  - tâches : "test secondes [Mo]" (cf test.c) est une tâche virtuelle qui veut un coeur pendant
+ *    `secondes` ; les tâches d'une machine et sa charge de fond se partagent ses coeurs à parts égales
+ *    (au-delà d'une tâche par coeur, elles ralentissent). Le checkpoint prend 1 ms plus l'écriture de
+ *    l'état au débit du réseau, et le travail restant voyage dans argv[1] ;
+ *  - charge : mesurée toutes les periode_moniteur_ms comme getCharge (utilisation CPU et file d'exécution
+ *    par coeur, moyenne mobile), avec une charge de fond synthétique (--fond) ;
+ *  - charge de travail : le rang 0 soumet --taches gstart accusés à --arrivees par seconde (arrivées de
+ *    Poisson, durées exponentielles de moyenne --duree s), à tour de rôle comme --lot ; --initial=N lance
+ *    en plus N tâches sur le rang 1 à t = 0 (déséquilibre initial).
+ * Les tirages viennent de générateurs initialisés par --graine, la charge de travail a le sien (elle ne
+ * change pas d'une politique à l'autre) : deux exécutions avec les mêmes options écrivent exactement la
+ * même sortie standard. Ce qui dépend de la machine (durée réelle, coût de traitement des messages par
+ * TAG) est écrit sur la sortie d'erreur.
+ */
+
+#define EV_MESSAGE          0   // Arrivée d'un message
+#define EV_MESURE           1   // Mesure de la charge d'un serveur
+#define EV_FIN_TACHE        2   // Fin de la prochaine tâche d'une machine
+#define EV_CHECKPOINT       3   // Une tâche a écrit son checkpoint
+#define EV_SOUMISSION       4   // Le rang 0 soumet un gstart
+#define EV_RAPPORT          5   // Ligne d'état périodique
+
+#define FOND_AUCUN          0   // Pas de charge de fond
+#define FOND_SINUS          1   // De 0 à un demi-coeur par coeur, sur une période de PERIODE_FOND_MS déphasée par machine
+#define FOND_PICS           2   // Une machine sur 10 est occupée à 100 % pendant DUREE_PIC_MS, à une date tirée au hasard
+#define PERIODE_FOND_MS     60000
+#define DUREE_PIC_MS        30000
+#define FENETRE_RETOUR_MS   10000   // Une tâche renvoyée à sa provenance avant ce délai compte comme un aller-retour
+#define VERSIONS_SUIVIES    64      // Dernières versions de la charge de chaque serveur dont on suit la propagation
+
+/* Variables globales propres à chaque serveur, sauvées et rechargées par rang_activer */
+
+#define ETAT_RANG(X)    X(rank) X(cpt_gpid) X(epoque_gpid) X(tab_charge) X(tab_version) X(tour_gossip) X(charge_globale) \
+                        X(tab_participe) X(epoque_vue) X(tab_en_attente) X(version_en_attente) X(nb_migrations) X(process) X(process_capacite) \
+                        X(process_libre) X(annuaire) X(renvois) X(controleur) X(file_attente) X(amorcage)
+
+#define CHAMP_ETAT(nom)     __typeof__(nom) nom;
+#define SAUVER_ETAT(nom)    r->etat.nom = nom;
+#define CHARGER_ETAT(nom)   nom = r->etat.nom;
+
+struct etat_rang{
+    ETAT_RANG(CHAMP_ETAT)
+};
+
+struct evenement{
+    double date;                // Date en ms
+    uint64_t numero;            // Ordre de création, départage les événements de même date (gardé si l'événement est retardé)
+    int type;                   // EV_*
+    int rang;                   // Rang qui traite l'événement
+    int source;                 // EV_MESSAGE : émetteur ; EV_SOUMISSION : 1 pour une resoumission
+    int tag;                    // EV_MESSAGE : TAG
+    int taille;                 // EV_MESSAGE : taille du message
+    int indice;                 // EV_CHECKPOINT : case de la table process ; EV_SOUMISSION : numéro de la tâche
+    int pid;                    // EV_CHECKPOINT : pid virtuel de la tâche ; EV_FIN_TACHE : version du tas des fins
+    char *donnees;              // EV_MESSAGE : copie du message
+};
+
+struct fin_tache{
+    double travail;             // Valeur de travail à laquelle la tâche se termine
+    int indice;                 // Case de la tâche dans la table process
+    int pid;                    // pid virtuel (l'entrée est périmée si la case n'a plus ce pid)
+};
+
+struct rang_simule{
+    struct etat_rang etat;      // Variables globales du serveur pendant qu'un autre rang est actif
+    int coeurs;                 // Coeurs de la machine
+    double libre_ms;            // Date à laquelle le serveur aura fini de traiter son dernier message
+    double envoi_libre_ms;      // Date à laquelle son interface aura fini d'envoyer
+    double travail;             // Travail (en s de coeur) reçu par chacune de ses tâches depuis le début
+    double date_travail;        // Date de la dernière mise à jour de travail
+    int nb_taches;              // Tâches qui s'exécutent, checkpoint en cours compris
+    double fond;                // Charge de fond en tâches équivalentes
+    double phase;               // Déphasage de la charge de fond (FOND_SINUS), début du pic ou -1 (FOND_PICS)
+    float charge;               // Moyenne mobile des charges mesurées
+    int nb_mesures;             // Nombre de mesures
+    struct fin_tache *fins;     // Tas des tâches par travail de fin croissant (entrées périmées comprises)
+    int nb_fins;
+    int capacite_fins;
+    unsigned int version_fins;  // Version de la dernière EV_FIN_TACHE programmée (les autres sont périmées)
+};
+
+struct tache_simulee{
+    double duree;               // Durée nominale en s (sur un coeur libre)
+    double soumission_ms;       // Date de soumission
+    double lancement_ms;        // Date du premier lancement (-1 : pas encore lancée)
+    double fin_ms;              // Date de fin (-1 : pas encore terminée)
+    int provenance;             // Serveur qu'elle a quitté lors de sa dernière migration (-1 : aucune)
+    double arrivee_ms;          // Date de sa relance après cette migration
+};
+
+struct{
+    struct rang_simule *rangs;
+    int actif;                  // Rang dont les variables globales sont chargées (-1 : aucun)
+    double maintenant;          // Horloge virtuelle en ms
+    struct evenement *evenements;   // Tas des événements par (date, numero)
+    int nb_evenements;
+    int capacite_evenements;
+    uint64_t numero;            // Dernier numéro d'événement attribué
+    uint64_t nb_traites;        // Événements traités
+    int dernier_pid;            // Dernier pid virtuel attribué
+
+    uint64_t graine;            // --graine
+    int nb_taches;              // --taches
+    double arrivees;            // --arrivees (gstart par seconde)
+    double duree_s;             // --duree
+    double etat_mo;             // --etat (Mo d'état par tâche, écrits au checkpoint)
+    int initial;                // --initial
+    int inactifs;               // --inactifs
+    int coeurs_min, coeurs_max; // --coeurs=min[-max]
+    double latence_ms;          // --latence
+    double debit_mo_s;          // --debit
+    double traitement_ms;       // --traitement
+    double rapport_ms;          // --rapport
+    double fin_ms;              // --fin
+    int fond;                   // --fond : FOND_AUCUN, FOND_SINUS ou FOND_PICS
+
+    struct tache_simulee *taches;   // --taches soumises, puis les --initial
+    int nb_total;               // nb_taches + initial
+    int nb_finies;
+    int destination;            // Dernier serveur qui a reçu un gstart (tour de rôle)
+    long long en_file;          // Accusés ACCUSE_EN_FILE
+    long long refus;            // Accusés ACCUSE_REFUSE
+    long long retours;          // Tâches renvoyées à leur provenance moins de FENETRE_RETOUR_MS après leur arrivée
+
+    int nb_rapports;            // Lignes d'état
+    double somme_desequilibre;  // Somme des déséquilibres (utilisation max / moyenne) des lignes d'état
+    double desequilibre_max;
+    double dernier_desequilibre_ms; // Dernière ligne d'état au-dessus de SURCHARGE_POURCENT (-1 : aucune)
+    double dernier_rapport_ms;  // Dernière ligne d'état retenue
+
+    // Propagation des charges : VERSIONS_SUIVIES cases par serveur, indicées par version % VERSIONS_SUIVIES
+    int *versions;              // Dernière version de la charge de chaque serveur
+    double *dates_versions;     // Date de la mesure qui a créé la version
+    int *vues_versions;         // Serveurs qui connaissent la version, ou une plus récente
+    int *attendus_versions;     // Participants autres que son serveur à sa création (-1 : serveur hors du réseau)
+    int *versions_avant;        // Versions connues par le serveur qui reçoit un TAG_CHARGE, avant la fusion
+    long long mesures;          // Mesures de charge de tous les serveurs
+    long long versions_propagees;   // Versions suivies connues de tous les participants
+    long long versions_creees;      // Versions créées par un participant
+    struct histogramme age_charges;         // Âge de la charge la plus récente d'un TAG_CHARGE fusionné (ns simulées)
+    struct histogramme propagation_charges; // Délai avant que tous les participants connaissent une version (ns simulées)
+}sim;
+
+const char* noms_placement[] = {"min", "deux-choix", "pondere"};
+const char* noms_fond[] = {"aucun", "sinus", "pics"};
+
+/**
+ * @brief alea - générateur splitmix64 : une suite par état, entièrement déterminée par la graine
+ */
+
+static inline uint64_t alea(uint64_t *etat){
+    uint64_t z = (*etat += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static inline double alea_uniforme(uint64_t *etat){
+    return (alea(etat) >> 11) * 0x1.0p-53;
+}
+
+/**
+ * @brief maintenant_ms - horloge virtuelle du simulateur
+ */
+
+double maintenant_ms(){
+    return sim.maintenant;
+}
+
+/**
+ * @brief evenement_avant - ordre de la file d'événements : date puis ordre de création
+ */
+
+static inline int evenement_avant(const struct evenement *a, const struct evenement *b){
+    return a->date < b->date || (a->date == b->date && a->numero < b->numero);
+}
+
+/**
+ * @brief evenement_planifier - ajoute un événement à la file (tas binaire)
+ * 
+ * @param e         événement ; un numéro lui est attribué s'il n'en a pas encore
+ */
+
+void evenement_planifier(struct evenement e){
+    if(e.numero == 0)
+        e.numero = ++sim.numero;
+    if(sim.nb_evenements == sim.capacite_evenements){
+        sim.capacite_evenements = sim.capacite_evenements ? 2 * sim.capacite_evenements : 1024;
+        sim.evenements = (struct evenement *) realloc(sim.evenements, sim.capacite_evenements * sizeof(struct evenement));
+        if(!sim.evenements){
+            perror("evenement_planifier");
+            exit(1);
+        }
+    }
+    int i = sim.nb_evenements++;
+    while(i > 0 && evenement_avant(&e, &sim.evenements[(i - 1) / 2])){
+        sim.evenements[i] = sim.evenements[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    sim.evenements[i] = e;
+}
+
+/**
+ * @brief evenement_retirer - retire le prochain événement de la file
+ * 
+ * @param e         événement retiré
+ * @return int      1 si un événement a été retiré, 0 si la file est vide
+ */
+
+int evenement_retirer(struct evenement *e){
+    if(sim.nb_evenements == 0)
+        return 0;
+    *e = sim.evenements[0];
+    struct evenement dernier = sim.evenements[--sim.nb_evenements];
+    int i = 0;
+    while(2 * i + 1 < sim.nb_evenements){
+        int fils = 2 * i + 1;
+        if(fils + 1 < sim.nb_evenements && evenement_avant(&sim.evenements[fils + 1], &sim.evenements[fils]))
+            fils++;
+        if(!evenement_avant(&sim.evenements[fils], &dernier))
+            break;
+        sim.evenements[i] = sim.evenements[fils];
+        i = fils;
+    }
+    if(sim.nb_evenements > 0)
+        sim.evenements[i] = dernier;
+    return 1;
+}
+
+/**
+ * @brief rang_activer - charge les variables globales du serveur i (et sauve celles du serveur actif)
+ * 
+ * @param i         rang à activer
+ */
+
+void rang_activer(int i){
+    struct rang_simule *r;
+
+    if(sim.actif == i)
+        return;
+    if(sim.actif >= 0){
+        r = &sim.rangs[sim.actif];
+        ETAT_RANG(SAUVER_ETAT)
+    }
+    r = &sim.rangs[i];
+    ETAT_RANG(CHARGER_ETAT)
+    echantillonneur.coeurs = r->coeurs;
+    sim.actif = i;
+    if(niveau_log > LOG_ERREUR)
+        snprintf(hostname, sizeof(hostname), "sim-%d", i);
+}
+
+/**
+ * @brief envoyer - remet un message au simulateur : il arrive après la sérialisation sur l'interface
+ *                  de l'émetteur et la latence de la paire
+ * 
+ * @param donnees       données à envoyer (copiées)
+ * @param taille        taille des données en octets
+ * @param destination   rang du destinataire
+ * @param tag           TAG du message
+ */
+
+void envoyer(const void *donnees, int taille, int destination, int tag){
+    struct rang_simule *r = &sim.rangs[rank];
+
+    if(destination < 0 || destination >= nb_proc){
+        JOURNAL(LOG_ERREUR, "%s : message %d pour le rang %d inexistant\n", hostname, tag, destination);
+        return;
+    }
+    char *copie = (char *) malloc(taille > 0 ? taille : 1);
+    if(!copie){
+        perror("envoyer");
+        exit(1);
+    }
+    memcpy(copie, donnees, taille);
+
+    // Latence propre à la paire : fixe, pour que les messages d'un émetteur à un destinataire restent dans l'ordre
+    uint64_t paire = sim.graine ^ ((uint64_t) (rank < destination ? rank : destination) << 32 | (rank < destination ? destination : rank));
+    double latence = sim.latence_ms * (1 + 0.5 * alea_uniforme(&paire));
+    double depart = r->envoi_libre_ms > sim.maintenant ? r->envoi_libre_ms : sim.maintenant;
+    r->envoi_libre_ms = depart + taille / (sim.debit_mo_s * 1e3);
+
+    evenement_planifier((struct evenement){.date = r->envoi_libre_ms + latence, .type = EV_MESSAGE, .rang = destination,
+                                           .source = rank, .tag = tag, .taille = taille, .donnees = copie});
+    metrique_envoi(tag, taille);
+}
+
+/**
+ * @brief taux_travail - travail reçu par chaque tâche d'une machine par seconde : les tâches et la charge
+ *                       de fond se partagent les coeurs à parts égales
+ */
+
+static inline double taux_travail(const struct rang_simule *r){
+    double total = r->nb_taches + r->fond;
+    return total <= r->coeurs ? 1.0 : r->coeurs / total;
+}
+
+/**
+ * @brief travail_avancer - ajoute à travail ce que chaque tâche a reçu depuis la dernière mise à jour
+ *                          (à appeler avant de changer le nombre de tâches ou la charge de fond)
+ */
+
+void travail_avancer(struct rang_simule *r){
+    r->travail += taux_travail(r) * (sim.maintenant - r->date_travail) / 1e3;
+    r->date_travail = sim.maintenant;
+}
+
+/**
+ * @brief fin_avant - ordre du tas des fins : travail de fin croissant, puis pid
+ */
+
+static inline int fin_avant(const struct fin_tache *a, const struct fin_tache *b){
+    return a->travail < b->travail || (a->travail == b->travail && a->pid < b->pid);
+}
+
+void fins_ajouter(struct rang_simule *r, struct fin_tache f){
+    if(r->nb_fins == r->capacite_fins){
+        r->capacite_fins = r->capacite_fins ? 2 * r->capacite_fins : 16;
+        r->fins = (struct fin_tache *) realloc(r->fins, r->capacite_fins * sizeof(struct fin_tache));
+        if(!r->fins){
+            perror("fins_ajouter");
+            exit(1);
+        }
+    }
+    int i = r->nb_fins++;
+    while(i > 0 && fin_avant(&f, &r->fins[(i - 1) / 2])){
+        r->fins[i] = r->fins[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    r->fins[i] = f;
+}
+
+void fins_retirer(struct rang_simule *r){
+    struct fin_tache dernier = r->fins[--r->nb_fins];
+    int i = 0;
+    while(2 * i + 1 < r->nb_fins){
+        int fils = 2 * i + 1;
+        if(fils + 1 < r->nb_fins && fin_avant(&r->fins[fils + 1], &r->fins[fils]))
+            fils++;
+        if(!fin_avant(&r->fins[fils], &dernier))
+            break;
+        r->fins[i] = r->fins[fils];
+        i = fils;
+    }
+    if(r->nb_fins > 0)
+        r->fins[i] = dernier;
+}
+
+/**
+ * @brief fins_planifier - programme la fin de la prochaine tâche du rang actif, au taux de travail actuel
+ *                         (les EV_FIN_TACHE programmées avant deviennent périmées)
+ */
+
+void fins_planifier(){
+    struct rang_simule *r = &sim.rangs[rank];
+
+    // Les tâches parties ou terminées en tête du tas sont écartées
+    while(r->nb_fins > 0 && process[r->fins[0].indice].pid != r->fins[0].pid)
+        fins_retirer(r);
+    r->version_fins++;
+    if(r->nb_fins == 0)
+        return;
+    double reste = r->fins[0].travail - r->travail;
+    evenement_planifier((struct evenement){.date = sim.maintenant + (reste > 0 ? reste : 0) / taux_travail(r) * 1e3,
+                                           .type = EV_FIN_TACHE, .rang = rank, .pid = (int) r->version_fins});
+}
+
+/**
+ * @brief lancer_processus - lance la tâche virtuelle de la case indice_process : "commande secondes [Mo] [numéro]"
+ *                           (sans argv[1] la tâche se termine aussitôt)
+ * 
+ * @param indice_process    indice du processus dans la table process
+ * @param restauration      non utilisé : l'état d'une tâche migrée est dans argv[1]
+ * @return int              0
+ */
+
+int lancer_processus(int indice_process, const char *restauration){
+    struct rang_simule *r = &sim.rangs[rank];
+    struct process *p = &process[indice_process];
+    double duree = p->argv[1] != NULL ? atof(p->argv[1]) : 0;
+
+    (void) restauration;
+    p->debut.tv_sec = (time_t) (sim.maintenant / 1e3);
+    p->debut.tv_nsec = (long) ((sim.maintenant - p->debut.tv_sec * 1e3) * 1e6);
+    p->etat = ETAT_ACTIF;
+    p->pid = ++sim.dernier_pid;
+
+    // Le numéro de la tâche simulée suit la commande (argv[3])
+    if(p->argv[1] != NULL && p->argv[2] != NULL && p->argv[3] != NULL){
+        int numero = atoi(p->argv[3]);
+        if(numero >= 0 && numero < sim.nb_total){
+            struct tache_simulee *t = &sim.taches[numero];
+            if(t->lancement_ms < 0)
+                t->lancement_ms = sim.maintenant;
+            else
+                t->arrivee_ms = sim.maintenant;
+        }
+    }
+
+    travail_avancer(r);
+    fins_ajouter(r, (struct fin_tache){r->travail + (duree > 0 ? duree : 0), indice_process, p->pid});
+    r->nb_taches++;
+    fins_planifier();
+    return 0;
+}
+
+/**
+ * @brief signaler_processus - seul SIGNAL_CHECKPOINT est simulé : la tâche écrit son état (1 ms plus
+ *                             argv[2] Mo au débit du réseau) puis se termine (EV_CHECKPOINT)
+ * 
+ * @param indice_process    indice du processus dans la table process
+ * @param signal            numéro du signal
+ * @return int              0, ou -1 (ENOTSUP) pour un autre signal
+ */
+
+int signaler_processus(int indice_process, int signal){
+    struct process *p = &process[indice_process];
+
+    if(signal != SIGNAL_CHECKPOINT){
+        errno = ENOTSUP;
+        return -1;
+    }
+    double etat_mo = p->argv[1] != NULL && p->argv[2] != NULL ? atof(p->argv[2]) : 0;
+    evenement_planifier((struct evenement){.date = sim.maintenant + 1 + etat_mo / sim.debit_mo_s * 1e3, .type = EV_CHECKPOINT,
+                                           .rang = rank, .indice = indice_process, .pid = p->pid});
+    return 0;
+}
+
+/**
+ * @brief simulation_checkpoint - la tâche a écrit son état : le travail qui lui reste remplace argv[1],
+ *                                puis elle se termine « tuée par SIGNAL_CHECKPOINT » (relancée ailleurs
+ *                                sans fichier de checkpoint)
+ * 
+ * @param indice    case de la tâche dans la table process
+ * @param pid       pid virtuel de la tâche
+ */
+
+void simulation_checkpoint(int indice, int pid){
+    struct rang_simule *r = &sim.rangs[rank];
+    char reste[32];
+
+    // La tâche s'est terminée avant d'écrire son état
+    if(process[indice].pid != pid || process[indice].etat != ETAT_CHECKPOINT)
+        return;
+
+    travail_avancer(r);
+    for(int k = 0; k < r->nb_fins; k++){
+        if(r->fins[k].pid == pid){
+            snprintf(reste, sizeof(reste), "%.6f", r->fins[k].travail > r->travail ? r->fins[k].travail - r->travail : 0);
+            if(process[indice].argv[1] != NULL){
+                free(process[indice].argv[1]);
+                process[indice].argv[1] = strdup(reste);
+            }
+            break;
+        }
+    }
+    if(process[indice].argv[1] != NULL && process[indice].argv[2] != NULL && process[indice].argv[3] != NULL){
+        int numero = atoi(process[indice].argv[3]);
+        if(numero >= 0 && numero < sim.nb_total){
+            struct tache_simulee *t = &sim.taches[numero];
+            if(t->provenance == process[indice].cible && sim.maintenant - t->arrivee_ms < FENETRE_RETOUR_MS)
+                sim.retours++;
+            t->provenance = rank;
+        }
+    }
+    r->nb_taches--;
+    processus_fini(indice, W_EXITCODE(0, SIGNAL_CHECKPOINT));
+    fins_planifier();
+}
+
+/**
+ * @brief simulation_fins - les tâches du rang actif dont le travail est fait se terminent
+ * 
+ * @param version   version du tas des fins quand l'événement a été programmé
+ */
+
+void simulation_fins(int version){
+    struct rang_simule *r = &sim.rangs[rank];
+    int nb_termines = 0;
+
+    if((unsigned int) version != r->version_fins)
+        return;
+    travail_avancer(r);
+    while(r->nb_fins > 0 && r->fins[0].travail <= r->travail + 1e-9){
+        struct fin_tache f = r->fins[0];
+        fins_retirer(r);
+        if(process[f.indice].pid != f.pid)
+            continue;
+        char **argv = process[f.indice].argv;
+        if(argv[1] != NULL && argv[2] != NULL && argv[3] != NULL){
+            int numero = atoi(argv[3]);
+            if(numero >= 0 && numero < sim.nb_total && sim.taches[numero].fin_ms < 0){
+                sim.taches[numero].fin_ms = sim.maintenant;
+                sim.nb_finies++;
+            }
+        }
+        r->nb_taches--;
+        nb_termines += processus_fini(f.indice, W_EXITCODE(0, 0));
+    }
+    corriger_charge(nb_termines);
+    fins_planifier();
+}
+
+/**
+ * @brief fond_simule - charge de fond d'une machine à une date, en tâches équivalentes
+ */
+
+double fond_simule(const struct rang_simule *r, double date){
+    switch(sim.fond){
+        case FOND_SINUS:
+            return r->coeurs * 0.25 * (1 + sin(2 * M_PI * date / PERIODE_FOND_MS + r->phase));
+        case FOND_PICS:
+            return (r->phase >= 0 && date >= r->phase && date < r->phase + DUREE_PIC_MS) ? r->coeurs : 0;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief simulation_mesure - mesure de la charge du rang actif, calculée comme getCharge : utilisation CPU
+ *                            et file d'exécution par coeur (tâches et charge de fond), moyenne mobile
+ */
+
+void simulation_mesure(){
+    struct rang_simule *r = &sim.rangs[rank];
+
+    travail_avancer(r);
+    double fond = fond_simule(r, sim.maintenant);
+    if(fond != r->fond){
+        r->fond = fond;
+        fins_planifier();
+    }
+    double total = r->nb_taches + r->fond;
+    float brute = POIDS_CPU * (total < r->coeurs ? total : r->coeurs) / r->coeurs + POIDS_FILE * total / r->coeurs;
+    r->charge = (r->nb_mesures++ == 0) ? brute : ALPHA_CHARGE * brute + (1.0 - ALPHA_CHARGE) * r->charge;
+    nouvelle_mesure(r->charge);
+    evenement_planifier((struct evenement){.date = sim.maintenant + periode_moniteur_ms, .type = EV_MESURE, .rang = rank});
+
+    // Nouvelle version de notre charge : on suit sa propagation aux autres participants
+    int c = rank * VERSIONS_SUIVIES + tab_version[rank] % VERSIONS_SUIVIES;
+    sim.mesures++;
+    sim.versions[rank] = tab_version[rank];
+    sim.dates_versions[c] = sim.maintenant;
+    sim.vues_versions[c] = 0;
+    sim.attendus_versions[c] = -1;
+    if(tab_participe[rank]){
+        sim.attendus_versions[c] = 0;
+        for(int i = 1; i < nb_proc; i++)
+            sim.attendus_versions[c] += (i != rank && tab_participe[i]);
+        sim.versions_creees++;
+    }
+}
+
+/**
+ * @brief simulation_charges_recues - après la fusion d'un TAG_CHARGE, compte les versions que le serveur
+ *                                    vient d'apprendre (sim.versions_avant : ce qu'il connaissait avant)
+ */
+
+void simulation_charges_recues(){
+    for(int i = 1; i < nb_proc; i++){
+        if(i == rank || tab_version[i] <= sim.versions_avant[i])
+            continue;
+        int premiere = sim.versions_avant[i] + 1;
+        if(premiere <= sim.versions[i] - VERSIONS_SUIVIES)
+            premiere = sim.versions[i] - VERSIONS_SUIVIES + 1;
+        for(int v = premiere; v <= tab_version[i]; v++){
+            int c = i * VERSIONS_SUIVIES + v % VERSIONS_SUIVIES;
+            uint64_t age_ns = (uint64_t) ((sim.maintenant - sim.dates_versions[c]) * 1e6);
+            if(v == tab_version[i])
+                histo_ajouter(&sim.age_charges, age_ns);
+            if(sim.attendus_versions[c] > 0 && ++sim.vues_versions[c] == sim.attendus_versions[c]){
+                histo_ajouter(&sim.propagation_charges, age_ns);
+                sim.versions_propagees++;
+            }
+        }
+    }
+}
+
+/**
+ * @brief simulation_soumettre - le rang 0 soumet la tâche k (gstart accusé, à tour de rôle comme --lot)
+ *                               et programme la soumission suivante
+ * 
+ * @param k             numéro de la tâche
+ * @param resoumission  1 si la tâche a été refusée et repart
+ */
+
+void simulation_soumettre(int k, int resoumission){
+    char duree[32], etat[32], numero[16];
+    char *argv[] = {"test", duree, etat, numero, NULL};
+    struct enveloppe e;
+
+    snprintf(duree, sizeof(duree), "%.6f", sim.taches[k].duree);
+    snprintf(etat, sizeof(etat), "%.3f", sim.etat_mo);
+    snprintf(numero, sizeof(numero), "%d", k);
+    memset(&e, 0, sizeof(struct enveloppe));
+    e.tag = TAG_GSTART;
+    e.demandeur = 0;
+    e.numero = k + 1;
+    sim.destination = sim.destination % (nb_proc - 1) + 1;
+    envoyer_enveloppe_entete(sim.destination, &e, argv);
+
+    if(!resoumission && k + 1 < sim.nb_taches)
+        evenement_planifier((struct evenement){.date = sim.taches[k + 1].soumission_ms, .type = EV_SOUMISSION, .indice = k + 1});
+}
+
+/**
+ * @brief simulation_accuse - le rang 0 reçoit un TAG_GSTART_ACK : un refus repart après DELAI_REESSAI_MS
+ */
+
+void simulation_accuse(const char *msg){
+    struct accuse_gstart accuse;
+
+    memcpy(&accuse, msg, sizeof(struct accuse_gstart));
+    if(accuse.etat == ACCUSE_REFUSE){
+        sim.refus++;
+        evenement_planifier((struct evenement){.date = sim.maintenant + DELAI_REESSAI_MS, .type = EV_SOUMISSION,
+                                               .source = 1, .indice = accuse.numero - 1});
+    }else if(accuse.etat == ACCUSE_EN_FILE){
+        sim.en_file++;
+    }
+}
+
+/**
+ * @brief simulation_rapport - ligne d'état : tâches, files d'attente et utilisation des coeurs des participants
+ *                             ((tâches + fond) / coeurs), dont le déséquilibre (maximum / moyenne), retenu
+ *                             pour le résumé quand il y a au moins une tâche par participant
+ */
+
+void simulation_rapport(){
+    int participants = 0, taches = 0, en_file = 0;
+    double somme = 0, somme_carres = 0, max = 0;
+    uint64_t messages = 0;
+
+    rang_activer(0);    // sauve les variables du dernier serveur actif dans son rang_simule
+    for(int i = 1; i < nb_proc; i++){
+        struct rang_simule *r = &sim.rangs[i];
+        taches += r->nb_taches;
+        en_file += r->etat.file_attente.nb;
+        if(!r->etat.tab_participe[i])
+            continue;
+        double utilisation = (r->nb_taches + fond_simule(r, sim.maintenant)) / r->coeurs;
+        participants++;
+        somme += utilisation;
+        somme_carres += utilisation * utilisation;
+        if(utilisation > max)
+            max = utilisation;
+    }
+    for(int t = 0; t < NB_TAGS; t++)
+        messages += metriques.messages_envoyes[t];
+
+    double moyenne = participants ? somme / participants : 0;
+    double ecart_type = participants ? sqrt(fmax(somme_carres / participants - moyenne * moyenne, 0)) : 0;
+    double desequilibre = moyenne > 0 ? max / moyenne : 1;
+    // Avec moins d'une tâche par machine, le déséquilibre ne dit rien du placement
+    if(taches >= participants){
+        sim.nb_rapports++;
+        sim.somme_desequilibre += desequilibre;
+        if(desequilibre > sim.desequilibre_max)
+            sim.desequilibre_max = desequilibre;
+        if(desequilibre > SURCHARGE_POURCENT / 100.0)
+            sim.dernier_desequilibre_ms = sim.maintenant;
+        sim.dernier_rapport_ms = sim.maintenant;
+    }
+
+    printf("%9.1f s  tâches %7d  en file %6d  participants %5d  utilisation moy %5.2f max %5.2f cv %4.2f  messages %llu\n",
+           sim.maintenant / 1e3, taches, en_file, participants, moyenne, max, moyenne > 0 ? ecart_type / moyenne : 0,
+           (unsigned long long) messages);
+    evenement_planifier((struct evenement){.date = sim.maintenant + sim.rapport_ms, .type = EV_RAPPORT});
+}
+
+/**
+ * @brief simulation_lire_options - options du simulateur (les options des serveurs sont lues par lire_options)
+ *                                  --rangs=N               rangs simulés, rang 0 (soumission) compris
+ *                                  --graine=N              graine de tous les tirages
+ *                                  --taches=N              gstart soumis par le rang 0
+ *                                  --arrivees=N            gstart soumis par seconde
+ *                                  --duree=s               durée moyenne d'une tâche
+ *                                  --etat=Mo               état de chaque tâche, écrit à chaque checkpoint
+ *                                  --initial=N             tâches lancées sur le rang 1 à t = 0
+ *                                  --inactifs=N            les N derniers rangs sont hors du réseau au départ
+ *                                  --coeurs=min[-max]      coeurs de chaque machine (tirés entre min et max)
+ *                                  --fond=aucun|sinus|pics charge de fond des machines
+ *                                  --latence=us            latence de base d'un message
+ *                                  --debit=Mo/s            débit de l'interface de chaque rang
+ *                                  --traitement=us         coût de traitement d'un message par un serveur
+ *                                  --rapport=ms            période des lignes d'état
+ *                                  --fin=s                 date simulée maximale
+ * 
+ * @param argc      nombre de paramètres
+ * @param argv      arguments
+ */
+
+void simulation_lire_options(int argc, char* argv[]){
+    nb_proc = SIM_RANGS;
+    sim.graine = 1;
+    sim.nb_taches = SIM_TACHES;
+    sim.arrivees = SIM_ARRIVEES;
+    sim.duree_s = SIM_DUREE_S;
+    sim.coeurs_min = sim.coeurs_max = SIM_COEURS;
+    sim.latence_ms = SIM_LATENCE_US / 1e3;
+    sim.debit_mo_s = SIM_DEBIT_MO_S;
+    sim.traitement_ms = SIM_TRAITEMENT_US / 1e3;
+    sim.rapport_ms = SIM_RAPPORT_MS;
+    sim.fin_ms = SIM_FIN_S * 1e3;
+
+    for(int i = 1; i < argc; i++){
+        if(strncmp(argv[i], "--rangs=", 8) == 0)
+            nb_proc = atoi(argv[i] + 8);
+        else if(strncmp(argv[i], "--graine=", 9) == 0)
+            sim.graine = strtoull(argv[i] + 9, NULL, 10);
+        else if(strncmp(argv[i], "--taches=", 9) == 0)
+            sim.nb_taches = atoi(argv[i] + 9);
+        else if(strncmp(argv[i], "--arrivees=", 11) == 0)
+            sim.arrivees = atof(argv[i] + 11);
+        else if(strncmp(argv[i], "--duree=", 8) == 0)
+            sim.duree_s = atof(argv[i] + 8);
+        else if(strncmp(argv[i], "--etat=", 7) == 0)
+            sim.etat_mo = atof(argv[i] + 7);
+        else if(strncmp(argv[i], "--initial=", 10) == 0)
+            sim.initial = atoi(argv[i] + 10);
+        else if(strncmp(argv[i], "--inactifs=", 11) == 0)
+            sim.inactifs = atoi(argv[i] + 11);
+        else if(strncmp(argv[i], "--coeurs=", 9) == 0){
+            char *fin;
+            sim.coeurs_min = sim.coeurs_max = strtol(argv[i] + 9, &fin, 10);
+            if(*fin == '-')
+                sim.coeurs_max = atoi(fin + 1);
+        }else if(strncmp(argv[i], "--fond=", 7) == 0){
+            char *nom = argv[i] + 7;
+            for(sim.fond = FOND_PICS; sim.fond > FOND_AUCUN && strcmp(nom, noms_fond[sim.fond]) != 0; sim.fond--)
+                ;
+        }else if(strncmp(argv[i], "--latence=", 10) == 0)
+            sim.latence_ms = atof(argv[i] + 10) / 1e3;
+        else if(strncmp(argv[i], "--debit=", 8) == 0)
+            sim.debit_mo_s = atof(argv[i] + 8);
+        else if(strncmp(argv[i], "--traitement=", 13) == 0)
+            sim.traitement_ms = atof(argv[i] + 13) / 1e3;
+        else if(strncmp(argv[i], "--rapport=", 10) == 0)
+            sim.rapport_ms = atof(argv[i] + 10);
+        else if(strncmp(argv[i], "--fin=", 6) == 0)
+            sim.fin_ms = atof(argv[i] + 6) * 1e3;
+    }
+    if(nb_proc < 2 || sim.nb_taches < 0 || sim.initial < 0 || sim.inactifs < 0 || sim.inactifs > nb_proc - 2 || sim.arrivees <= 0 || sim.duree_s < 0 || sim.coeurs_min < 1
+       || sim.coeurs_max < sim.coeurs_min || sim.debit_mo_s <= 0 || sim.latence_ms < 0 || sim.traitement_ms < 0 || sim.rapport_ms <= 0){
+        printf("Options de simulation invalides (il faut au moins 2 rangs)\n");
+        exit(2);
+    }
+}
+
+/**
+ * @brief simulation_init - crée les serveurs virtuels (comme Init), tire la charge de travail
+ *                          et programme les premiers événements
+ * 
+ */
+
+void simulation_init(){
+    uint64_t alea_machines = sim.graine * 3 + 1;     // coeurs, phases des mesures et charge de fond
+    uint64_t alea_travail = sim.graine * 3 + 2;      // arrivées et durées des tâches
+
+    snprintf(hostname, sizeof(hostname), "sim");
+    nb_max = nb_proc;                                // Pas de serveur créé en cours de route (--elastique)
+    sim.actif = -1;
+    sim.dernier_desequilibre_ms = -1;
+    sim.rangs = (struct rang_simule *) calloc(nb_proc, sizeof(struct rang_simule));
+    tampon_gossip = (struct charge_versionnee *) malloc(nb_proc * sizeof(struct charge_versionnee));
+    // Chaque serveur virtuel est seul sur son noeud ; un seul fil d'exécution : les séquences peuvent être communes
+    tab_chef = (int *) malloc(nb_proc * sizeof(int));
+    tab_sequence = (atomic_uint *) calloc(nb_proc, sizeof(atomic_uint));
+    sim.nb_total = sim.nb_taches + sim.initial;
+    sim.taches = (struct tache_simulee *) malloc((sim.nb_total + 1) * sizeof(struct tache_simulee));
+    sim.versions = (int *) calloc(nb_proc, sizeof(int));
+    sim.dates_versions = (double *) calloc(nb_proc * VERSIONS_SUIVIES, sizeof(double));
+    sim.vues_versions = (int *) calloc(nb_proc * VERSIONS_SUIVIES, sizeof(int));
+    sim.attendus_versions = (int *) calloc(nb_proc * VERSIONS_SUIVIES, sizeof(int));
+    sim.versions_avant = (int *) calloc(nb_proc, sizeof(int));
+    if(!sim.rangs || !tampon_gossip || !tab_chef || !tab_sequence || !sim.taches || !sim.versions || !sim.dates_versions
+       || !sim.vues_versions || !sim.attendus_versions || !sim.versions_avant){
+        perror("simulation_init");
+        exit(1);
+    }
+
+    for(int i = 0; i < nb_proc; i++){
+        struct rang_simule *r = &sim.rangs[i];
+
+        // Les variables globales du serveur i, initialisées comme par Init, puis rangées dans son rang_simule
+        rank = i;
+        cpt_gpid = 1;
+        epoque_gpid = 0;
+        epoque_vue = 0;
+        tour_gossip = 0;
+        charge_globale = 0;
+        nb_migrations = 0;
+        process = NULL;
+        process_capacite = 0;
+        process_libre = -1;
+        memset(&file_attente, 0, sizeof(file_attente));
+        tab_charge = (float *) calloc(nb_proc, sizeof(float));
+        tab_version = (int *) calloc(nb_proc, sizeof(int));
+        tab_en_attente = (int *) calloc(nb_proc, sizeof(int));
+        version_en_attente = (int *) calloc(nb_proc, sizeof(int));
+        tab_participe = (int *) malloc(nb_proc * sizeof(int));
+        if(!tab_charge || !tab_version || !tab_en_attente || !version_en_attente || !tab_participe){
+            perror("simulation_init");
+            exit(1);
+        }
+        for(int j = 0; j < nb_proc; j++)
+            tab_participe[j] = (j < nb_proc - sim.inactifs);
+        tab_chef[i] = i;
+        controleur_init(&controleur, nb_proc);
+        process_agrandir();
+        // L'annuaire grandit avec les gpid annoncés (Init le dimensionne pour nb_proc * PROCESS_SIZE processus)
+        annuaire_init(&annuaire, PROCESS_SIZE);
+        renvois_init();
+        amorcage_init();
+        ETAT_RANG(SAUVER_ETAT)
+
+        r->coeurs = sim.coeurs_min + (int) (alea_uniforme(&alea_machines) * (sim.coeurs_max - sim.coeurs_min + 1));
+        double premiere_mesure = 1 + alea_uniforme(&alea_machines) * periode_moniteur_ms;
+        if(sim.fond == FOND_SINUS)
+            r->phase = 2 * M_PI * alea_uniforme(&alea_machines);
+        else if(sim.fond == FOND_PICS)
+            r->phase = alea_uniforme(&alea_machines) < 0.1 ? alea_uniforme(&alea_machines) * PERIODE_FOND_MS : -1;
+        if(i > 0)
+            evenement_planifier((struct evenement){.date = premiere_mesure, .type = EV_MESURE, .rang = i});
+    }
+
+    // Charge de travail : arrivées de Poisson et durées exponentielles, puis les tâches initiales
+    double date = 0;
+    for(int k = 0; k < sim.nb_total; k++){
+        struct tache_simulee *t = &sim.taches[k];
+        if(k < sim.nb_taches)
+            date += -log(1 - alea_uniforme(&alea_travail)) * 1e3 / sim.arrivees;
+        t->soumission_ms = k < sim.nb_taches ? date : 0;
+        t->duree = -log(1 - alea_uniforme(&alea_travail)) * sim.duree_s;
+        t->lancement_ms = -1;
+        t->fin_ms = -1;
+        t->provenance = -1;
+    }
+    if(sim.nb_taches > 0)
+        evenement_planifier((struct evenement){.date = sim.taches[0].soumission_ms, .type = EV_SOUMISSION, .indice = 0});
+    evenement_planifier((struct evenement){.date = sim.rapport_ms, .type = EV_RAPPORT});
+
+    if(sim.initial > 0){
+        char duree[32], etat[32], numero[16];
+        char *argv[] = {"test", duree, etat, numero, NULL};
+        rang_activer(1);
+        for(int k = sim.nb_taches; k < sim.nb_total; k++){
+            snprintf(duree, sizeof(duree), "%.6f", sim.taches[k].duree);
+            snprintf(etat, sizeof(etat), "%.3f", sim.etat_mo);
+            snprintf(numero, sizeof(numero), "%d", k);
+            lancer_gstart(argv, 0);
+        }
+    }
+}
+
+/**
+ * @brief simulation_boucle - traite les événements dans l'ordre jusqu'à la fin de toutes les tâches
+ *                            ou jusqu'à --fin. Après chaque événement d'un serveur, on fait ce que fait
+ *                            sa boucle de réception : migrations en cours, amorçage et file d'attente.
+ * 
+ */
+
+void simulation_boucle(){
+    struct evenement e;
+
+    while((sim.nb_total == 0 || sim.nb_finies < sim.nb_total) && evenement_retirer(&e)){
+        if(e.date > sim.fin_ms){
+            free(e.donnees);
+            break;
+        }
+        sim.maintenant = e.date;
+
+        if(e.type == EV_RAPPORT){
+            simulation_rapport();
+            continue;
+        }
+        if(e.type == EV_SOUMISSION || (e.type == EV_MESSAGE && e.rang == 0)){
+            // Le rang 0 ne fait que soumettre, il n'a pas de boucle de serveur
+            rang_activer(0);
+            sim.nb_traites++;
+            if(e.type == EV_SOUMISSION)
+                simulation_soumettre(e.indice, e.source);
+            else if(e.tag == TAG_GSTART_ACK)
+                simulation_accuse(e.donnees);
+            free(e.donnees);
+            continue;
+        }
+
+        // Un serveur occupé traite l'événement plus tard, dans l'ordre d'arrivée
+        struct rang_simule *r = &sim.rangs[e.rang];
+        if(r->libre_ms > e.date){
+            e.date = r->libre_ms;
+            evenement_planifier(e);
+            continue;
+        }
+        rang_activer(e.rang);
+        sim.nb_traites++;
+        switch(e.type){
+            case EV_MESSAGE:
+                {
+                    r->libre_ms = sim.maintenant + sim.traitement_ms;
+                    if(e.tag == TAG_CHARGE)
+                        memcpy(sim.versions_avant, tab_version, nb_proc * sizeof(int));
+                    uint64_t debut = horloge_ns();
+                    traiter_message(e.source, e.tag, e.donnees, e.taille);
+                    metrique_reception(e.tag, e.taille, horloge_ns() - debut);
+                    free(e.donnees);
+                    if(e.tag == TAG_CHARGE)
+                        simulation_charges_recues();
+                }
+                break;
+            case EV_MESURE:
+                simulation_mesure();
+                break;
+            case EV_FIN_TACHE:
+                simulation_fins(e.pid);
+                break;
+            case EV_CHECKPOINT:
+                simulation_checkpoint(e.indice, e.pid);
+                break;
+        }
+        migrations_progresser();
+        amorcage_progresser();
+        if(file_attente.nb > 0)
+            file_attente_distribuer();
+    }
+}
+
+/**
+ * @brief comparer_reels - ordre croissant (quantiles du résumé)
+ */
+
+int comparer_reels(const void *a, const void *b){
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief simulation_resume - résumé de la simulation : qualité du placement (attente avant lancement,
+ *                            étirement des tâches, déséquilibre), migrations et messages par TAG
+ * 
+ * @param duree_reelle  durée réelle de la simulation en s (sortie d'erreur)
+ */
+
+void simulation_resume(double duree_reelle){
+    double *latences = (double *) malloc((sim.nb_total + 1) * sizeof(double));
+    double *etirements = (double *) malloc((sim.nb_total + 1) * sizeof(double));
+    int nb_lances = 0, nb_etirements = 0;
+    double derniere_fin = 0, somme_etirements = 0, somme_reponses = 0;
+    uint64_t messages = 0, octets = 0;
+    struct rusage ressources;
+
+    if(!latences || !etirements){
+        perror("simulation_resume");
+        exit(1);
+    }
+    for(int k = 0; k < sim.nb_total; k++){
+        struct tache_simulee *t = &sim.taches[k];
+        if(t->lancement_ms >= 0)
+            latences[nb_lances++] = t->lancement_ms - t->soumission_ms;
+        if(t->fin_ms >= 0){
+            if(t->fin_ms > derniere_fin)
+                derniere_fin = t->fin_ms;
+            somme_reponses += t->fin_ms - t->soumission_ms;
+            if(t->duree > 0.001){
+                etirements[nb_etirements] = (t->fin_ms - t->lancement_ms) / 1e3 / t->duree;
+                somme_etirements += etirements[nb_etirements++];
+            }
+        }
+    }
+    qsort(latences, nb_lances, sizeof(double), comparer_reels);
+    qsort(etirements, nb_etirements, sizeof(double), comparer_reels);
+
+    printf("simulation : %d rangs, graine %llu, placement %s, équilibrage %s, fond %s, %.1f s simulées\n", nb_proc,
+           (unsigned long long) sim.graine, noms_placement[politique_placement], equilibrage ? "oui" : "non",
+           noms_fond[sim.fond], sim.maintenant / 1e3);
+    printf("tâches : %d lancées, %d terminées sur %d, dernière fin à %.1f s, réponse moyenne %.2f s\n", nb_lances,
+           sim.nb_finies, sim.nb_total, derniere_fin / 1e3, sim.nb_finies ? somme_reponses / sim.nb_finies / 1e3 : 0);
+    if(nb_lances > 0)
+        printf("placement : soumission -> lancement p50 %.2f ms, p99 %.2f ms, max %.2f ms ; %lld mis en file, %lld refus\n",
+               latences[nb_lances / 2], latences[(int) (nb_lances * 0.99)], latences[nb_lances - 1], sim.en_file, sim.refus);
+    if(nb_etirements > 0)
+        printf("étirement (exécution / durée sur un coeur libre) : moyen %.3f, p50 %.3f, p99 %.3f, max %.3f\n",
+               somme_etirements / nb_etirements, etirements[nb_etirements / 2], etirements[(int) (nb_etirements * 0.99)],
+               etirements[nb_etirements - 1]);
+    printf("déséquilibre (utilisation max / moyenne) : moyen %.2f, max %.2f ; ", sim.nb_rapports ? sim.somme_desequilibre / sim.nb_rapports : 0,
+           sim.desequilibre_max);
+    if(sim.dernier_desequilibre_ms < 0)
+        printf("toujours sous %d %%\n", SURCHARGE_POURCENT);
+    else if(sim.dernier_desequilibre_ms == sim.dernier_rapport_ms)
+        printf("encore au-dessus de %d %% à la fin\n", SURCHARGE_POURCENT);
+    else
+        printf("sous %d %% à partir de %.1f s\n", SURCHARGE_POURCENT, (sim.dernier_desequilibre_ms + sim.rapport_ms) / 1e3);
+    printf("décisions :");
+    for(int d = 0; d < NB_DECISIONS; d++)
+        printf(" %s %llu", noms_decisions[d], (unsigned long long) metriques.placements[d]);
+    printf(" ; sauts :");
+    for(int k = 0; k <= MAX_SAUTS; k++){
+        if(metriques.sauts_gstart[k] > 0)
+            printf(" %d%s:%llu", k, k == MAX_SAUTS ? "+" : "", (unsigned long long) metriques.sauts_gstart[k]);
+    }
+    if(metriques.placements[DECISION_LOCAL] > 0)
+        printf(", max %d", metriques.sauts_max);
+    printf("\ncharges : %.1f TAG_CHARGE par période de %d ms ; âge à la réception p50 %.0f ms, p99 %.0f ms ; "
+           "connue de tous les participants après p50 %.0f ms, p99 %.0f ms, max %.0f ms (%lld versions sur %lld)",
+           sim.mesures ? (double) metriques.messages_envoyes[TAG_CHARGE] * (nb_proc - 1) / sim.mesures : 0, periode_moniteur_ms,
+           histo_quantile(&sim.age_charges, 0.5) / 1e6, histo_quantile(&sim.age_charges, 0.99) / 1e6,
+           histo_quantile(&sim.propagation_charges, 0.5) / 1e6, histo_quantile(&sim.propagation_charges, 0.99) / 1e6,
+           sim.propagation_charges.max / 1e6, sim.versions_propagees, sim.versions_creees);
+    printf("\nmigrations : %llu envoyées, %llu reçues, %llu abandonnées ; %lld renvoyées à leur provenance en moins de %d s\n",
+           (unsigned long long) metriques.migrations_envoyees, (unsigned long long) metriques.migrations_recues,
+           (unsigned long long) metriques.migrations_abandonnees, sim.retours, FENETRE_RETOUR_MS / 1000);
+    for(int t = 0; t < NB_TAGS; t++){
+        messages += metriques.messages_envoyes[t];
+        octets += metriques.octets_envoyes[t];
+    }
+    printf("messages : %llu (%.1f par tâche, %.2f par serveur et par seconde), %.1f Mo\n", (unsigned long long) messages,
+           sim.nb_total ? (double) messages / sim.nb_total : 0, sim.maintenant > 0 ? messages / ((nb_proc - 1) * sim.maintenant / 1e3) : 0,
+           octets / 1e6);
+    for(int t = 0; t < NB_TAGS; t++){
+        if(metriques.messages_envoyes[t] > 0)
+            printf("  %-20s %12llu messages %12.1f Ko\n", noms_tags[t], (unsigned long long) metriques.messages_envoyes[t],
+                   metriques.octets_envoyes[t] / 1e3);
+    }
+    fflush(stdout);
+
+    getrusage(RUSAGE_SELF, &ressources);
+    fprintf(stderr, "simulation : %.2f s réelles, %llu événements (%.0f par seconde), mémoire max %.0f Mo\n", duree_reelle,
+            (unsigned long long) sim.nb_traites, duree_reelle > 0 ? sim.nb_traites / duree_reelle : 0, ressources.ru_maxrss / 1e3);
+    for(int t = 0; t < NB_TAGS; t++){
+        const struct histogramme *h = &metriques.traitement[t];
+        if(h->nb > 0)
+            fprintf(stderr, "  %-20s traitement réel p50 %.2f us, p99 %.2f us, max %.1f us\n", noms_tags[t],
+                    histo_quantile(h, 0.5) / 1e3, histo_quantile(h, 0.99) / 1e3, h->max / 1e3);
+    }
+    if(repertoire_metriques != NULL){
+        // Un seul fichier, lb-0.prom : les métriques sont les totaux de tous les serveurs
+        rang_activer(0);
+        metriques_exporter();
+    }
+    free(latences);
+    free(etirements);
+}
+
+/**
+ * @brief simulation_liberer - libère les serveurs virtuels (comme Final) et les événements restants
+ * 
+ */
+
+void simulation_liberer(){
+    struct evenement e;
+
+    for(int i = 0; i < nb_proc; i++){
+        rang_activer(i);
+        file_attente_vider();
+        free(tab_charge);
+        free(tab_version);
+        free(tab_en_attente);
+        free(version_en_attente);
+        free(tab_participe);
+        free(controleur.echanges);
+        free(annuaire.cases);
+        free(annuaire.entete);
+        free(renvois);
+        free(amorcage.demandeurs);
+        free(amorcage.avis);
+        free(amorcage.instantane);
+        for(int p = 0; p < process_capacite; p++){
+            if(process[p].gpid != 0)
+                process_liberer(p);
+        }
+        free(process);
+        free(sim.rangs[i].fins);
+    }
+    while(evenement_retirer(&e))
+        free(e.donnees);
+    free(sim.evenements);
+    free(sim.rangs);
+    free(sim.taches);
+    free(tampon_gossip);
+    free(tab_chef);
+    free(tab_sequence);
+    free(tampon_enveloppe);
+    free(argv_enveloppe);
+}
+
+int main (int argc, char* argv[]) {
+    struct timespec debut, fin;
+
+    // Journal des serveurs coupé par défaut : la sortie est le rapport de la simulation
+    niveau_log = LOG_ERREUR;
+    lire_options(argc, argv);
+    simulation_lire_options(argc, argv);
+    srand(sim.graine);
+
+    clock_gettime(CLOCK_MONOTONIC, &debut);
+    simulation_init();
+    simulation_boucle();
+    clock_gettime(CLOCK_MONOTONIC, &fin);
+
+    simulation_resume((fin.tv_sec - debut.tv_sec) + (fin.tv_nsec - debut.tv_nsec) / 1e9);
+    simulation_liberer();
+    return 0;
+}
+
+#endif
+
+/*
+-   fct equilibrage pour surcharge : quand ajoute une machine il faut équilibrer 
 */
\ No newline at end of file
@@ -0,0 +1,77 @@
+/* Recherche d'un gpid : l'annuaire (table de hachage, cf annuaire_lire) contre le parcours de l'ancienne
+   matrice machines[rang][case], pour 1 000, 10 000 et 100 000 gpid répartis sur 8 serveurs.
+   Les gpid cherchés sont tirés à l'avance : seule la recherche est mesurée.
+
+   Compilation et lancement, depuis la racine du dépôt :
+     mpicc -O2 -pthread -o bench/annuaire bench/annuaire.c -lm
+     bench/annuaire */
+
+#define main lb_main
+#include "../LoadBalancer.c"
+#undef main
+
+#define RANGS_BANC          8    // Serveurs qui se partagent les gpid
+
+int main(){
+    int tailles[] = {1000, 10000, 100000};
+    uint64_t alea_etat = 1;
+    struct entree_gpid copie;
+    volatile long long somme = 0;
+
+    printf("  gpid   parcours (ns)  annuaire (ns)\n");
+    for(int t = 0; t < 3; t++){
+        int n = tailles[t];
+        int colonnes = n / RANGS_BANC;
+        int nb_recherches = n < 10000 ? 1000000 : 100000;
+        gpid_t *machines = (gpid_t *) malloc(n * sizeof(gpid_t));
+        int *cherches = (int *) malloc(nb_recherches * sizeof(int));
+        if(!machines || !cherches){
+            perror("annuaire");
+            return 1;
+        }
+
+        // Le gpid i est la case i / RANGS_BANC du serveur i % RANGS_BANC, dans les deux structures
+        annuaire_init(&annuaire, 16);
+        for(int i = 0; i < n; i++){
+            gpid_t gpid = GPID(i % RANGS_BANC + 1, 0, i / RANGS_BANC + 1);
+            machines[(i % RANGS_BANC) * colonnes + i / RANGS_BANC] = gpid;
+            annuaire_ajouter(gpid, i % RANGS_BANC + 1, i / RANGS_BANC, 0);
+        }
+        for(int q = 0; q < nb_recherches; q++){
+            alea_etat = alea_etat * 6364136223846793005ULL + 1442695040888963407ULL;
+            cherches[q] = (int) ((alea_etat >> 33) % n);
+        }
+
+        // Ancienne recherche : chaque ligne de la matrice jusqu'à trouver le gpid
+        uint64_t debut = horloge_ns();
+        for(int q = 0; q < nb_recherches; q++){
+            gpid_t gpid = GPID(cherches[q] % RANGS_BANC + 1, 0, cherches[q] / RANGS_BANC + 1);
+            int trouve = -1;
+            for(int r = 0; r < RANGS_BANC && trouve == -1; r++){
+                for(int j = 0; j < colonnes; j++){
+                    if(machines[r * colonnes + j] == gpid){
+                        trouve = r + 1;
+                        break;
+                    }
+                }
+            }
+            somme += trouve;
+        }
+        uint64_t parcours = horloge_ns() - debut;
+
+        debut = horloge_ns();
+        for(int q = 0; q < nb_recherches; q++){
+            gpid_t gpid = GPID(cherches[q] % RANGS_BANC + 1, 0, cherches[q] / RANGS_BANC + 1);
+            if(annuaire_lire(gpid, &copie))
+                somme += copie.rang;
+        }
+        uint64_t recherche = horloge_ns() - debut;
+
+        printf("%6d  %14.1f %14.1f\n", n, (double) parcours / nb_recherches, (double) recherche / nb_recherches);
+        free(annuaire.cases);
+        free(annuaire.entete);
+        free(machines);
+        free(cherches);
+    }
+    return 0;
+}
@@ -0,0 +1,143 @@
+/* Durée d'un gkill de masse : chaque serveur lance nb tâches « sleep 1000 » du même groupe, puis le
+   rang 0 les tue toutes (SIGKILL) comme le menu, soit par leur groupe (une sélection envoyée à un
+   participant, qui la passe à chacun), soit par la liste de leurs gpid (gkill_gpid, un message par
+   rang d'origine et par paquet). La durée est celle du dernier serveur : de l'envoi du menu jusqu'à
+   ce qu'il ait récupéré (waitpid) toutes ses tâches.
+
+   Compilation et lancement, depuis la racine du dépôt :
+     mpicc -O2 -pthread -o bench/gkill bench/gkill.c -lm
+     mpirun -np 11 bench/gkill [tâches par serveur, 1000 par défaut] */
+
+#define main lb_main
+#include "../LoadBalancer.c"
+#undef main
+
+#define GROUPE_BANC         7    // Groupe des tâches lancées par le banc
+
+/**
+ * @brief pomper - traite les messages reçus et récupère nos processus terminés, comme receive()
+ * 
+ */
+
+void pomper(){
+    int taille;
+
+    moteur_progresser();
+    for(int k = 0; k < nb_anneaux; k++){
+        struct anneau *a = anneaux[k];
+        while(a->terminee[a->prochaine]){
+            int i = a->prochaine;
+            MPI_Get_count(&a->status[i], MPI_BYTE, &taille);
+            traiter_message(a->status[i].MPI_SOURCE, a->status[i].MPI_TAG, a->tampons[i], taille);
+            reception_poster(a, i);
+            a->prochaine = (a->prochaine + 1) % NB_RECEPTIONS;
+        }
+    }
+    processus_termines();
+}
+
+/**
+ * @brief attendre - MPI_Barrier sur comm, en continuant de traiter les messages
+ * 
+ * @param comm      communicateur du banc (distinct de celui des messages du serveur)
+ */
+
+void attendre(MPI_Comm comm){
+    MPI_Request requete;
+    int fini = 0;
+
+    MPI_Ibarrier(comm, &requete);
+    while(!fini){
+        pomper();
+        MPI_Test(&requete, &fini, MPI_STATUS_IGNORE);
+        if(!fini){
+            struct timespec pause = {0, ATTENTE_BOUCLE_US * 1000};
+            nanosleep(&pause, NULL);
+        }
+    }
+}
+
+/**
+ * @brief mesurer - lance nb tâches par serveur puis les tue depuis le rang 0
+ * 
+ * @param comm          communicateur du banc
+ * @param par_groupe    1 pour un gkill du groupe, 0 pour la liste des gpid
+ * @param nb            tâches par serveur
+ */
+
+void mesurer(MPI_Comm comm, int par_groupe, int nb){
+    char *commande[] = {"sleep", "1000", NULL};
+    gpid_t *mes_gpids = (gpid_t *) malloc(nb * sizeof(gpid_t));
+    gpid_t *tous = NULL;
+    struct selection s = {SIGKILL, SELECTION_GROUPE, GROUPE_BANC, 0, 0};
+
+    if(!mes_gpids){
+        perror("mesurer");
+        exit(1);
+    }
+    if(rank == 0){
+        tous = (gpid_t *) malloc((size_t) nb * nb_proc * sizeof(gpid_t));
+        if(!tous){
+            perror("mesurer");
+            exit(1);
+        }
+    }else{
+        for(int k = 0; k < nb; k++){
+            mes_gpids[k] = lancer_gstart(commande, GROUPE_BANC);
+            if(k % 64 == 63)
+                pomper();
+        }
+    }
+    // Le rang 0 connaît les gpid comme l'utilisateur qui les a relevés avec gps
+    MPI_Gather(mes_gpids, nb * (int) sizeof(gpid_t), MPI_BYTE, tous, nb * (int) sizeof(gpid_t), MPI_BYTE, 0, comm);
+    attendre(comm);
+
+    uint64_t debut = horloge_ns();
+    if(rank == 0){
+        if(par_groupe){
+            envoyer_selection(1, TAG_RECHERCHE_GPID, &s, NULL);
+        }else{
+            // Par paquets de la taille de ceux du menu (cf test_gkill)
+            int paquet = (TAILLE_MESSAGE - sizeof(struct selection)) / sizeof(gpid_t);
+            s.type = SELECTION_GPID;
+            s.groupe = 0;
+            for(int k = nb; k < nb * nb_proc; k += s.nb){
+                s.nb = (nb * nb_proc - k < paquet) ? nb * nb_proc - k : paquet;
+                gkill_gpid(&s, (char *) (tous + k));
+            }
+        }
+        envoi_terminer();
+    }else{
+        while(index_pid_nb > 0){
+            pomper();
+            sched_yield();
+        }
+    }
+    double duree = (horloge_ns() - debut) / 1e9, duree_max;
+    MPI_Reduce(&duree, &duree_max, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+    if(rank == 0)
+        printf("%-7s %6d tâches : %.2f s jusqu'à la dernière récupérée\n", par_groupe ? "groupe" : "gpid", nb * (nb_proc - 1), duree_max);
+    attendre(comm);
+    free(mes_gpids);
+    free(tous);
+}
+
+int main(int argc, char **argv){
+    int nb = argc > 1 ? atoi(argv[1]) : 1000;
+    MPI_Comm comm;
+
+    Init(1, argv);
+    setvbuf(stdout, NULL, _IONBF, 0);
+    if(nb_proc < 2){
+        printf("Il faut lancer le banc avec au moins 2 processus.\n");
+        MPI_Abort(MPI_COMM_WORLD, 2);
+    }
+    MPI_Comm_dup(MPI_COMM_WORLD, &comm);
+    moteur_demarrer();
+    for(int par_groupe = 1; par_groupe >= 0; par_groupe--)
+        mesurer(comm, par_groupe, nb);
+    moteur_arreter();
+    MPI_Comm_free(&comm);
+    MPI_Finalize();
+    return 0;
+}
@@ -0,0 +1,199 @@
+/* Débit de traitement des gstart par un rang : l'ancienne boucle de réception (MPI_Probe puis MPI_Recv
+   bloquants, un message par argument, envois bloquants) contre le moteur de messages de receive()
+   (réceptions pré-postées, MPI_Testsome, une enveloppe par gstart, envois non bloquants).
+
+   Le rang 0 inonde le rang 1 de gstart, par fenêtres de FENETRE_SOUMISSION avec le moteur. Le lancement est remplacé par un compteur : seul le traitement
+   des messages est mesuré. En mode local, le rang 1 « lance » chaque gstart ; en mode relais, il le fait
+   suivre au rang 2, comme un serveur qui n'est pas le moins chargé. Le débit affiché est celui du rang 1,
+   de la première réception jusqu'à la fin de ses envois.
+
+   Compilation et lancement, depuis la racine du dépôt :
+     mpicc -O2 -pthread -o bench/gstart bench/gstart.c -lm
+     mpirun -np 3 bench/gstart [gstart par mesure, 100000 par défaut] */
+
+#define main lb_main
+#include "../LoadBalancer.c"
+#undef main
+
+#define TAG_ANCIEN_CMD      2    // Ancien TAG_GSTART_CMD : un message par argument de la commande
+
+long long lances = 0;           // gstart « lancés » (le lancement est remplacé par ce compteur)
+
+/**
+ * @brief ancien_envoyer - envoie un gstart comme l'ancien menu : le nombre d'arguments,
+ *                         puis chaque argument dans son propre message
+ * 
+ * @param destination   rang du destinataire
+ * @param argv          arguments de la commande
+ * @param argc          nombre d'arguments
+ */
+
+void ancien_envoyer(int destination, char **argv, int argc){
+    MPI_Send(&argc, 1, MPI_INT, destination, TAG_GSTART, MPI_COMM_WORLD);
+    for(int i = 0; i < argc; i++)
+        MPI_Send(argv[i], strlen(argv[i]) + 1, MPI_CHAR, destination, TAG_ANCIEN_CMD, MPI_COMM_WORLD);
+}
+
+/**
+ * @brief ancienne_boucle - traite nb gstart avec l'ancienne boucle de réception
+ * 
+ * @param nb            gstart à traiter
+ * @param destination   rang auquel les faire suivre, -1 pour les lancer
+ */
+
+void ancienne_boucle(int nb, int destination){
+    MPI_Status status;
+    int size, size_cmd;
+    char *poubelle = (char *) malloc(taille_reception);
+
+    for(int n = 0; n < nb; ){
+        MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
+        if(status.MPI_TAG != TAG_GSTART){
+            // Charge envoyée par Init : ignorée
+            MPI_Recv(poubelle, taille_reception, MPI_BYTE, status.MPI_SOURCE, status.MPI_TAG, MPI_COMM_WORLD, &status);
+            continue;
+        }
+        int source = status.MPI_SOURCE;
+        MPI_Recv(&size, 1, MPI_INT, source, TAG_GSTART, MPI_COMM_WORLD, &status);
+        char **commande = (char **) malloc(sizeof(char *) * (size + 1));
+        for(int i = 0; i < size; i++){
+            MPI_Probe(source, TAG_ANCIEN_CMD, MPI_COMM_WORLD, &status);
+            MPI_Get_count(&status, MPI_CHAR, &size_cmd);
+            commande[i] = (char *) malloc(size_cmd);
+            MPI_Recv(commande[i], size_cmd, MPI_CHAR, source, TAG_ANCIEN_CMD, MPI_COMM_WORLD, &status);
+        }
+        commande[size] = NULL;
+
+        if(destination != -1)
+            ancien_envoyer(destination, commande, size);
+        else
+            lances++;
+
+        for(int i = 0; i < size; i++)
+            free(commande[i]);
+        free(commande);
+        n++;
+    }
+    free(poubelle);
+}
+
+/**
+ * @brief nouvelle_boucle - traite nb gstart avec le moteur de messages, comme receive()
+ * 
+ * @param nb            gstart à traiter
+ * @param destination   rang auquel les faire suivre, -1 pour les lancer
+ */
+
+void nouvelle_boucle(int nb, int destination){
+    struct enveloppe e;
+    int taille;
+    int n = 0;
+    uint64_t dernier_message = horloge_ns();
+
+    moteur_demarrer();
+    while(n < nb){
+        int nb_terminees = moteur_progresser();
+
+        for(int k = 0; k < nb_anneaux; k++){
+            struct anneau *a = anneaux[k];
+            while(a->terminee[a->prochaine]){
+                int i = a->prochaine;
+                MPI_Get_count(&a->status[i], MPI_BYTE, &taille);
+                if(a->status[i].MPI_TAG == TAG_GSTART){
+                    char **commande = enveloppe_decoder(a->tampons[i], taille, &e);
+                    if(destination != -1)
+                        envoyer(a->tampons[i], taille, destination, TAG_GSTART);
+                    else if(commande != NULL)
+                        lances++;
+                    n++;
+                }
+                reception_poster(a, i);
+                a->prochaine = (a->prochaine + 1) % NB_RECEPTIONS;
+            }
+        }
+
+        if(nb_terminees > 0){
+            dernier_message = horloge_ns();
+        }else if(horloge_ns() - dernier_message > ATTENTE_ACTIVITE_US * 1000ULL){
+            struct timespec pause = {0, ATTENTE_BOUCLE_US * 1000};
+            nanosleep(&pause, NULL);
+        }
+    }
+    moteur_arreter();
+}
+
+/**
+ * @brief mesurer - le rang 0 envoie nb gstart au rang 1 et le rang 1 mesure son débit
+ * 
+ * @param nouvelle      1 pour le moteur de messages, 0 pour l'ancienne boucle
+ * @param relais        1 si le rang 1 fait suivre les gstart au rang 2
+ * @param argv          commande soumise
+ * @param argc          nombre d'arguments
+ * @param nb            gstart à envoyer
+ */
+
+void mesurer(int nouvelle, int relais, char **argv, int argc, int nb){
+    struct timespec debut, fin;
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    if(rank == 0){
+        for(int n = 0; n < nb; n++){
+            if(nouvelle){
+                // Comme --lot : au plus FENETRE_SOUMISSION gstart en cours
+                envoyer_enveloppe(1, TAG_GSTART, 0, 0, argv);
+                if(n % FENETRE_SOUMISSION == FENETRE_SOUMISSION - 1)
+                    envoi_terminer();
+            }else{
+                ancien_envoyer(1, argv, argc);
+            }
+        }
+        envoi_terminer();
+    }else if(rank == 1 || (rank == 2 && relais)){
+        int destination = (rank == 1 && relais) ? 2 : -1;
+        clock_gettime(CLOCK_MONOTONIC, &debut);
+        if(nouvelle)
+            nouvelle_boucle(nb, destination);
+        else
+            ancienne_boucle(nb, destination);
+        clock_gettime(CLOCK_MONOTONIC, &fin);
+        double secondes = (fin.tv_sec - debut.tv_sec) + (fin.tv_nsec - debut.tv_nsec) / 1e9;
+        if(rank == 1)
+            printf("%-9s %-7s %4d  %10.0f\n", nouvelle ? "moteur" : "ancienne", relais ? "relais" : "local", argc, nb / secondes);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+}
+
+int main(int argc, char **argv){
+    int nb = argc > 1 ? atoi(argv[1]) : 100000;
+    char *arguments[17];
+    char textes[16][16];
+
+    Init(1, argv);
+    setvbuf(stdout, NULL, _IONBF, 0);
+    if(nb_proc < 3){
+        if(rank == 0)
+            printf("Il faut lancer le banc avec au moins 3 processus.\n");
+        MPI_Abort(MPI_COMM_WORLD, 2);
+    }
+    arguments[0] = "true";
+    for(int i = 1; i < 16; i++){
+        snprintf(textes[i], sizeof(textes[i]), "argument%d", i);
+        arguments[i] = textes[i];
+    }
+    arguments[16] = NULL;
+
+    if(rank == 1)
+        printf("boucle    mode    args  gstart/s (rang 1)\n");
+    int tailles[] = {1, 4, 16};
+    for(int relais = 0; relais <= 1; relais++){
+        for(int t = 0; t < 3; t++){
+            char *fin = arguments[tailles[t]];
+            arguments[tailles[t]] = NULL;
+            for(int nouvelle = 0; nouvelle <= 1; nouvelle++)
+                mesurer(nouvelle, relais, arguments, tailles[t], nb);
+            arguments[tailles[t]] = fin;
+        }
+    }
+    MPI_Finalize();
+    return 0;
+}
@@ -0,0 +1,123 @@
+/* Coût d'un lancement de tâche selon la mémoire du serveur : l'ancien fork + execvp contre
+   lancer_processus (posix_spawnp), depuis un processus MPI dont le tas touché fait 0, 256 puis 1024 Mo.
+   fork copie les tables de pages de tout le processus ; posix_spawnp crée le fils sans rien copier.
+   Chaque mesure lance nb fois « true » et récupère les fils au fur et à mesure ; la latence est celle
+   vue par le serveur, de l'appel jusqu'à son retour.
+
+   Compilation et lancement, depuis la racine du dépôt :
+     mpicc -O2 -pthread -o bench/lancement bench/lancement.c -lm
+     bench/lancement [lancements par mesure, 2000 par défaut] [Mo de tas..., 0 256 1024 par défaut] */
+
+#define main lb_main
+#include "../LoadBalancer.c"
+#undef main
+
+char *tas = NULL;               // Tas du serveur simulé (global : le compilateur ne peut pas supprimer son remplissage)
+
+/**
+ * @brief comparer_us - ordre croissant de deux latences, pour qsort
+ * 
+ */
+
+int comparer_us(const void *a, const void *b){
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief recolter - récupère les fils terminés, sans bloquer
+ * 
+ */
+
+void recolter(){
+    pid_t pid;
+    while((pid = waitpid(-1, NULL, WNOHANG)) > 0)
+        index_pid_retirer(pid);
+}
+
+/**
+ * @brief mesurer - lance nb fois « true » et affiche le débit et la latence des lancements
+ * 
+ * @param nouveau   1 pour lancer_processus (posix_spawnp), 0 pour fork + execvp
+ * @param p         case de la table des processus qui porte la commande
+ * @param nb        lancements
+ * @param mo        taille du tas touché, pour l'affichage
+ */
+
+void mesurer(int nouveau, int p, int nb, long mo){
+    double *latences = (double *) malloc(nb * sizeof(double));
+    pid_t *pids = (pid_t *) malloc(nb * sizeof(pid_t));
+    if(!latences || !pids){
+        perror("mesurer");
+        exit(1);
+    }
+
+    uint64_t debut = horloge_ns();
+    for(int i = 0; i < nb; i++){
+        uint64_t avant = horloge_ns();
+        if(nouveau){
+            lancer_processus(p, NULL);
+            pids[i] = process[p].pid;
+        }else{
+            // Ancien lancer_processus : le serveur se duplique puis le fils exécute la commande
+            pid_t pid = fork();
+            if(pid == -1){
+                perror("fork");
+                exit(1);
+            }
+            if(pid == 0){
+                execvp(process[p].argv[0], process[p].argv);
+                _exit(127);
+            }
+            pids[i] = pid;
+        }
+        latences[i] = (horloge_ns() - avant) / 1e3;
+        recolter();
+    }
+    // Pas de wait(NULL) : lancé sans mpirun, le processus a aussi orted pour fils
+    for(int i = 0; i < nb; i++){
+        if(waitpid(pids[i], NULL, 0) > 0)
+            index_pid_retirer(pids[i]);
+    }
+    double secondes = (horloge_ns() - debut) / 1e9;
+
+    qsort(latences, nb, sizeof(double), comparer_us);
+    printf("%5ld Mo  %-12s %7.0f lancements/s  p50 %8.1f us  p99 %8.1f us\n", mo, nouveau ? "posix_spawnp" : "fork+execvp",
+           nb / secondes, latences[nb / 2], latences[nb * 99 / 100]);
+    free(latences);
+    free(pids);
+}
+
+int main(int argc, char **argv){
+    int nb = argc > 1 ? atoi(argv[1]) : 2000;
+    long tailles_defaut[] = {0, 256, 1024};
+    int nb_tailles = argc > 2 ? argc - 2 : 3;
+    char *commande[] = {"true", NULL};
+    int niveau_thread;
+
+    // Un seul processus MPI : seul le coût du lancement dans un processus MPI nous intéresse
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &niveau_thread);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    process_agrandir();
+    lanceur_init();
+    int p = process_allouer();
+    process[p].gpid = GPID(rank, 0, 1);
+    process[p].argv = commande;
+
+    for(int t = 0; t < nb_tailles; t++){
+        long mo = argc > 2 ? atol(argv[t + 2]) : tailles_defaut[t];
+        tas = (char *) malloc(mo > 0 ? mo << 20 : 1);
+        if(!tas){
+            perror("malloc");
+            return 1;
+        }
+        // Le tas est touché : ses pages existent et fork doit copier leurs entrées
+        memset(tas, 1, mo << 20);
+        for(int nouveau = 0; nouveau <= 1; nouveau++)
+            mesurer(nouveau, p, nb, mo);
+        free(tas);
+    }
+    lanceur_fermer();
+    MPI_Finalize();
+    return 0;
+}
@@ -0,0 +1,55 @@
+/* Générateur de registres des tâches (option --registre, cf REGISTRE), pour mesurer la reprise.
+
+   Écrit dir/lb-<rang>.reg pour les rangs 1 à serveurs, avec registre_ecrire : des paires lancement / fin
+   de « ./test 60 », jusqu'à avoir le nombre d'enregistrements demandé par serveur. Le serveur relancé
+   sur ce répertoire relit son registre et affiche sa durée (« registre relu en ... ms »).
+
+   Compilation et lancement, depuis la racine du dépôt :
+     mpicc -O2 -pthread -o bench/registre bench/registre.c -lm
+     bench/registre /tmp/reg 1000000 [serveurs, 1 par défaut]
+     mpirun -np 2 ./LoadBalancer --registre=/tmp/reg --lot=/dev/null */
+
+#define main lb_main
+#include "../LoadBalancer.c"
+#undef main
+
+int main(int argc, char **argv){
+    char *commande[] = {"./test", "60", NULL};
+
+    if(argc < 3){
+        fprintf(stderr, "usage : %s répertoire enregistrements [serveurs]\n", argv[0]);
+        return 2;
+    }
+    long long nb = atoll(argv[2]);
+    int serveurs = argc > 3 ? atoi(argv[3]) : 1;
+    if(mkdir(argv[1], 0700) == -1 && errno != EEXIST){
+        perror(argv[1]);
+        return 1;
+    }
+    snprintf(hostname, sizeof(hostname), "registre");
+    process_agrandir();
+    int p = process_allouer();
+    process[p].argv = commande;
+
+    for(rank = 1; rank <= serveurs; rank++){
+        cpt_gpid = 1;
+        epoque_gpid = 0;
+        snprintf(registre.chemin, sizeof(registre.chemin), "%s/lb-%d.reg", argv[1], rank);
+        if(registre_projeter(registre.chemin, 1) == -1){
+            perror(registre.chemin);
+            return 1;
+        }
+        for(long long n = 0; n < nb; n += 2){
+            gpid_t gpid = GPID(rank, epoque_gpid, cpt_gpid);
+            cpt_gpid++;
+            if(registre_ecrire(REG_LANCE, gpid, p, 0) == -1 || (n + 1 < nb && registre_ecrire(REG_FIN, gpid, p, 0) == -1)){
+                perror(registre.chemin);
+                return 1;
+            }
+        }
+        printf("%s : %d enregistrements, %.1f Mo\n", registre.chemin, registre.nb, registre.fin / 1e6);
+        munmap(registre.base, registre.taille);
+        close(registre.fd);
+    }
+    return 0;
+}
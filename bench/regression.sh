@@ -0,0 +1,41 @@
+#!/bin/sh
+# Régression du simulateur (cf README, Simulator) : chaque scénario tourne avec une graine fixe, et sa
+# sortie standard, identique d'une exécution à l'autre, est comparée à bench/attendu/<scénario>.txt.
+# Le temps réel et la mémoire vont sur la sortie d'erreur et ne sont pas comparés.
+#
+#     bench/regression.sh                   compare les sorties aux sorties attendues
+#     bench/regression.sh --mettre-a-jour   réécrit les sorties attendues (après un changement voulu)
+#
+# Code de retour : 0 si toutes les sorties sont identiques, 1 sinon.
+
+cd "$(dirname "$0")/.." || exit 1
+gcc -O2 -pthread -DSIMULATION LoadBalancer.c -o bench/simulation -lm || exit 1
+
+sortie=$(mktemp) || exit 1
+trap 'rm -f "$sortie"' EXIT
+echec=0
+
+while read -r nom options; do
+    [ -z "$nom" ] && continue
+    # shellcheck disable=SC2086
+    ./bench/simulation $options > "$sortie" 2> /dev/null || { echo "$nom : la simulation a échoué"; echec=1; continue; }
+    if [ "$1" = "--mettre-a-jour" ]; then
+        cat "$sortie" > "bench/attendu/$nom.txt"
+        echo "$nom : sortie attendue réécrite"
+    elif cmp -s "$sortie" "bench/attendu/$nom.txt"; then
+        echo "$nom : identique"
+    else
+        echo "$nom : DIFFÉRENT"
+        diff "bench/attendu/$nom.txt" "$sortie" | head -20
+        echec=1
+    fi
+done <<SCENARIOS
+base            --rangs=64 --graine=1
+placement       --rangs=64 --taches=3000 --arrivees=25 --duree=10 --coeurs=2-8 --placement=deux-choix --graine=1 --rapport=10000
+equilibrage     --rangs=64 --taches=3000 --arrivees=25 --duree=10 --coeurs=2-8 --fond=pics --equilibrage --graine=1 --rapport=10000
+convergence     --rangs=64 --taches=0 --initial=500 --duree=60 --coeurs=4 --equilibrage --graine=1 --rapport=30000
+migrations      --rangs=200 --taches=5000 --arrivees=200 --duree=5 --etat=50 --coeurs=2-8 --fond=pics --equilibrage --graine=1
+sauts           --rangs=17 --taches=500 --arrivees=50 --duree=2 --graine=1
+SCENARIOS
+
+exit $echec
@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <time.h>
+
+/*
+ * Tâche de test du répartiteur (commande "./test" du menu gstart).
+ *
+ *      ./test secondes [taille_etat_Mo]
+ *
+ * La tâche travaille pendant `secondes` secondes par pas de 100 ms et garde un état de
+ * `taille_etat_Mo` Mo (0 par défaut). Elle suit le protocole de migration du répartiteur :
+ *  - à la réception de SIGUSR1, elle écrit son état dans le fichier $LB_CHECKPOINT
+ *    et se termine avec le code 75 ;
+ *  - si $LB_RESTORE est défini, elle reprend à partir de ce fichier au lieu de repartir de zéro.
+ */
+
+#define CODE_CHECKPOINT     75      // Code de sortie après l'écriture du checkpoint
+#define PAS_MS              100     // Durée d'un pas de travail
+#define TAILLE_BLOC         (1 << 20) // Taille des écritures et lectures du checkpoint
+
+/* En-tête du fichier de checkpoint */
+
+struct entete{
+    uint64_t magique;           // MAGIQUE, pour reconnaître un checkpoint de cette tâche
+    uint64_t pas_faits;         // Nombre de pas déjà effectués
+    uint64_t pas_total;         // Nombre de pas à effectuer
+    uint64_t taille_etat;       // Taille de l'état en octets
+    uint64_t somme;             // Somme de contrôle de l'état
+};
+
+#define MAGIQUE 0x4c42434b50540001ULL
+
+volatile sig_atomic_t checkpoint_demande = 0;      // Positionné par le gestionnaire de SIGUSR1
+
+void demander_checkpoint(int sig){
+    (void) sig;
+    checkpoint_demande = 1;
+}
+
+/**
+ * @brief somme_etat - somme de contrôle (FNV-1a sur des mots de 64 bits) de l'état
+ */
+
+uint64_t somme_etat(const uint64_t *etat, uint64_t taille){
+    uint64_t h = 1469598103934665603ULL;
+    for(uint64_t i = 0; i < taille / sizeof(uint64_t); i++){
+        h ^= etat[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/**
+ * @brief ecrire_tout / lire_tout - transfert complet d'un tampon, par blocs de TAILLE_BLOC
+ */
+
+int ecrire_tout(int fd, const char *p, uint64_t taille){
+    while(taille > 0){
+        ssize_t n = write(fd, p, taille < TAILLE_BLOC ? taille : TAILLE_BLOC);
+        if(n <= 0)
+            return -1;
+        p += n;
+        taille -= n;
+    }
+    return 0;
+}
+
+int lire_tout(int fd, char *p, uint64_t taille){
+    while(taille > 0){
+        ssize_t n = read(fd, p, taille < TAILLE_BLOC ? taille : TAILLE_BLOC);
+        if(n <= 0)
+            return -1;
+        p += n;
+        taille -= n;
+    }
+    return 0;
+}
+
+/**
+ * @brief ecrire_checkpoint - écrit l'en-tête puis l'état dans $LB_CHECKPOINT et termine la tâche
+ */
+
+void ecrire_checkpoint(struct entete *e, uint64_t *etat){
+    char *chemin = getenv("LB_CHECKPOINT");
+    if(chemin == NULL){
+        fprintf(stderr, "test : LB_CHECKPOINT absent, impossible de migrer\n");
+        exit(EXIT_FAILURE);
+    }
+    e->somme = somme_etat(etat, e->taille_etat);
+    int fd = open(chemin, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if(fd == -1 || ecrire_tout(fd, (char *) e, sizeof(struct entete)) == -1
+       || ecrire_tout(fd, (char *) etat, e->taille_etat) == -1 || close(fd) == -1){
+        perror("test : écriture du checkpoint");
+        exit(EXIT_FAILURE);
+    }
+    printf("test %d : checkpoint écrit après %llu/%llu pas (%llu octets d'état)\n", getpid(),
+           (unsigned long long) e->pas_faits, (unsigned long long) e->pas_total, (unsigned long long) e->taille_etat);
+    exit(CODE_CHECKPOINT);
+}
+
+/**
+ * @brief restaurer - relit un checkpoint et vérifie la somme de contrôle de l'état
+ */
+
+uint64_t* restaurer(const char *chemin, struct entete *e){
+    int fd = open(chemin, O_RDONLY);
+    if(fd == -1 || lire_tout(fd, (char *) e, sizeof(struct entete)) == -1 || e->magique != MAGIQUE){
+        fprintf(stderr, "test : checkpoint %s invalide\n", chemin);
+        exit(EXIT_FAILURE);
+    }
+    uint64_t *etat = (uint64_t *) malloc(e->taille_etat ? e->taille_etat : 1);
+    if(etat == NULL || lire_tout(fd, (char *) etat, e->taille_etat) == -1){
+        fprintf(stderr, "test : état du checkpoint %s incomplet\n", chemin);
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
+    if(somme_etat(etat, e->taille_etat) != e->somme){
+        fprintf(stderr, "test : somme de contrôle du checkpoint %s incorrecte\n", chemin);
+        exit(EXIT_FAILURE);
+    }
+    // Le répartiteur réutilise ce chemin pour notre prochain checkpoint
+    unlink(chemin);
+    return etat;
+}
+
+int main(int argc, char *argv[]){
+    struct entete e;
+    uint64_t *etat;
+    struct timespec pas = {0, PAS_MS * 1000000L};
+    char *chemin_restauration = getenv("LB_RESTORE");
+
+    signal(SIGUSR1, demander_checkpoint);
+
+    if(chemin_restauration != NULL){
+        etat = restaurer(chemin_restauration, &e);
+        printf("test %d : reprise à %llu/%llu pas (%llu octets d'état vérifiés)\n", getpid(),
+               (unsigned long long) e.pas_faits, (unsigned long long) e.pas_total, (unsigned long long) e.taille_etat);
+    }else{
+        int secondes = argc > 1 ? atoi(argv[1]) : 2;
+        long taille_mo = argc > 2 ? atol(argv[2]) : 0;
+        e.magique = MAGIQUE;
+        e.pas_faits = 0;
+        e.pas_total = (uint64_t) secondes * 1000 / PAS_MS;
+        e.taille_etat = (uint64_t) taille_mo << 20;
+        etat = (uint64_t *) malloc(e.taille_etat ? e.taille_etat : 1);
+        if(etat == NULL){
+            perror("test : malloc");
+            exit(EXIT_FAILURE);
+        }
+        for(uint64_t i = 0; i < e.taille_etat / sizeof(uint64_t); i++)
+            etat[i] = i * 0x9e3779b97f4a7c15ULL;
+    }
+
+    while(e.pas_faits < e.pas_total){
+        if(checkpoint_demande)
+            ecrire_checkpoint(&e, etat);
+        nanosleep(&pas, NULL);
+        e.pas_faits++;
+    }
+    printf("test %d : terminé (%llu pas)\n", getpid(), (unsigned long long) e.pas_total);
+    free(etat);
+    return 0;
+}